@@ -4769,6 +4769,67 @@ FRESULT f_findfirst (
 	return res;
 }
 
+
+
+/*-----------------------------------------------------------------------*/
+/* Open a File by its Directory Entry Index                              */
+/*-----------------------------------------------------------------------*/
+/* Opens the file at entry index idx of an open directory for reading,
+/  without searching the directory for its name. The index is the one
+/  f_tellidx() gave when the entry was found. */
+
+FRESULT f_openidx (
+	FIL* fp,		/* Pointer to the blank file object */
+	DIR* dp,		/* Pointer to the open directory object */
+	DWORD idx		/* Index of the file's entry in the directory */
+)
+{
+	FRESULT res;
+	FATFS *fs;
+	BYTE c, a;
+
+
+	if (!fp) return FR_INVALID_OBJECT;
+
+	res = validate(&dp->obj, &fs);	/* Check validity of the directory object */
+	if (res == FR_OK) {
+#if FF_FS_EXFAT
+		if (fs->fs_type == FS_EXFAT) res = FR_INVALID_OBJECT;	/* exFAT entry sets are not supported */
+		if (res == FR_OK)
+#endif
+		res = dir_sdi(dp, idx * SZDIRE);	/* Go to the entry */
+		if (res == FR_OK) res = move_window(fs, dp->sect);
+		if (res == FR_OK) {
+			c = dp->dir[DIR_Name];
+			a = dp->dir[DIR_Attr] & AM_MASK;
+			if (c == 0 || c == DDEM || a == AM_LFN || (a & (AM_DIR | AM_VOL))) {
+				res = FR_NO_FILE;	/* Not a file entry */
+			}
+		}
+		if (res == FR_OK) {
+#if !FF_FS_READONLY
+			fp->dir_sect = fs->winsect;		/* Pointer to the directory entry */
+			fp->dir_ptr = dp->dir;
+#endif
+			fp->obj.sclust = ld_clust(fs, dp->dir);	/* Get object allocation info */
+			fp->obj.objsize = ld_dword(dp->dir + DIR_FileSize);
+#if FF_USE_FASTSEEK
+			fp->cltbl = 0;		/* Disable fast seek mode */
+#endif
+			fp->obj.fs = fs;	/* Validate the file object */
+			fp->obj.id = fs->id;
+			fp->flag = FA_READ;	/* Set file access mode */
+			fp->err = 0;		/* Clear error flag */
+			fp->sect = 0;		/* Invalidate current data sector */
+			fp->fptr = 0;		/* Set file pointer top of the file */
+#if !FF_FS_READONLY && !FF_FS_TINY
+			memset(fp->buf, 0, sizeof fp->buf);	/* Clear sector buffer */
+#endif
+		}
+	}
+	LEAVE_FF(fs, res);
+}
+
 #endif	/* FF_USE_FIND */
 
 
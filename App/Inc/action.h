@@ -0,0 +1,73 @@
+// ****************************************************************************
+//     Filename: ACTION.H
+// Date Created: 10/19/2026
+//
+//     Comments: Trigger action map header for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+// Each trigger is mapped to an action on a track. The map is read from
+//  INIT.TXT in the root directory at boot, one trigger per line:
+//
+//    ; Comment
+//    #TRIG n, action, track<, gainDb, fadeMs>
+//
+//  where action is PLAY, STOP, TOGGLE, LOOP or XFADE. The parsed map is
+//  cached in INIT.BIN and only re-parsed when INIT.TXT changes. Triggers
+//  that aren't in the file play the track with the same number.
+
+#define ACTION_TEXT_NAME		"INIT.TXT"
+#define ACTION_CACHE_NAME		"INIT.BIN"
+#define ACTION_CACHE_MARK		0x4d415031		// "MAP1"
+#define ACTION_LINE_LEN			80
+
+#define ACTION_NONE				0		// Do nothing
+#define ACTION_PLAY				1		// Start the track polyphonically
+#define ACTION_STOP				2		// Stop the track, fading over fadeMs
+#define ACTION_TOGGLE			3		// Stop the track if playing, else play it
+#define ACTION_LOOP				4		// Toggle the track looping
+#define ACTION_XFADE			5		// Fade out everything else, fade up the track
+#define ACTION_NUM_TYPES		6
+
+typedef struct {
+	uint8_t type;
+	uint8_t reserved;
+	uint16_t track;
+	int16_t gainDb;
+	uint16_t fadeMs;
+} ACTION_STRUCTURE;
+
+// INIT.BIN holds this header followed by the map. The size and date of
+//  INIT.TXT are kept to tell when the cache is stale.
+
+typedef struct {
+	uint32_t mark;
+	uint32_t textSize;
+	uint16_t textDate;
+	uint16_t textTime;
+} ACTION_CACHE_HEADER;
+
+// Function prototypes for this module
+
+void actionInit(void);
+void actionDispatch(uint8_t trig, uint8_t edge);
+bool actionSet(uint8_t trig, ACTION_STRUCTURE * pAction);
+ACTION_STRUCTURE * actionGet(uint8_t trig);
@@ -42,7 +42,30 @@
 #define SAMPLES_PER_BLOCK		(SD_SECTORS_PER_BLOCK * 256)
 
 #define TX_BUFFER_SIZE			1024
-#define RX_BUFFER_SIZE			256
+#define RX_BUFFER_SIZE			2048		// About 10ms of input at 2 Mbaud
+
+#define SERIAL_DEFAULT_BAUD		57600
+
+// Interrupt priority tiers. The audio buffer interrupt preempts everything.
+//  The SD card and serial port come next, then the system tick. MP3 decoding
+//  runs in PendSV at the bottom, below all of them but above the main loop.
+
+#ifdef PLAYER_RTOS
+
+// With an RTOS, interrupts that signal threads can't be above the kernel's
+//  syscall priority, 5 in the usual FreeRTOS setup.
+
+#define PRIO_AUDIO				5
+#define PRIO_IO					6
+
+#else
+
+#define PRIO_AUDIO				0
+#define PRIO_IO					1
+#define PRIO_TICK				14
+#define PRIO_DECODE				15
+
+#endif
 
 // Public function prototypes for this module
 
@@ -54,14 +77,31 @@ bool biosSdReadSector(uint8_t *dst, uint32_t s);
 bool biosSdReadBlock(uint8_t *dst, uint32_t s);
 bool biosSdReadSectors(uint8_t *pDst, uint32_t addr, uint16_t nsecs);
 bool biosSdWriteSectors(uint8_t *pDst, uint32_t addr, uint16_t nsecs);
+void biosWaitFlag(volatile bool * pFlag);
 
 uint32_t biosGetHiResTimer(void);
+uint32_t biosGetCycleCount(void);
+void biosSetTickMs(uint8_t ms);
+uint8_t biosGetTickMs(void);
 
 void biosLED(int led, bool state);
 void biosDebug(bool state);
 
+void biosAudioStart(uint32_t *pBuff, uint16_t numSamples);
+uint16_t biosAudioGetIndex(uint16_t numSamples);
+void biosPendDecode(void);
+
+void biosTriggerStart(uint16_t *pBuff, uint16_t numSamples, uint32_t rateHz);
+uint16_t biosTriggerGetIndex(uint16_t numSamples);
+
 void biosSerialInit(void);
 void biosStartSerialXmt(void);
+void biosGetSerialStats(uint32_t * pIrqs, uint32_t * pRxBytes, uint32_t * pTxBytes);
+uint32_t biosSerialGetOverruns(void);
+bool biosSerialCheckOverrun(void);
+void biosSerialSetBaud(uint32_t baud);
+uint32_t biosSerialGetBaud(void);
+uint32_t biosSerialGetErrors(void);
 
 void biosUSART1_IRQHandler(void);
 
@@ -27,10 +27,29 @@
 #define MAX_CONSOLE_CMD_LEN		64
 #define MAX_CONSOLE_PARAMS		8
 
+// A console command table entry
+
+typedef struct {
+	const char * pName;				// Command name, lower case
+	uint8_t minParams;				// Fewest parameters allowed
+	uint8_t maxParams;				// Most parameters allowed
+	void (* handler)(void);			// Called with the parameters in conParam[]
+	const char * pHelp;				// Function name for the help listing
+	const char * pParams;			// Parameter description for the help listing
+} CONSOLE_CMD_STRUCTURE;
+
+// Commands with long output send it through a generator, one step per call.
+//  A step waits until there's this much room in the transmit buffer.
+
+typedef bool (* CONSOLE_GEN_FUNC)(uint16_t step);
+
+#define CONSOLE_GEN_MIN_FREE	160
+
 // Function prototypes for this module
 
 void consoleInit(void);
 void consoleService(void);
+void consoleDoLine(void);
 void consoleDoCommand(void);
 bool consoleParseLine(void);
 int consoleGetCommand(char * cmdString);
@@ -38,9 +57,15 @@ int consoleGetValue(int32_t * val);
 
 void consoleSyntaxErr(void);
 void consoleSignOn(void);
+void consoleSendTrackInfo(uint16_t t);
 
 bool consoleNewLine(int nl);
 bool consoleSendString(char * pMsg);
 bool consoleSendBytes(char * pMsg, uint8_t len);
 bool consoleSendInt32(uint32_t n);
+bool consoleSendSigned(int32_t n);
+void consoleStartGen(CONSOLE_GEN_FUNC gen);
+uint16_t consoleTxFree(void);
+uint32_t consoleGetDrops(void);
+bool consoleBusy(void);
 
@@ -30,6 +30,40 @@
 
 #define MAX_GAIN_TABLE_ENTRY	(((MAX_GAIN_DB - MIN_GAIN_DB) * 2) - 1)
 
+#define PAN_LEFT				0
+#define PAN_CENTER				64
+#define PAN_RIGHT				128
+
+#define PAN_STEREO_BOOST		23170		// sqrt(2) in Q2_14
+
+// Output dither. The master bus is Q30, so one 24-bit LSB is 2^7 in bus
+//  units. TPDF dither is the sum of two uniform values of one LSB each.
+
+#define DITHER_OFF				0
+#define DITHER_TPDF				1
+#define DITHER_SHAPED			2		// TPDF with first order noise shaping
+#define DITHER_NUM_MODES		3
+
+#define DITHER_LSB				0x80
+#define DITHER_RAND_MASK		(DITHER_LSB - 1)
+#define DITHER_QUANT_MASK		(~(DITHER_LSB - 1))
+#define DITHER_SEED				0x2545f491
+
+#define MIX_BENCH_3PASS			0
+#define MIX_BENCH_FUSED			1
+
+// Gain ramp state for the mix kernels. Gains are packed left/right in the
+//  top halves of gL and gR.
+
+typedef struct {
+	q31_t gL;					// Left gain accumulator
+	q31_t gR;					// Right gain accumulator
+	q31_t dL;					// Left gain step per frame
+	q31_t dR;					// Right gain step per frame
+	q31_t gEnd;					// Packed final gains
+	uint32_t rampFrames;		// Frames left in the ramp
+} MIX_RAMP_STRUCTURE;
+
 #define MAKEQ1_15(x) ((int)dspClip16(((x) * 32768.0f) + 0.5f))
 #define MAKEQ2_14(x) ((int)dspClip16(((x) * 16384.0f) + 0.5f)) 
 #define MAKEQ3_13(x) ((int)dspClip16(((x) * 8192.0f) + 0.5f)) 
@@ -42,6 +76,9 @@
 
 void initDsp(void);
 uint32_t dspGetDither(void);
+void dspSetDitherMode(uint8_t mode);
+uint8_t dspGetDitherMode(void);
+void dspOutput24(uint32_t * pDst, q31_t * pBus, uint32_t numFrames);
 uint8_t dBtoIndex(int16_t dbGain);
 void arm_ramp_q15(
 	q15_t * pSrc,
@@ -55,6 +92,25 @@ void arm_copy_split_q15(
 	q15_t * pDstL,
 	q15_t * pDstR,
 	uint32_t blockSize);
+void arm_stereo_to_mono_q15(
+	q15_t * pSrc,
+	q15_t * pDst,
+	uint32_t numFrames);
+q31_t dspPanGains(q15_t gain, uint8_t pan, bool mono);
+void dspRampStart(MIX_RAMP_STRUCTURE * pRamp, q31_t gainStart, q31_t gainEnd,
+					uint32_t rampFrames);
+void arm_mix_q15_q31(
+	q15_t * pSrc,
+	q31_t * pDst,
+	MIX_RAMP_STRUCTURE * pRamp,
+	uint32_t numFrames);
+void arm_mix_mono_q15_q31(
+	q15_t * pSrc,
+	q31_t * pDst,
+	MIX_RAMP_STRUCTURE * pRamp,
+	uint32_t numFrames);
+void dspMixBenchmark(void);
+uint32_t dspGetMixCycles(uint8_t path);
 void copy_q15(
 	q15_t * pSrc,
 	q15_t * pDst,
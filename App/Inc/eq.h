@@ -0,0 +1,63 @@
+// ****************************************************************************
+//     Filename: EQ.H
+// Date Created: 10/19/2026
+//
+//     Comments: Master bus parametric EQ header for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+// Band filter types
+
+#define EQ_TYPE_OFF				0
+#define EQ_TYPE_PEAK			1		// Peaking (bell)
+#define EQ_TYPE_LOWSHELF		2
+#define EQ_TYPE_HIGHSHELF		3
+#define EQ_NUM_TYPES			4
+
+#define EQ_MAX_BANDS			5
+
+#define EQ_MIN_FREQ				20
+#define EQ_MAX_FREQ				20000
+#define EQ_MAX_GAIN_DB			15
+#define EQ_MIN_Q100				10		// Q of 0.10
+#define EQ_MAX_Q100				1000	// Q of 10.0
+
+// The biquad coefficients are stored scaled down by 2^EQ_POST_SHIFT so that
+//  boosts up to EQ_MAX_GAIN_DB fit in q31, and the bus is scaled down by
+//  2^EQ_HEADROOM_BITS going through the filters so that a boosted full mix
+//  can't wrap the filter output.
+
+#define EQ_POST_SHIFT			3
+#define EQ_HEADROOM_BITS		3
+
+typedef struct {
+	uint8_t type;				// Filter type
+	int8_t gainDb;				// Boost or cut in dB
+	uint16_t freqHz;			// Center or corner frequency
+	uint16_t q100;				// Q (or shelf slope) times 100
+} EQ_BAND_STRUCTURE;
+
+// Function prototypes for this module
+
+void eqInit(void);
+bool eqSetBand(uint8_t band, uint8_t type, uint16_t freqHz, int8_t gainDb, uint16_t q100);
+EQ_BAND_STRUCTURE * eqGetBand(uint8_t band);
+void eqProcess(q31_t * pBus, uint32_t numFrames);
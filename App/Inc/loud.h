@@ -0,0 +1,66 @@
+// ****************************************************************************
+//     Filename: LOUD.H
+// Date Created: 10/19/2026
+//
+//     Comments: Track loudness analysis header for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+// Tracks are measured for integrated loudness per ITU-R BS.1770 (K-weighted,
+//  gated) in the background while nothing is playing. Results are kept in
+//  the track info and saved to LOUD_FILE_NAME so that the work carries over
+//  from one boot to the next.
+
+#define LOUD_FILE_NAME			"LOUD.DAT"
+#define LOUD_ENTRY_MARK			0xa5
+
+#define LOUD_TARGET_LUFS		-18		// Default normalization target
+#define LOUD_MAX_OFFSET_DB		12		// Most we'll boost or cut a track
+#define LOUD_ABS_GATE_LUFS		-70
+#define LOUD_REL_GATE_LU		10
+
+#define LOUD_HIST_BINS_PER_LU	4
+#define LOUD_HIST_BINS			(-LOUD_ABS_GATE_LUFS * LOUD_HIST_BINS_PER_LU)
+
+#define LOUD_POST_SHIFT			2		// K-weighting coefficient scaling
+#define LOUD_INPUT_SHIFT		14		// q15 to filter input, 2 bits headroom
+#define LOUD_READ_BYTES			8192	// Decoder reads go through gSdBuff
+
+// Saved loudness entry, one per track in the loudness file. The file size is
+//  kept so that a track that's been replaced gets measured again.
+
+typedef struct {
+	uint32_t fileSize;			// Size of the file that was measured
+	int8_t lufs;				// Integrated loudness
+	uint8_t mark;				// LOUD_ENTRY_MARK if valid
+	uint16_t reserved;
+} LOUD_ENTRY_STRUCTURE;
+
+// Function prototypes for this module
+
+void loudInit(void);
+void loudService(void);
+bool loudBusy(void);
+int8_t loudGetOffsetDb(uint16_t t);
+void loudSetNormalize(bool enable, int8_t targetLufs);
+bool loudGetNormalize(void);
+int8_t loudGetTarget(void);
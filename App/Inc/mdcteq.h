@@ -0,0 +1,73 @@
+// ****************************************************************************
+//     Filename: MDCTEQ.H
+// Date Created: 10/19/2026
+//
+//     Comments: MDCT domain voice EQ header for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+// The voice EQ is a 10 band graphic EQ with octave bands centered from
+//  31.25Hz to 16kHz. It's applied to the MP3 decoder's 576 MDCT lines per
+//  granule through the SpiritMP3 processing callback.
+
+#define MDCT_EQ_BANDS			10
+#define MDCT_EQ_FIRST_CENTER	31.25f
+#define MDCT_EQ_MAX_GAIN_DB		12
+
+#define MDCT_LINES				576
+#define MDCT_SUBBANDS			32
+#define MDCT_LINES_PER_SUBBAND	18
+
+// When the CPU load meter passes MDCT_DEGRADE_ON_LOAD, voices that aren't
+//  locked have their spectrum cut off above the degrade cutoff until the
+//  load falls back under MDCT_DEGRADE_OFF_LOAD.
+
+#define MDCT_DEGRADE_ON_LOAD	85		// Percent
+#define MDCT_DEGRADE_OFF_LOAD	70		// Percent
+#define MDCT_DEGRADE_CUTOFF_HZ	11000
+
+#define MDCT_BENCH_MDCT			0
+#define MDCT_BENCH_BIQUAD		1
+
+typedef struct {
+	bool active;							// Any band not flat
+	int8_t bandDb[MDCT_EQ_BANDS];			// Band gains in dB
+	uint32_t sampleRate;					// Rate the gains were mapped for
+	uint16_t cutLine;						// First line above the degrade cutoff
+	uint8_t cutSubband;						// First subband above the degrade cutoff
+	q15_t longGain[MDCT_LINES];				// Q3_13 gain per line, long blocks
+	q15_t shortGain[MDCT_SUBBANDS];			// Q3_13 gain per subband, short blocks
+} MDCT_EQ_STRUCTURE;
+
+// Function prototypes for this module
+
+void mdctEqInit(void);
+bool mdctEqSetBand(uint8_t v, uint8_t band, int8_t gainDb);
+int8_t mdctEqGetBand(uint8_t v, uint8_t band);
+void mdctEqSetRate(uint8_t v, uint32_t sampleRate);
+void mdctEqProcess(void * mdct_samples, int isShort, int ch, void * token);
+void mdctDegradeSet(uint8_t onLoad, uint8_t offLoad, uint16_t cutoffHz);
+void mdctDegradeService(void);
+bool mdctDegradeIsActive(void);
+uint16_t mdctDegradeGetCutoff(void);
+void mdctEqBenchmark(void);
+uint32_t mdctEqGetCycles(uint8_t path);
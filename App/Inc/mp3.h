@@ -34,6 +34,7 @@
 #define VOICE_STATE_PLAYING		1
 #define VOICE_STATE_PAUSED		2
 #define VOICE_STATE_STOPPED		3
+#define VOICE_STATE_READY		4		// Opened and primed, waiting for a batch
 
 #define WAV_FORMAT_FIXED		0
 #define WAV_FORMAT_FLOAT		1
@@ -66,22 +67,31 @@ typedef struct {
 
 	uint8_t state;					// Voice state
 	uint8_t noteNum;				// MIDI Note number or 0xff if none
-	bool loopFlag;
+	bool loopFlag;					// Rewind to loopStart at end of file
 	bool lockFlag;					// Voice lock flag
 	bool stopReqFlag;				// Stop request flag
 	bool eofFlag;					// End of file flag
+	bool decodeDoneFlag;			// Decoder finished flag
+	uint8_t numChannels;			// Wav buffer channels (1 = mono)
 	
 	FILE_SIZE size;					// File size in bytes
 	uint32_t bytesSdRead;			// Number of bytes read from SD file
 	uint32_t bytesFetched;			// Number of bytes fetched by decoder
+	uint32_t loopStart;				// File offset of the audio, past any ID3 tag
+	uint8_t loopsPending;			// Rewinds read but not yet fetched
+	uint16_t loopCount;				// Times the decoder has looped
 	
 	uint32_t framesPlayed;
 		
 	uint8_t currGainIdx;			// Current gain index
+	int8_t gainOffsetDb;			// Loudness normalization offset
 	q15_t currGain;					// Current linear gain
+	uint8_t pan;					// Pan position (0 - 128, 64 = center)
+	q31_t currGainLR;				// Current packed left/right gains
 	uint16_t releaseMs;				// Release time in ms
 		
 	uint16_t track;					// Track number
+	uint8_t priority;				// Voice priority, higher is kept longer
 	uint32_t time;					// Trigger timestamp
 	
 	uint16_t mp3InPtr;				// Mp3 buffer input pointer
@@ -97,9 +107,12 @@ typedef struct {
 
 // Function prototypes for this module
 
-uint16_t mp3OpenFile(uint8_t v, uint16_t t, int16_t gainDb);
+uint16_t mp3OpenFile(uint8_t v, uint16_t t, int16_t gainDb, bool loop);
 void mp3SetCurrentGain(uint8_t v, int16_t gain);
 void mp3SetState(uint8_t v, uint8_t s);
+void mp3SetPitch(uint8_t v, int16_t cents);
+void mp3SetPan(uint8_t v, uint8_t pan);
+uint32_t mp3GetRunwayFrames(uint8_t v);
 uint8_t mp3GetState(uint8_t v);
 void mp3MarkTime(uint8_t v);
 void mp3Stop(uint8_t v);
@@ -114,7 +127,11 @@ int16_t mp3ReadSdMp3Data(uint8_t v);
 uint16_t mp3FetchMp3Data(uint8_t v, uint8_t *pDest, uint16_t reqBytes);
 
 bool mp3CheckWavSpace(uint8_t v);
+uint16_t mp3GetWavSamples(uint8_t v);
+uint16_t mp3ReadWavFrames(uint8_t v, q15_t * pDstL, q15_t * pDstR, uint16_t numFrames);
 int16_t mp3DecodeWavData(uint8_t v);
 bool mp3PutWavData(uint8_t v, q15_t *pSrc, uint16_t numFrames);
 
-bool mp3GetAudio(uint8_t v, q15_t * pDest, uint16_t reqFrames);
+bool mp3GetAudio(uint8_t v, q31_t * pDest, uint16_t reqFrames);
+uint32_t mp3GetUnderruns(void);
+uint16_t mp3GetLoops(uint8_t v);
@@ -30,5 +30,6 @@
 // Function prototypes for this module
 
 void mp3DecodeInit(void);
+void mp3DecodeReset(uint8_t v);
 int16_t mp3DecodeNewData(uint8_t v);
 
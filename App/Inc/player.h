@@ -43,6 +43,14 @@
 
 #define MAX_NUM_MP3_VOICES		2
 
+// Each track keeps a byte wide map of the voices playing it
+
+#if (MAX_NUM_MP3_VOICES > 8)
+#error "MAX_NUM_MP3_VOICES must be 8 or less"
+#endif
+
+#define AUDIO_SAMPLE_RATE		44100
+
 #define MIX_BUFF_FRAMES			128
 #define MIX_BUFF_SAMPLES		(MIX_BUFF_FRAMES * 2)
 #define AUDIO_BUFF_SAMPLES		(MIX_BUFF_SAMPLES * 2)
@@ -64,6 +72,7 @@
 #define LED_FLASH_PERIOD_LONG	1000		// Heartbeat flash period in msecs
 #define LED_FLASH_PERIOD_SHORT	500			// Warning flash period in msecs
 #define SD_CARD_CHECK_PERIOD	100			// Cycle to check for SD card install
+#define SD_TEST_LOW_POWER_TICK_MS	10		// Tick period when idle in low power
 
 // Helper type for dealing with endiness
 
@@ -85,18 +94,32 @@ typedef union
 #include <stdio.h>
 #include "arm_math.h"
 #include "bios.h"
+#include "voiceq.h"
 #include "voice.h"
 #include "mp3decode.h"
 #include "mp3.h"
+#include "resample.h"
+#include "ffdisk.h"
 #include "track.h"
 #include "dsp.h"
-#include "ffdisk.h"
+#include "profile.h"
+#include "eq.h"
+#include "mdcteq.h"
+#include "loud.h"
+#include "audio.h"
+#include "trigger.h"
+#include "action.h"
+#include "proto.h"
+#include "telem.h"
+#include "rtos.h"
 #include "console.h"
 
 // ****************************************************************************
 // Function prototypes
 void sdTestInit(void);
 void sdTestProcess(void);
+void sdTestSetLowPower(bool enable);
+bool sdTestGetLowPower(void);
 void delayMs(uint32_t dlyTicks);
 void doBlink(uint8_t p);
 void doFlash(uint8_t repeat);
@@ -0,0 +1,83 @@
+// ****************************************************************************
+//     Filename: PROFILE.H
+// Date Created: 10/19/2026
+//
+//     Comments: Cycle profiler header for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+// Profiler slots. Each one times a section of the audio path with the DWT
+//  cycle counter.
+
+#define PROF_AUDIO				0		// Whole audio buffer interrupt
+#define PROF_VOICE_MIX			1		// Voice mix into the master bus
+#define PROF_MASTER_EQ			2		// Master bus parametric EQ
+#define PROF_MDCT_EQ			3		// Voice MDCT EQ, per granule and channel
+#define PROF_DECODE				4		// One MP3 frame decode in the main loop
+#define PROF_OUTPUT				5		// Dither and 24-bit output conversion
+#define PROF_CONSOLE			6		// Console command table lookup
+#define PROF_SD_READ			7		// One voice block read from the SD card
+#define PROF_NUM_SLOTS			8
+
+// The CPU load meter adds up the audio interrupt and decode cycles over
+//  this window. Audio interrupts that land inside a timed section are taken
+//  back out of it, so they're only counted once.
+
+#define PROF_LOAD_WINDOW_MS		100
+
+typedef struct {
+	uint32_t start;				// Cycle count at section start
+	uint32_t last;				// Cycles used the last time through
+	uint32_t peak;				// Most cycles used since reset
+	uint64_t total;				// Cycles used since reset
+	uint32_t count;				// Times through since reset
+	uint32_t window;			// Cycles used in this load window
+	uint32_t audio;				// Audio interrupt cycles at section start
+} PROFILE_STRUCTURE;
+
+// Worst case latency of each execution tier, in cycles. For the audio
+//  interrupt it's how far the I2S DMA has got into the next half of the
+//  buffer when the interrupt starts, for the decode tier it's from when it
+//  was pended to when it runs, and for the main loop it's the time for one
+//  pass.
+
+#define LAT_AUDIO				0
+#define LAT_DECODE				1
+#define LAT_LOOP				2
+#define LAT_NUM_TIERS			3
+
+// Function prototypes for this module
+
+void profileReset(void);
+void profileService(void);
+uint8_t profileGetLoad(void);
+void profileIdle(uint32_t us);
+uint8_t profileGetIdle(void);
+void profileStart(uint8_t slot);
+void profileEnd(uint8_t slot);
+const char * profileGetName(uint8_t slot);
+uint32_t profileGetLast(uint8_t slot);
+uint32_t profileGetPeak(uint8_t slot);
+uint32_t profileGetAverage(uint8_t slot);
+void profileLatency(uint8_t tier, uint32_t cycles);
+const char * profileGetLatencyName(uint8_t tier);
+uint32_t profileGetLatencyLast(uint8_t tier);
+uint32_t profileGetLatencyPeak(uint8_t tier);
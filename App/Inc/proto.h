@@ -0,0 +1,81 @@
+// ****************************************************************************
+//     Filename: PROTO.H
+// Date Created: 10/19/2026
+//
+//     Comments: Binary serial protocol header for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+// Binary frames share the serial port with the ASCII console. A frame starts
+//  with PROTO_SOF, which never appears in a console line:
+//
+//    SOF, len, seq, payload[len], crcHi, crcLo
+//
+//  The CRC is CRC-16/CCITT over len, seq and the payload. The payload is a
+//  batch of commands, each an opcode followed by its fixed size arguments,
+//  with 16-bit values little endian. The whole batch is checked before any
+//  of it is applied, so a frame is applied completely or not at all. Every
+//  frame is answered with an ACK frame carrying the same sequence number. A
+//  frame with the same sequence number as the last one applied is assumed
+//  to be a retry, and is acknowledged without being applied again.
+
+#define PROTO_SOF				0xf0
+#define PROTO_MAX_PAYLOAD		64
+#define PROTO_FRAME_TIMEOUT_MS	20
+
+#define PROTO_CMD_PLAY			0x01	// track16, gainDb, pan, attackMs16, flags, priority
+#define PROTO_CMD_STOP			0x02	// track16, releaseMs16
+#define PROTO_CMD_STOP_ALL		0x03	// none
+#define PROTO_CMD_TRIGGER		0x04	// trigger
+#define PROTO_CMD_FADE_ALL		0x05	// releaseMs16
+#define PROTO_CMD_TELEM			0x06	// periodMs16, 0 = off
+#define PROTO_RSP_ACK			0x80	// status
+#define PROTO_RSP_TELEM			0x81	// See telem.h
+
+#define PROTO_PLAY_FLAG_LOOP	0x01
+#define PROTO_PLAY_FLAG_LOCK	0x02
+
+#define PROTO_OK				0
+#define PROTO_ERR_CRC			1
+#define PROTO_ERR_CMD			2
+#define PROTO_ERR_BATCH			3		// Too many starts and stops for one batch
+#define PROTO_ERR_BUSY			4		// Last batch not out yet, not applied
+
+// Autobaud. When receive errors show up the port hunts through the rates
+//  below until it receives PROTO_AUTOBAUD_COUNT sync bytes in a row, then
+//  echoes a sync byte back at the new rate.
+
+#define PROTO_AUTOBAUD_SYNC		0x55
+#define PROTO_AUTOBAUD_COUNT	4
+#define PROTO_AUTOBAUD_ERRORS	4
+#define PROTO_AUTOBAUD_DWELL_MS	50
+#define PROTO_NUM_BAUD_RATES	9
+
+// Function prototypes for this module
+
+void protoInit(void);
+bool protoRxByte(uint8_t c);
+void protoService(void);
+void protoSetAutobaud(bool enable);
+bool protoGetAutobaud(void);
+bool protoSetBaud(uint32_t baud);
+uint16_t protoCrc16(uint16_t crc, uint8_t * pData, uint16_t len);
+bool protoSendFrame(uint8_t seq, uint8_t * pPayload, uint8_t len);
@@ -0,0 +1,80 @@
+// ****************************************************************************
+//     Filename: RESAMPLE.H
+// Date Created: 10/19/2026
+//
+//     Comments: Sample rate converter header for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+// Resampler quality tiers
+
+#define RS_QUALITY_LINEAR		0		// 2-tap linear interpolation
+#define RS_QUALITY_CUBIC		1		// 4-tap cubic interpolation, 128 phases
+#define RS_QUALITY_MEDIUM		2		// 8-tap polyphase FIR, 32 phases
+#define RS_QUALITY_HIGH			3		// 16-tap polyphase FIR, 64 phases
+#define RS_NUM_QUALITIES		4
+
+#define RS_DEFAULT_QUALITY		RS_QUALITY_MEDIUM
+
+#define RS_MAX_TAPS				16
+
+// The largest phase increment we support is 2.0, so a block never needs
+//  more than twice its length in input frames, plus the filter taps.
+
+#define RS_MAX_INC				(2 * UNITY_PITCH_INC)
+#define RS_HIST_LEN				((2 * MIX_BUFF_FRAMES) + RS_MAX_TAPS + 2)
+
+// FIR cutoff relative to the source Nyquist frequency. Low enough to keep
+//  48kHz files from aliasing into the 44.1kHz output.
+
+#define RS_CUTOFF				0.90f
+
+// Pitch offset range in cents
+
+#define RS_MAX_CENTS			700
+
+// The following structure defines a voice's resampler
+
+typedef struct {
+	bool active;				// Resampler in use flag
+	bool running;				// Output has been produced flag
+	uint8_t quality;			// Quality tier
+	uint8_t numTaps;			// Filter length for this tier
+	uint16_t histFrames;		// Number of valid frames in the history
+	int16_t cents;				// Pitch offset in cents
+	uint32_t baseInc;			// 16.16 sample rate ratio
+	uint32_t inc;				// 16.16 input frames per output frame
+	uint32_t phase;				// 16.16 position of the next output frame
+	q15_t histL[RS_HIST_LEN] __attribute__((aligned (4)));	// Left / mono input history
+	q15_t histR[RS_HIST_LEN] __attribute__((aligned (4)));	// Right input history
+} RESAMPLE_STRUCTURE;
+
+// Function prototypes for this module
+
+void resampleInit(void);
+void resampleReset(RESAMPLE_STRUCTURE * pRs, uint32_t srcRate, uint8_t quality);
+void resampleSetPitch(RESAMPLE_STRUCTURE * pRs, int16_t cents);
+uint16_t resampleGetInputFrames(RESAMPLE_STRUCTURE * pRs, uint16_t numFrames);
+void resampleProcess(RESAMPLE_STRUCTURE * pRs, q15_t * pDst, uint16_t numFrames, uint8_t nCh);
+void resampleBenchmark(void);
+uint32_t resampleGetCycles(uint8_t quality);
+void resampleSetQuality(uint8_t quality);
+uint8_t resampleGetQuality(void);
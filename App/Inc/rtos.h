@@ -0,0 +1,70 @@
+// ****************************************************************************
+//     Filename: RTOS.H
+// Date Created: 10/19/2026
+//
+//     Comments: RTOS port header for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+// Optional RTOS port, built with the PLAYER_RTOS CMake option
+//  against any kernel with the CMSIS-RTOS2 API. The audio mix stays in the
+//  I2S DMA interrupt. The rest of the player runs in three threads:
+//
+//    SD I/O   - tops up the voices' MP3 buffers from the card
+//    Decode   - decodes into the voices' wav buffers
+//    Control  - the console, protocol, triggers and housekeeping, which is
+//               the bare metal main loop
+//
+//  The audio interrupt wakes the SD I/O thread when a voice's wav buffer has
+//  room, which wakes the decode thread when it's done. SD transfers block
+//  the calling thread on a flag set by the SDIO DMA completion. FatFs and
+//  the decoder output buffer are shared under a recursive mutex. All kernel
+//  objects are statically allocated.
+//
+//  The kernel owns the SVC, PendSV and SysTick handlers, so the ones in
+//  stm32f4xx_it.c are left out of RTOS builds. The player's 1ms tick and
+//  the HAL tick come from a kernel timer instead, and the player is
+//  initialized in the control thread once that's running. Before then the
+//  HAL polls SysTick for its timeouts.
+
+#define RTOS_FLAG_SDIO			0x0001	// Top up the MP3 buffers
+#define RTOS_FLAG_DECODE		0x0002	// Decode into the wav buffers
+#define RTOS_FLAG_SD_DONE		0x0004	// SD card DMA transfer complete
+
+#define RTOS_SDIO_STACK			2048
+#define RTOS_DECODE_STACK		4096
+#define RTOS_CONTROL_STACK		4096
+
+// Control block sizes. The CMSIS-RTOS2 API leaves these to the kernel, so
+//  they're set big enough for RTX5 and FreeRTOS.
+
+#define RTOS_THREAD_CB_SIZE		128
+#define RTOS_OBJECT_CB_SIZE		96
+
+// Function prototypes for this module
+
+void rtosStart(void);
+bool rtosRunning(void);
+void rtosSignal(uint32_t flags);
+void rtosWaitSd(void);
+void rtosDiskLock(void);
+void rtosDiskUnlock(void);
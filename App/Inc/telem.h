@@ -0,0 +1,74 @@
+// ****************************************************************************
+//     Filename: TELEM.H
+// Date Created: 10/19/2026
+//
+//     Comments: Telemetry header for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+// Telemetry. Once subscribed, a status frame goes out over the serial port
+//  every period. It's an ordinary binary protocol frame, with a sequence
+//  number that counts up by one per frame so the host can spot lost ones.
+//  The payload, with 16 and 32-bit values little endian, is:
+//
+//    PROTO_RSP_TELEM, cpuLoad%, numVoices, 0, msTicks32, underruns32,
+//    sdLastUs16, sdPeakUs16
+//
+//  followed by one entry per voice:
+//
+//    state, gainIdx, track16, framesPlayed32, mp3Bytes16, wavSamples16
+//
+//  The audio interrupt takes the snapshot at a buffer boundary into one of
+//  two buffers, so the main loop never formats one that's half updated.
+
+#define TELEM_HEADER_BYTES		16
+#define TELEM_VOICE_BYTES		12
+#define TELEM_MIN_PERIOD_MS		10
+#define TELEM_MAX_PERIOD_MS		60000
+
+typedef struct {
+	uint8_t state;
+	uint8_t gainIdx;
+	uint16_t track;
+	uint32_t framesPlayed;
+	uint16_t mp3Bytes;				// Undecoded bytes in the mp3 buffer
+	uint16_t wavSamples;			// Decoded samples in the wav buffer
+} TELEM_VOICE_STRUCTURE;
+
+typedef struct {
+	uint32_t msTicks;
+	uint32_t underruns;
+	uint32_t sdLastCycles;
+	uint32_t sdPeakCycles;
+	uint8_t cpuLoad;
+	TELEM_VOICE_STRUCTURE voice[MAX_NUM_MP3_VOICES];
+} TELEM_SNAPSHOT_STRUCTURE;
+
+// Function prototypes for this module
+
+void telemInit(void);
+void telemSnapshot(void);
+void telemService(void);
+bool telemBusy(void);
+bool telemSetPeriod(uint16_t periodMs);
+uint16_t telemGetPeriod(void);
+uint32_t telemGetDrops(void);
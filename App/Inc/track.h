@@ -36,17 +36,62 @@
 #define TRACK_FLAG_LOCK			0x20
 #define TRACK_FLAG_MP3			0x10
 
+// Bit definitions for the track info flag byte
+
+#define TRACK_INFO_PROBED		0x80
+#define TRACK_INFO_VALID		0x40
+#define TRACK_INFO_VBR			0x20
+#define TRACK_INFO_LOUD			0x10		// Loudness has been measured
+
+// The track info format byte holds the sample rate index in the low nibble
+//  and the MPEG channel mode in bits 4-5
+
+#define TRACK_INFO_SR_MASK		0x0f
+#define TRACK_INFO_MODE_SHIFT	4
+#define TRACK_INFO_MODE_MASK	0x03
+
+#define TRACK_MODE_STEREO		0
+#define TRACK_MODE_JOINT		1
+#define TRACK_MODE_DUAL			2
+#define TRACK_MODE_MONO			3
+
+#define TRACK_NUM_SAMPLE_RATES	9
+
 // The following structure defines a track
 
 #pragma pack(1)
 typedef struct {
 	uint8_t flags;				// Flags
-	uint8_t dummy;				// 
+	uint8_t voices;				// Bit map of the voices playing this track
 	FILE_SIZE fileSize;			// File size
+	uint16_t dirIndex;			// Entry index of the file in the SOUNDS directory
 } TRACK_STRUCTURE;
 #pragma pack()
 
+// The following structure holds the header probe results for a track. It's
+//  kept compact since there's one for every possible track.
+
+#pragma pack(1)
+typedef struct {
+	uint8_t flags;				// Track info flags
+	uint8_t format;				// Sample rate index and channel mode
+	uint16_t bitrateKbps;		// Bitrate in kbps (average if VBR)
+	uint32_t numFrames;			// Number of MP3 frames in the file
+	int8_t loudness;			// Integrated loudness in LUFS
+} TRACK_INFO_STRUCTURE;
+#pragma pack()
+
 // Function prototypes for this module
 
 bool trackInit(uint16_t * tnum);
+bool trackOpen(uint16_t t, FIL * fp);
+bool trackProbe(uint16_t t);
+uint32_t trackGetId3Bytes(const uint8_t * p, uint32_t len);
+void trackProbeService(void);
+bool trackProbeBusy(void);
+TRACK_INFO_STRUCTURE * trackGetInfo(uint16_t t);
+uint32_t trackGetSampleRate(uint16_t t);
+uint8_t trackGetChannels(uint16_t t);
+uint32_t trackGetDurationMs(uint16_t t);
+bool trackSetMode(uint16_t t, bool loop, bool lock);
 
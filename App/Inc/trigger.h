@@ -0,0 +1,65 @@
+// ****************************************************************************
+//     Filename: TRIGGER.H
+// Date Created: 10/19/2026
+//
+//     Comments: Trigger input header for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+// The trigger inputs are the pins of one GPIO port, sampled all at once by
+//  DMA from the port input register. Trigger n is port pin n. Only the pins
+//  in TRIG_PIN_MASK are used - on this board that's the BUTT input, which
+//  makes it trigger 1. Additional pins need to be configured as inputs with
+//  pull-ups and added to the mask. Triggers are active low.
+
+#define TRIG_GPIO_Port			BUTT_GPIO_Port
+#define TRIG_PIN_MASK			BUTT_Pin
+#define MAX_NUM_TRIGGERS		16
+
+// The port is sampled at TRIG_SAMPLE_RATE into a circular buffer. An input
+//  has to read the same for 4 samples in a row to change state, so the
+//  debounce time is 1ms.
+
+#define TRIG_SAMPLE_RATE		4000
+#define TRIG_BUFF_SAMPLES		64
+
+#define TRIG_EVENT_QUEUE_SIZE	16
+
+#define TRIG_EDGE_RELEASE		0
+#define TRIG_EDGE_PRESS			1
+
+// A trigger event. The time is in trigger sample clock ticks.
+
+typedef struct {
+	uint32_t time;
+	uint8_t trig;
+	uint8_t edge;
+} TRIGGER_EVENT_STRUCTURE;
+
+// Function prototypes for this module
+
+void triggerInit(void);
+void triggerScan(void);
+void triggerService(void);
+bool triggerBusy(void);
+uint16_t triggerGetState(void);
+uint32_t triggerGetTime(void);
+uint32_t triggerGetDropped(void);
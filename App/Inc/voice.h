@@ -22,12 +22,68 @@
 #define VOICE_STATE_PLAYING		1
 #define VOICE_STATE_PAUSED		2
 #define VOICE_STATE_STOPPED		3
+#define VOICE_STATE_READY		4		// Opened and primed, waiting for a batch
 
 
+// Voice stealing policies, used when a track is triggered and there are no
+//  free voices. Locked voices are never stolen.
+
+#define VOICE_STEAL_OLDEST		0		// Steal the voice started longest ago
+#define VOICE_STEAL_QUIETEST	1		// Steal the voice with the lowest gain
+#define VOICE_STEAL_PRIORITY	2		// Steal the lowest priority, then oldest
+#define VOICE_STEAL_RETRIGGER	3		// Retrigger the same track, else oldest
+#define VOICE_NUM_POLICIES		4
+
+#define VOICE_STEAL_FADE_MS		3		// Fade out time for a stolen voice
+
+#define VOICE_NO_VOICE			0xff
+
+// A track start waiting for its voice. Starts are queued by the trigger
+//  path and carried out by voicesService, which does the SD card work, once
+//  the voice is free.
+
+typedef struct {
+	uint16_t track;
+	int16_t gainDb;
+	uint8_t pan;
+	uint8_t priority;
+	uint16_t attackMs;
+	int16_t cents;
+	bool loop;
+	bool lock;
+} VOICE_START_STRUCTURE;
+
+// Batches. Between voicesBatchBegin and voicesBatchCommit, starts and stops
+//  are collected instead of queued. Once every start in the batch has its
+//  file open and its first frames decoded, the whole list is queued at once,
+//  so the audio interrupt applies all of it in the same buffer. A batch that
+//  overflows is dropped whole when it's committed.
+
+#define VOICE_BATCH_SIZE		16
+
 // Function prototypes for this module
 
 void voicesInit(void);
 void voicesStopAll(void);
+void voicesFadeAll(uint16_t releaseMs);
 void voicesService(void);
+void voicesDecode(void);
+void voicesRefill(void);
+void voicesDecodeKick(void);
+void voicesDecodeLock(void);
+void voicesDecodeUnlock(void);
 uint8_t voicesCheck(void);
+bool voicesBusy(void);
+bool voicesIdle(void);
+uint8_t voicesAllocate(uint16_t t);
+uint8_t voicesPlayTrack(uint16_t t, int16_t gainDb, uint8_t pan, uint16_t attackMs,
+						int16_t cents, bool loop, bool lock, uint8_t priority);
+void voicesSetStealPolicy(uint8_t policy);
+uint8_t voicesGetStealPolicy(void);
+void voicesStopTrack(uint16_t t, uint16_t releaseMs);
+bool voicesIsTrackPlaying(uint16_t t);
+void voicesMix(q31_t * pBus);
+bool voicesBatchBegin(void);
+bool voicesBatchCommit(void);
+bool voicesBatchIsOpen(void);
 
@@ -0,0 +1,53 @@
+// ****************************************************************************
+//     Filename: VOICEQ.H
+// Date Created: 10/19/2026
+//
+//     Comments: Voice command queue header for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+// Once a voice is playing, the audio interrupt owns its audio state. The
+//  main loop starts, stops and fades playing voices by putting commands on a
+//  single producer, single consumer queue that the audio interrupt empties
+//  at the top of each buffer. Neither side ever blocks the other. The queue
+//  only needs the standard types and __DMB(), so the host tests build it
+//  unchanged.
+
+#define VOICE_QUEUE_SIZE		32		// Must be a power of 2
+
+#define VOICE_CMD_STOP			0		// Stop voice at the end of this buffer
+#define VOICE_CMD_FADE			1		// Fade out voice over ms and stop
+#define VOICE_CMD_START			2		// Start a voice that's READY
+
+typedef struct {
+	uint8_t cmd;
+	uint8_t voice;
+	uint16_t ms;
+} VOICE_CMD_STRUCTURE;
+
+// Function prototypes for this module
+
+void voiceQueueInit(void);
+uint8_t voiceQueueFree(void);
+void voiceQueuePut(uint8_t cmd, uint8_t v, uint16_t ms);
+void voiceQueuePublish(void);
+bool voiceQueueGet(VOICE_CMD_STRUCTURE * pCmd);
@@ -0,0 +1,308 @@
+// ****************************************************************************
+//     Filename: ACTION.C
+// Date Created: 10/19/2026
+//
+//     Comments: Trigger action map for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+#include "player.h"
+
+
+// ****************************************************************************
+// Global variables
+
+ACTION_STRUCTURE actionMap[MAX_NUM_TRIGGERS];
+
+static const char * actionNames[ACTION_NUM_TYPES] = {
+	"NONE", "PLAY", "STOP", "TOGGLE", "LOOP", "XFADE"
+};
+
+
+//*****************************************************************************
+// actionSkipSpace
+//*****************************************************************************
+static char * actionSkipSpace(char * p) {
+
+	while ((*p == ' ') || (*p == 0x09))
+		p++;
+	return p;
+}
+
+
+//*****************************************************************************
+// actionGetValue
+//*****************************************************************************
+// Reads a signed decimal value at p, followed by a comma or the end of the
+//  line. Returns a pointer past the value, or NULL if there isn't one.
+//*****************************************************************************
+static char * actionGetValue(char * p, int32_t * val) {
+
+int32_t iSign = 1;
+int32_t iVal = 0;
+int n = 0;
+
+	p = actionSkipSpace(p);
+	if (*p == '-') {
+		iSign = -1;
+		p++;
+	}
+	while ((*p >= '0') && (*p <= '9')) {
+		iVal = (iVal * 10) + (*p++ - '0');
+		n++;
+	}
+	if (n == 0)
+		return NULL;
+	p = actionSkipSpace(p);
+	if (*p == ',')
+		p++;
+	*val = iVal * iSign;
+	return p;
+}
+
+
+//*****************************************************************************
+// actionGetType
+//*****************************************************************************
+// Matches the action name at p, in any case. Returns a pointer past the name
+//  and its comma, or NULL if it isn't one we know.
+//*****************************************************************************
+static char * actionGetType(char * p, uint8_t * type) {
+
+char word[8];
+uint8_t n = 0;
+uint8_t i;
+
+	p = actionSkipSpace(p);
+	while ((n < (sizeof(word) - 1)) && (((*p | 0x20) >= 'a') && ((*p | 0x20) <= 'z')))
+		word[n++] = *p++ & ~0x20;
+	word[n] = 0;
+	for (i = 0; i < ACTION_NUM_TYPES; i++) {
+		if (strcmp(word, actionNames[i]) == 0) {
+			p = actionSkipSpace(p);
+			if (*p == ',')
+				p++;
+			*type = i;
+			return p;
+		}
+	}
+	return NULL;
+}
+
+
+//*****************************************************************************
+// actionParseLine
+//*****************************************************************************
+// Parses one line of INIT.TXT into the map. Lines that aren't a #TRIG entry
+//  are ignored, as are entries with bad values.
+//*****************************************************************************
+static void actionParseLine(char * p) {
+
+ACTION_STRUCTURE action;
+int32_t trig;
+int32_t val;
+uint8_t type;
+
+	p = actionSkipSpace(p);
+	if (strncmp(p, "#TRIG", 5) != 0)
+		return;
+	if ((p = actionGetValue(p + 5, &trig)) == NULL)
+		return;
+	if ((trig < 0) || (trig >= MAX_NUM_TRIGGERS))
+		return;
+	if ((p = actionGetType(p, &type)) == NULL)
+		return;
+	
+	action.type = type;
+	action.reserved = 0;
+	action.track = 0;
+	action.gainDb = 0;
+	action.fadeMs = 0;
+	if ((p = actionGetValue(p, &val)) != NULL) {
+		if ((val < 0) || (val >= MAX_NUM_TRACKS))
+			return;
+		action.track = val;
+		if ((p = actionGetValue(p, &val)) != NULL) {
+			if ((val < MIN_GAIN_DB) || (val > MAX_GAIN_DB))
+				return;
+			action.gainDb = val;
+			if ((p = actionGetValue(p, &val)) != NULL) {
+				if ((val < 0) || (val > 30000))
+					return;
+				action.fadeMs = val;
+			}
+		}
+	}
+	actionMap[trig] = action;
+}
+
+
+//*****************************************************************************
+// actionLoadCache
+//*****************************************************************************
+// Loads the map from INIT.BIN if it was made from this INIT.TXT.
+//*****************************************************************************
+static bool actionLoadCache(FILINFO * pInfo) {
+
+FIL fil;
+UINT br;
+ACTION_CACHE_HEADER header;
+bool ok = false;
+
+	if (f_open(&fil, ACTION_CACHE_NAME, FA_READ) != FR_OK)
+		return false;
+	if ((f_read(&fil, &header, sizeof(header), &br) == FR_OK) && (br == sizeof(header)) &&
+		(header.mark == ACTION_CACHE_MARK) && (header.textSize == pInfo->fsize) &&
+		(header.textDate == pInfo->fdate) && (header.textTime == pInfo->ftime)) {
+		if ((f_read(&fil, actionMap, sizeof(actionMap), &br) == FR_OK) && (br == sizeof(actionMap)))
+			ok = true;
+	}
+	f_close(&fil);
+	return ok;
+}
+
+
+//*****************************************************************************
+// actionSaveCache
+//*****************************************************************************
+static void actionSaveCache(FILINFO * pInfo) {
+
+FIL fil;
+UINT bw;
+ACTION_CACHE_HEADER header;
+
+	if (f_open(&fil, ACTION_CACHE_NAME, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+		return;
+	header.mark = ACTION_CACHE_MARK;
+	header.textSize = pInfo->fsize;
+	header.textDate = pInfo->fdate;
+	header.textTime = pInfo->ftime;
+	if (f_write(&fil, &header, sizeof(header), &bw) == FR_OK)
+		f_write(&fil, actionMap, sizeof(actionMap), &bw);
+	f_close(&fil);
+}
+
+
+//*****************************************************************************
+// actionInit
+//*****************************************************************************
+// Builds the trigger map, from the cache if INIT.TXT hasn't changed and from
+//  INIT.TXT otherwise. Must be called after trackInit().
+//*****************************************************************************
+void actionInit(void) {
+
+uint8_t n;
+FIL fil;
+DIR dir;
+FILINFO fInfo;
+char line[ACTION_LINE_LEN];
+
+	for (n = 0; n < MAX_NUM_TRIGGERS; n++) {
+		actionMap[n].type = ACTION_PLAY;
+		actionMap[n].reserved = 0;
+		actionMap[n].track = n;
+		actionMap[n].gainDb = 0;
+		actionMap[n].fadeMs = 0;
+	}
+
+	if ((f_findfirst(&dir, &fInfo, "", ACTION_TEXT_NAME) != FR_OK) || (fInfo.fname[0] == 0))
+		return;
+	f_closedir(&dir);
+	if (actionLoadCache(&fInfo))
+		return;
+	
+	if (f_open(&fil, ACTION_TEXT_NAME, FA_READ) != FR_OK)
+		return;
+	while (f_gets(line, ACTION_LINE_LEN, &fil) != NULL)
+		actionParseLine(line);
+	f_close(&fil);
+	actionSaveCache(&fInfo);
+}
+
+
+//*****************************************************************************
+// actionDispatch
+//*****************************************************************************
+// Carries out the action mapped to a trigger event. Only presses do anything
+//  for now.
+//*****************************************************************************
+void actionDispatch(uint8_t trig, uint8_t edge) {
+
+ACTION_STRUCTURE * pAction;
+
+	if ((trig >= MAX_NUM_TRIGGERS) || (edge != TRIG_EDGE_PRESS))
+		return;
+	pAction = &actionMap[trig];
+	
+	switch (pAction->type) {
+	
+		case ACTION_PLAY:
+			voicesPlayTrack(pAction->track, pAction->gainDb, PAN_CENTER, pAction->fadeMs,
+							0, false, false, 0);
+		break;
+		
+		case ACTION_STOP:
+			voicesStopTrack(pAction->track, pAction->fadeMs);
+		break;
+		
+		case ACTION_TOGGLE:
+		case ACTION_LOOP:
+			if (voicesIsTrackPlaying(pAction->track))
+				voicesStopTrack(pAction->track, pAction->fadeMs);
+			else
+				voicesPlayTrack(pAction->track, pAction->gainDb, PAN_CENTER, pAction->fadeMs,
+								0, (pAction->type == ACTION_LOOP), false, 0);
+		break;
+		
+		case ACTION_XFADE:
+			voicesFadeAll(pAction->fadeMs);
+			voicesPlayTrack(pAction->track, pAction->gainDb, PAN_CENTER, pAction->fadeMs,
+							0, false, false, 0);
+		break;
+		
+		default:
+		break;
+	}
+}
+
+
+//*****************************************************************************
+// actionSet
+//*****************************************************************************
+bool actionSet(uint8_t trig, ACTION_STRUCTURE * pAction) {
+
+	if ((trig >= MAX_NUM_TRIGGERS) || (pAction->type >= ACTION_NUM_TYPES) ||
+		(pAction->track >= MAX_NUM_TRACKS))
+		return false;
+	actionMap[trig] = *pAction;
+	return true;
+}
+
+
+//*****************************************************************************
+// actionGet
+//*****************************************************************************
+ACTION_STRUCTURE * actionGet(uint8_t trig) {
+
+	if (trig >= MAX_NUM_TRIGGERS)
+		return NULL;
+	return &actionMap[trig];
+}
@@ -0,0 +1,91 @@
+// ****************************************************************************
+//     Filename: AUDIO.C
+// Date Created: 10/19/2026
+//
+//     Comments: Audio output for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+#include "player.h"
+
+
+// ****************************************************************************
+// External variables
+
+extern q31_t gMixBus[];					// Our stereo master mix bus
+extern uint32_t gAudioBuff[];			// Our I2S DMA output buffer
+
+
+//*****************************************************************************
+// audioInit
+//*****************************************************************************
+// Starts the I2S output. The DMA runs circular over two mix buffers worth
+//  of samples, and each half is refilled by audioService when the DMA
+//  moves on to the other half.
+//*****************************************************************************
+void audioInit(void) {
+
+	memset((uint8_t *)gMixBus, 0, MIX_BUFF_SAMPLES * sizeof(q31_t));
+	memset((uint8_t *)gAudioBuff, 0, AUDIO_BUFF_SAMPLES * sizeof(uint32_t));
+	biosAudioStart(gAudioBuff, AUDIO_BUFF_SAMPLES);
+}
+
+
+//*****************************************************************************
+// audioService
+//*****************************************************************************
+// Called from the I2S DMA half and full transfer interrupts to debounce the
+//  trigger inputs and mix the next buffer into half 0 or 1 of the output
+//  buffer. Telemetry snapshots are taken between the mix and the master EQ.
+//*****************************************************************************
+void audioService(uint8_t half) {
+
+uint16_t n;
+
+	profileStart(PROF_AUDIO);
+
+	// Measure how far the DMA has got into the half it's now sending
+	n = biosAudioGetIndex(AUDIO_BUFF_SAMPLES);
+	if (half == 0)
+		n = (n >= MIX_BUFF_SAMPLES) ? (n - MIX_BUFF_SAMPLES) : (n + MIX_BUFF_SAMPLES);
+	profileLatency(LAT_AUDIO, (n / 2) * (SystemCoreClock / AUDIO_SAMPLE_RATE));
+
+	triggerScan();
+
+	arm_fill_q31(0, gMixBus, MIX_BUFF_SAMPLES);
+
+	profileStart(PROF_VOICE_MIX);
+	voicesMix(gMixBus);
+	profileEnd(PROF_VOICE_MIX);
+
+	telemSnapshot();
+
+	profileStart(PROF_MASTER_EQ);
+	eqProcess(gMixBus, MIX_BUFF_FRAMES);
+	profileEnd(PROF_MASTER_EQ);
+
+	profileStart(PROF_OUTPUT);
+	dspOutput24(&gAudioBuff[half * MIX_BUFF_SAMPLES], gMixBus, MIX_BUFF_FRAMES);
+	profileEnd(PROF_OUTPUT);
+
+	profileEnd(PROF_AUDIO);
+}
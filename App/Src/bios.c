@@ -39,6 +39,7 @@ extern volatile uint16_t gNumWavTracks;		// Number of WAV tracks found on SD car
 extern volatile uint8_t gSysFlags;			// System init error flags
 
 extern SD_HandleTypeDef hsd;
+extern I2S_HandleTypeDef hi2s2;
 
 extern uint8_t gSectorBuff[];
 
@@ -58,13 +59,22 @@ HAL_SD_CardInfoTypeDef pCardInfo;
 // Variables related to the serial console interface
 
 char  gTxBuffer[TX_BUFFER_SIZE];				// Serial transmit buffer
-uint16_t gTxInPtr = 0;							// Serial transmit buffer input pointer
-uint16_t gTxOutPtr = 0;							// Serial transmit buffer output pointer
-bool  gTxIpFlag = false;						// Serial transmit in-progress flag
+volatile uint16_t gTxInPtr = 0;					// Serial transmit buffer input pointer
+volatile uint16_t gTxOutPtr = 0;				// Serial transmit buffer output pointer
+volatile bool  gTxIpFlag = false;				// Serial transmit in-progress flag
+volatile uint16_t gTxDmaLen = 0;				// Bytes in the transmit DMA in progress
 
 char gRxBuffer[RX_BUFFER_SIZE];					// Serial receive buffer
-uint16_t gRxInPtr = 0;							// Serial receive input pointer
-uint16_t gRxOutPtr = 0;							// Serial receive output pointer
+volatile uint16_t gRxInPtr = 0;					// Serial receive input pointer
+volatile uint16_t gRxOutPtr = 0;				// Serial receive output pointer
+
+volatile uint32_t gSerialIrqs = 0;				// Serial interrupt count
+volatile uint32_t gSerialRxBytes = 0;			// Bytes received
+volatile uint32_t gSerialTxBytes = 0;			// Bytes sent
+volatile uint32_t gSerialErrors = 0;			// Framing and noise errors
+volatile uint32_t gSerialOverruns = 0;			// Times receive lapped unread bytes
+volatile bool gRxOverrunFlag = false;			// Receive buffer needs a resync
+uint32_t gSerialBaud = SERIAL_DEFAULT_BAUD;		// Current baud rate
 
 
 // ****************************************************************************
@@ -77,9 +87,26 @@ bool biosSystemInit(void) {
 	// Start the hi-res timer
 	LL_TIM_EnableCounter(TIM2);
 
+	// Start the DWT cycle counter for benchmarking DSP code
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
 	// Enable the CRC clock for the Spirit MP3 Decoder library
 	__HAL_RCC_CRC_CLK_ENABLE();
 
+	// Set up the interrupt priority tiers
+	NVIC_SetPriority(DMA1_Stream4_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), PRIO_AUDIO, 0));
+	NVIC_SetPriority(SPI2_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), PRIO_AUDIO, 0));
+	NVIC_SetPriority(SDIO_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), PRIO_IO, 0));
+	NVIC_SetPriority(DMA2_Stream3_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), PRIO_IO, 0));
+	NVIC_SetPriority(DMA2_Stream6_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), PRIO_IO, 0));
+	NVIC_SetPriority(USART1_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), PRIO_IO, 0));
+#ifndef PLAYER_RTOS
+	HAL_InitTick(PRIO_TICK);
+	NVIC_SetPriority(PendSV_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), PRIO_DECODE, 0));
+#endif
+
 	return true;
 }
 
@@ -121,6 +148,14 @@ uint32_t tim;
 	return tim;
 }
 
+// ****************************************************************************
+// biosGetCycleCount
+// *****************************************************************************
+uint32_t biosGetCycleCount(void) {
+	
+	return DWT->CYCCNT;
+}
+
 // ****************************************************************************
 // biosLED
 // *****************************************************************************
@@ -176,6 +211,25 @@ bool fResult;
 	return fResult;
 }
 
+// ****************************************************************************
+// biosWaitFlag
+// *****************************************************************************
+// Sleeps until an interrupt sets the flag. Interrupts are held off between
+//  checking the flag and the WFI, so one that lands in between still wakes
+//  the core, and they're let in to run after each wake up. Only call it once
+//  whatever sets the flag has been started successfully.
+// *****************************************************************************
+void biosWaitFlag(volatile bool * pFlag) {
+
+	__disable_irq();
+	while (!*pFlag) {
+		__WFI();
+		__enable_irq();
+		__disable_irq();
+	}
+	__enable_irq();
+}
+
 // ****************************************************************************
 // biosSdReadSectors
 // *****************************************************************************
@@ -186,11 +240,18 @@ HAL_StatusTypeDef err;
 	gMmcDoneFlag = false;
 	//SCB_InvalidateDCache_by_Addr((void *)pDst, (nsecs * 512));
 	err = HAL_SD_ReadBlocks_DMA(&hsd, pDst, addr, nsecs);
-	while (!gMmcDoneFlag);
 	if (err != HAL_OK) {
 		rogueTrap(3);
 		return false;
 	}
+#ifdef PLAYER_RTOS
+	rtosWaitSd();
+#endif
+	biosWaitFlag(&gMmcDoneFlag);
+	if (hsd.ErrorCode != HAL_SD_ERROR_NONE) {
+		rogueTrap(3);
+		return false;
+	}
 	//SCB_InvalidateDCache_by_Addr((void *)pDst, (nsecs * 512));
 	return true;
 }
@@ -205,18 +266,128 @@ HAL_StatusTypeDef err;
 	gMmcDoneFlag = false;
 	//SCB_InvalidateDCache_by_Addr((void *)pDst, (nsecs * 512));
 	err = HAL_SD_WriteBlocks_DMA(&hsd, pDst, addr, nsecs);
-	while (!gMmcDoneFlag);
 	if (err != HAL_OK) {
 		rogueTrap(3);
 		return false;
 	}
+#ifdef PLAYER_RTOS
+	rtosWaitSd();
+#endif
+	biosWaitFlag(&gMmcDoneFlag);
+	if (hsd.ErrorCode != HAL_SD_ERROR_NONE) {
+		rogueTrap(3);
+		return false;
+	}
 	//SCB_InvalidateDCache_by_Addr((void *)pDst, (nsecs * 512));
 	return true;
 }
 	
+// ****************************************************************************
+// biosAudioStart
+// ****************************************************************************
+// Starts the circular I2S transmit DMA over numSamples 32-bit words.
+// ****************************************************************************
+void biosAudioStart(uint32_t *pBuff, uint16_t numSamples) {
+
+	HAL_I2S_Transmit_DMA(&hi2s2, (uint16_t *)pBuff, numSamples);
+}
+
+// ****************************************************************************
+// biosAudioGetIndex
+// ****************************************************************************
+// Returns the index of the 32-bit word the I2S DMA is sending. With 32-bit
+//  data the DMA moves halfwords, so its counter runs at twice the rate.
+// ****************************************************************************
+uint16_t biosAudioGetIndex(uint16_t numSamples) {
+
+uint16_t n;
+
+	n = numSamples - (__HAL_DMA_GET_COUNTER(hi2s2.hdmatx) >> 1);
+	return (n >= numSamples) ? 0 : n;
+}
+
+// ****************************************************************************
+// biosSetTickMs
+// ****************************************************************************
+// Sets the SysTick period to 1, 10 or 100ms. The HAL tick and gMsTicks
+//  advance by the period on each tick, so they keep counting milliseconds.
+// ****************************************************************************
+void biosSetTickMs(uint8_t ms) {
+
+	HAL_SetTickFreq((ms >= 100) ? HAL_TICK_FREQ_10HZ : (ms >= 10) ? HAL_TICK_FREQ_100HZ : HAL_TICK_FREQ_1KHZ);
+}
+
+// ****************************************************************************
+// biosGetTickMs
+// ****************************************************************************
+uint8_t biosGetTickMs(void) {
+
+	return (uint8_t)HAL_GetTickFreq();
+}
+
+// ****************************************************************************
+// biosPendDecode
+// ****************************************************************************
+// Pends the PendSV exception that runs the decode tier.
+// ****************************************************************************
+void biosPendDecode(void) {
+
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+	
+// ****************************************************************************
+// biosTriggerStart
+// ****************************************************************************
+// Samples the trigger port input register into a circular buffer of
+//  numSamples halfwords at rateHz, using TIM8 update requests on DMA2
+//  stream 1 channel 7. Only DMA2 can read the GPIO ports, and the buffer
+//  can't be in CCM RAM. No interrupts are used.
+// ****************************************************************************
+void biosTriggerStart(uint16_t *pBuff, uint16_t numSamples, uint32_t rateHz) {
+
+	LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_TIM8);
+	
+	LL_DMA_DisableStream(DMA2, LL_DMA_STREAM_1);
+	LL_DMA_SetChannelSelection(DMA2, LL_DMA_STREAM_1, LL_DMA_CHANNEL_7);
+	LL_DMA_ConfigTransfer(DMA2, LL_DMA_STREAM_1, LL_DMA_DIRECTION_PERIPH_TO_MEMORY |
+						LL_DMA_MODE_CIRCULAR | LL_DMA_PERIPH_NOINCREMENT |
+						LL_DMA_MEMORY_INCREMENT | LL_DMA_PDATAALIGN_HALFWORD |
+						LL_DMA_MDATAALIGN_HALFWORD | LL_DMA_PRIORITY_LOW);
+	LL_DMA_ConfigAddresses(DMA2, LL_DMA_STREAM_1, (uint32_t)&TRIG_GPIO_Port->IDR,
+						(uint32_t)pBuff, LL_DMA_DIRECTION_PERIPH_TO_MEMORY);
+	LL_DMA_SetDataLength(DMA2, LL_DMA_STREAM_1, numSamples);
+	LL_DMA_EnableStream(DMA2, LL_DMA_STREAM_1);
+
+	// TIM8 runs from the 168MHz APB2 timer clock
+	LL_TIM_SetPrescaler(TIM8, 0);
+	LL_TIM_SetCounterMode(TIM8, LL_TIM_COUNTERMODE_UP);
+	LL_TIM_SetAutoReload(TIM8, (SystemCoreClock / rateHz) - 1);
+	LL_TIM_EnableDMAReq_UPDATE(TIM8);
+	LL_TIM_EnableCounter(TIM8);
+}
+	
+// ****************************************************************************
+// biosTriggerGetIndex
+// ****************************************************************************
+// Returns the index of the next sample the trigger DMA will write.
+// ****************************************************************************
+uint16_t biosTriggerGetIndex(uint16_t numSamples) {
+
+uint16_t n;
+
+	n = numSamples - LL_DMA_GetDataLength(DMA2, LL_DMA_STREAM_1);
+	return (n >= numSamples) ? 0 : n;
+}
+	
 // ****************************************************************************
 // biosSerialInit
 // ****************************************************************************
+// Starts the serial port DMA. Receive runs circular into gRxBuffer on DMA2
+//  stream 2, and the receive pointer is brought up to date by the USART
+//  idle line interrupt at the end of each burst, and by the DMA half and
+//  full transfer interrupts during long ones. Transmit sends contiguous
+//  runs of gTxBuffer on DMA2 stream 7.
+// ****************************************************************************
 void biosSerialInit(void) {
 	
 	for (int i = 0; i < RX_BUFFER_SIZE; i++)
@@ -227,8 +398,102 @@ void biosSerialInit(void) {
 	gRxOutPtr = 0;
 	gTxInPtr = 0;
 	gTxOutPtr = 0;
+	gTxDmaLen = 0;
+	gTxIpFlag = false;
+	
+	// Receive DMA, USART1_RX is DMA2 stream 2 channel 4
+	LL_DMA_DisableStream(DMA2, LL_DMA_STREAM_2);
+	LL_DMA_SetChannelSelection(DMA2, LL_DMA_STREAM_2, LL_DMA_CHANNEL_4);
+	LL_DMA_ConfigTransfer(DMA2, LL_DMA_STREAM_2, LL_DMA_DIRECTION_PERIPH_TO_MEMORY |
+						LL_DMA_MODE_CIRCULAR | LL_DMA_PERIPH_NOINCREMENT |
+						LL_DMA_MEMORY_INCREMENT | LL_DMA_PDATAALIGN_BYTE |
+						LL_DMA_MDATAALIGN_BYTE | LL_DMA_PRIORITY_MEDIUM);
+	LL_DMA_ConfigAddresses(DMA2, LL_DMA_STREAM_2, LL_USART_DMA_GetRegAddr(USART1),
+						(uint32_t)gRxBuffer, LL_DMA_DIRECTION_PERIPH_TO_MEMORY);
+	LL_DMA_SetDataLength(DMA2, LL_DMA_STREAM_2, RX_BUFFER_SIZE);
+	LL_DMA_EnableIT_HT(DMA2, LL_DMA_STREAM_2);
+	LL_DMA_EnableIT_TC(DMA2, LL_DMA_STREAM_2);
+	LL_DMA_EnableStream(DMA2, LL_DMA_STREAM_2);
 	
-	LL_USART_EnableIT_RXNE(USART1);
+	// Transmit DMA, USART1_TX is DMA2 stream 7 channel 4
+	LL_DMA_DisableStream(DMA2, LL_DMA_STREAM_7);
+	LL_DMA_SetChannelSelection(DMA2, LL_DMA_STREAM_7, LL_DMA_CHANNEL_4);
+	LL_DMA_ConfigTransfer(DMA2, LL_DMA_STREAM_7, LL_DMA_DIRECTION_MEMORY_TO_PERIPH |
+						LL_DMA_MODE_NORMAL | LL_DMA_PERIPH_NOINCREMENT |
+						LL_DMA_MEMORY_INCREMENT | LL_DMA_PDATAALIGN_BYTE |
+						LL_DMA_MDATAALIGN_BYTE | LL_DMA_PRIORITY_LOW);
+	LL_DMA_SetPeriphAddress(DMA2, LL_DMA_STREAM_7, LL_USART_DMA_GetRegAddr(USART1));
+	LL_DMA_EnableIT_TC(DMA2, LL_DMA_STREAM_7);
+	
+	NVIC_SetPriority(DMA2_Stream2_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), PRIO_IO, 0));
+	NVIC_EnableIRQ(DMA2_Stream2_IRQn);
+	NVIC_SetPriority(DMA2_Stream7_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), PRIO_IO, 0));
+	NVIC_EnableIRQ(DMA2_Stream7_IRQn);
+
+	LL_USART_EnableDMAReq_RX(USART1);
+	LL_USART_EnableDMAReq_TX(USART1);
+	LL_USART_EnableIT_IDLE(USART1);
+	LL_USART_EnableIT_ERROR(USART1);
+}
+
+// ****************************************************************************
+// biosSerialSetBaud
+// ****************************************************************************
+// Changes the baud rate once anything queued for transmit has gone out.
+// ****************************************************************************
+void biosSerialSetBaud(uint32_t baud) {
+
+uint32_t startTicks = gMsTicks;
+
+	while ((gTxIpFlag || !LL_USART_IsActiveFlag_TC(USART1)) && ((gMsTicks - startTicks) < 100));
+	LL_USART_Disable(USART1);
+	LL_USART_SetBaudRate(USART1, HAL_RCC_GetPCLK2Freq(), LL_USART_OVERSAMPLING_16, baud);
+	LL_USART_Enable(USART1);
+	gSerialBaud = baud;
+}
+
+// ****************************************************************************
+// biosSerialGetBaud
+// ****************************************************************************
+uint32_t biosSerialGetBaud(void) {
+
+	return gSerialBaud;
+}
+
+// ****************************************************************************
+// biosSerialGetErrors
+// ****************************************************************************
+uint32_t biosSerialGetErrors(void) {
+
+	return gSerialErrors;
+}
+
+// ****************************************************************************
+// biosSerialTxChunk
+// ****************************************************************************
+// Starts the transmit DMA on the contiguous run of gTxBuffer from the output
+//  pointer up to the input pointer or the end of the buffer. Returns false
+//  if there's nothing to send.
+// ****************************************************************************
+static bool biosSerialTxChunk(void) {
+
+uint16_t inPtr = gTxInPtr;
+
+	if (inPtr == gTxOutPtr)
+		return false;
+	if (inPtr > gTxOutPtr)
+		gTxDmaLen = inPtr - gTxOutPtr;
+	else
+		gTxDmaLen = TX_BUFFER_SIZE - gTxOutPtr;
+		
+	LL_DMA_ClearFlag_TC7(DMA2);
+	LL_DMA_ClearFlag_HT7(DMA2);
+	LL_DMA_ClearFlag_TE7(DMA2);
+	LL_DMA_ClearFlag_FE7(DMA2);
+	LL_DMA_SetMemoryAddress(DMA2, LL_DMA_STREAM_7, (uint32_t)&gTxBuffer[gTxOutPtr]);
+	LL_DMA_SetDataLength(DMA2, LL_DMA_STREAM_7, gTxDmaLen);
+	LL_DMA_EnableStream(DMA2, LL_DMA_STREAM_7);
+	return true;
 }
 
 // ****************************************************************************
@@ -238,11 +503,75 @@ void biosStartSerialXmt(void) {
 	
 	if (!gTxIpFlag) {
 		gTxIpFlag = true;
-		LL_USART_TransmitData8(USART1, gTxBuffer[gTxOutPtr++]);
-		if (gTxOutPtr >= TX_BUFFER_SIZE)
-			gTxOutPtr = 0;
-		LL_USART_EnableIT_TXE(USART1);
+		if (!biosSerialTxChunk())
+			gTxIpFlag = false;
+	}
+}
+
+// ****************************************************************************
+// biosSerialRxUpdate
+// ****************************************************************************
+// Moves the receive input pointer up to where the DMA has written. The DMA
+//  can't be held off, so if the new bytes and the unread ones don't fit
+//  together, it's written over bytes the main loop hasn't read yet. The
+//  half and full transfer interrupts keep the new bytes under half the
+//  buffer, so that's all we need to check.
+// ****************************************************************************
+static void biosSerialRxUpdate(void) {
+
+uint16_t inPtr;
+uint16_t newBytes;
+uint16_t unread;
+
+	inPtr = RX_BUFFER_SIZE - LL_DMA_GetDataLength(DMA2, LL_DMA_STREAM_2);
+	if (inPtr >= RX_BUFFER_SIZE)
+		inPtr = 0;
+	newBytes = (uint16_t)(inPtr - gRxInPtr + RX_BUFFER_SIZE) % RX_BUFFER_SIZE;
+	unread = (uint16_t)(gRxInPtr - gRxOutPtr + RX_BUFFER_SIZE) % RX_BUFFER_SIZE;
+	if ((unread + newBytes) >= RX_BUFFER_SIZE) {
+		gSerialOverruns++;
+		gRxOverrunFlag = true;
 	}
+	gSerialRxBytes += newBytes;
+	gRxInPtr = inPtr;
+}
+
+// ****************************************************************************
+// biosSerialCheckOverrun
+// ****************************************************************************
+// Called by the receive buffer's reader before it reads. If receive has
+//  overrun, what's in the buffer is a mix of old and new bytes, so it's
+//  thrown away and true is returned.
+// ****************************************************************************
+bool biosSerialCheckOverrun(void) {
+
+	if (!gRxOverrunFlag)
+		return false;
+	__disable_irq();
+	gRxOutPtr = gRxInPtr;
+	gRxOverrunFlag = false;
+	__enable_irq();
+	return true;
+}
+
+// ****************************************************************************
+// biosSerialGetOverruns
+// ****************************************************************************
+uint32_t biosSerialGetOverruns(void) {
+
+	return gSerialOverruns;
+}
+
+// ****************************************************************************
+// biosGetSerialStats
+// ****************************************************************************
+// Returns the serial interrupt count and the bytes received and sent.
+// ****************************************************************************
+void biosGetSerialStats(uint32_t * pIrqs, uint32_t * pRxBytes, uint32_t * pTxBytes) {
+
+	*pIrqs = gSerialIrqs;
+	*pRxBytes = gSerialRxBytes;
+	*pTxBytes = gSerialTxBytes;
 }
 
 // ****************************************************************************
@@ -253,6 +582,9 @@ void HAL_SD_RxCpltCallback(SD_HandleTypeDef *hsd) {
 UNUSED(hsd);
 
 	gMmcDoneFlag = true;	
+#ifdef PLAYER_RTOS
+	rtosSignal(RTOS_FLAG_SD_DONE);
+#endif
 }
 
 // ****************************************************************************
@@ -263,44 +595,102 @@ void HAL_SD_TxCpltCallback(SD_HandleTypeDef *hsd) {
 UNUSED(hsd);
 
 	gMmcDoneFlag = true;	
+#ifdef PLAYER_RTOS
+	rtosSignal(RTOS_FLAG_SD_DONE);
+#endif
+}
+
+// ****************************************************************************
+// HAL_SD_ErrorCallback
+// *****************************************************************************
+// A transfer that fails after it's started wakes the waiter too, which
+//  finds the error in hsd.ErrorCode.
+// *****************************************************************************
+void HAL_SD_ErrorCallback(SD_HandleTypeDef *hsd) {
+	
+UNUSED(hsd);
+
+	gMmcDoneFlag = true;	
+#ifdef PLAYER_RTOS
+	rtosSignal(RTOS_FLAG_SD_DONE);
+#endif
+}
+
+// ****************************************************************************
+// HAL_I2S_TxHalfCpltCallback
+// *****************************************************************************
+void HAL_I2S_TxHalfCpltCallback(I2S_HandleTypeDef *hi2s) {
+
+UNUSED(hi2s);
+
+	audioService(0);
+}
+
+// ****************************************************************************
+// HAL_I2S_TxCpltCallback
+// *****************************************************************************
+void HAL_I2S_TxCpltCallback(I2S_HandleTypeDef *hi2s) {
+
+UNUSED(hi2s);
+
+	audioService(1);
 }
 
 // ****************************************************************************
 // biosUSART1_IRQHandler
 // *****************************************************************************
+// The USART only interrupts on an idle line or a receive error. Reading the
+//  status register and then the data register clears both.
+// *****************************************************************************
 void biosUSART1_IRQHandler(void)
 {
-	
-uint8_t rxData;
-uint16_t tmp16;
 
-	// If this is a receive character interrupt
-	if (LL_USART_IsActiveFlag_RXNE(USART1)) {
-		rxData = LL_USART_ReceiveData8(USART1);
-		
-		tmp16 = gRxInPtr;
-		gRxBuffer[tmp16++] = rxData;
-		if (tmp16 >= RX_BUFFER_SIZE) tmp16 = 0;
-		if (tmp16 != gRxOutPtr)
-			gRxInPtr = tmp16;
+	gSerialIrqs++;
+	if (LL_USART_IsActiveFlag_NE(USART1) || LL_USART_IsActiveFlag_FE(USART1))
+		gSerialErrors++;
+	if (LL_USART_IsActiveFlag_IDLE(USART1) || LL_USART_IsActiveFlag_ORE(USART1) ||
+		LL_USART_IsActiveFlag_NE(USART1) || LL_USART_IsActiveFlag_FE(USART1)) {
+		LL_USART_ClearFlag_IDLE(USART1);
+		biosSerialRxUpdate();
 	}
-	else if (LL_USART_IsActiveFlag_ORE(USART1)) {
-		rxData = LL_USART_ReceiveData8(USART1);
-		LL_USART_ClearFlag_ORE(USART1);
-	}
-	
-	// If this is a transmitter interrupt
-	if (LL_USART_IsActiveFlag_TXE(USART1)) {
-		
-		if (gTxOutPtr != gTxInPtr) {
-			LL_USART_TransmitData8(USART1, gTxBuffer[gTxOutPtr++]);
-			if (gTxOutPtr >= TX_BUFFER_SIZE)
-				gTxOutPtr = 0;
-		}
-		else {
-			LL_USART_DisableIT_TXE(USART1);
+}
+
+// ****************************************************************************
+// DMA2_Stream2_IRQHandler
+// *****************************************************************************
+// Serial receive DMA half and full transfer.
+// *****************************************************************************
+void DMA2_Stream2_IRQHandler(void)
+{
+
+	gSerialIrqs++;
+	if (LL_DMA_IsActiveFlag_HT2(DMA2))
+		LL_DMA_ClearFlag_HT2(DMA2);
+	if (LL_DMA_IsActiveFlag_TC2(DMA2))
+		LL_DMA_ClearFlag_TC2(DMA2);
+	biosSerialRxUpdate();
+}
+
+// ****************************************************************************
+// DMA2_Stream7_IRQHandler
+// *****************************************************************************
+// Serial transmit DMA done. Sends the next run of the transmit buffer if
+//  there is one.
+// *****************************************************************************
+void DMA2_Stream7_IRQHandler(void)
+{
+
+uint16_t outPtr;
+
+	gSerialIrqs++;
+	if (LL_DMA_IsActiveFlag_TC7(DMA2)) {
+		LL_DMA_ClearFlag_TC7(DMA2);
+		gSerialTxBytes += gTxDmaLen;
+		outPtr = gTxOutPtr + gTxDmaLen;
+		if (outPtr >= TX_BUFFER_SIZE)
+			outPtr = 0;
+		gTxOutPtr = outPtr;
+		if (!biosSerialTxChunk())
 			gTxIpFlag = false;
-		}
 	}
 }
-
@@ -38,15 +38,17 @@ extern char gVersion[];
 extern volatile uint8_t gSysFlags;
 extern volatile bool gAudioPlaying;
 extern volatile uint16_t gNumMp3Tracks;
+extern volatile uint8_t gNumMP3Voices;				// Number of voices in use
+extern MP3_VOICE_STRUCTURE mp3[];					// Our mp3 voices
 
 extern char gTxBuffer[];							// Serial transmit buffer
-extern uint16_t gTxInPtr;							// Serial transmit buffer input pointer
-extern uint16_t gTxOutPtr;							// Serial transmit buffer output pointer
-extern bool  gTxIpFlag;								// Serial transmit in-progress flag
+extern volatile uint16_t gTxInPtr;					// Serial transmit buffer input pointer
+extern volatile uint16_t gTxOutPtr;					// Serial transmit buffer output pointer
+extern volatile bool  gTxIpFlag;					// Serial transmit in-progress flag
 
 extern char gRxBuffer[];							// Serial receive buffer
-extern uint16_t gRxInPtr;							// Serial receive input pointer
-extern uint16_t gRxOutPtr;							// Serial receive output pointer
+extern volatile uint16_t gRxInPtr;					// Serial receive input pointer
+extern volatile uint16_t gRxOutPtr;					// Serial receive output pointer
 
 
 // ****************************************************************************
@@ -55,11 +57,18 @@ extern uint16_t gRxOutPtr;							// Serial receive output pointer
 volatile char conLine[MAX_CONSOLE_CMD_LEN];
 volatile uint8_t conCount;
 volatile uint8_t conPtr;
+volatile uint8_t conStart;						// Start of the command being parsed
+volatile uint8_t conEnd;						// End of the command being parsed
 
 volatile char conCmd[MAX_CONSOLE_CMD_LEN];
 volatile uint8_t conNumParams;
 volatile int32_t conParam[MAX_CONSOLE_PARAMS];
 
+bool conLineReady = false;						// Line waiting on the generator
+CONSOLE_GEN_FUNC conGen = NULL;					// Output generator in progress
+uint16_t conGenStep;							// Next generator step
+uint32_t gConsoleDrops = 0;						// Messages lost to a full buffer
+
 
 //*****************************************************************************
 // consoleInit
@@ -67,6 +76,8 @@ volatile int32_t conParam[MAX_CONSOLE_PARAMS];
 void consoleInit(void) {
 	
 	conCount = 0;
+	conLineReady = false;
+	conGen = NULL;
 }
 
 //*****************************************************************************
@@ -76,177 +87,824 @@ void consoleService(void) {
 
 uint8_t u8Val;
 	
-	// Process any bytes in the serial receive buffer
-	if (gRxInPtr != gRxOutPtr) {
+	// While a command's output generator is running, give it the next step
+	//  once the transmit buffer has room for it
+	if (conGen != NULL) {
+		if (consoleTxFree() >= CONSOLE_GEN_MIN_FREE) {
+			if (!conGen(conGenStep++))
+				conGen = NULL;
+		}
+	}
+
+	// If receive overran, the partial command line is lost with it
+	if (biosSerialCheckOverrun()) {
+		conCount = 0;
+		conLineReady = false;
+	}
+
+	// A command line that came in during a generator runs once it's done,
+	//  so replies stay in order
+	if (conLineReady) {
+		if (conGen != NULL)
+			return;
+		conLineReady = false;
+		consoleDoLine();
+		conCount = 0;
+	}
+
+	// Process the bytes in the serial receive buffer. The receive DMA hands
+	//  them over a burst at a time. Binary frames are handled as they come,
+	//  but a command line stops the draining while a generator is running.
+	while ((gRxInPtr != gRxOutPtr) && !conLineReady) {
 
 		// Grab the next byte from the receive buffer
 		u8Val = gRxBuffer[gRxOutPtr++];
 		if (gRxOutPtr >= RX_BUFFER_SIZE) gRxOutPtr = 0;				
 		
+		// Binary frames and autobaud sync bytes don't go to the command line
+		if (protoRxByte(u8Val))
+			continue;
+		
 		// Add this byte to the command line
 		conLine[conCount++] = u8Val;
 		if (conCount >= MAX_CONSOLE_CMD_LEN)
 			conCount--;
 		
 		// Check for carriage return
-		if (u8Val == 0x0d) {			
-			consoleDoCommand();
-			conCount = 0;
+		if (u8Val == 0x0d) {
+			if (conGen != NULL)
+				conLineReady = true;
+			else {
+				consoleDoLine();
+				conCount = 0;
+			}
 		}
 	}
 }
 
+// Console command handlers
+
+static void consoleCmdStat(void);
+static void consoleCmdBegin(void);
+static void consoleCmdTel(void);
+static void consoleCmdCommit(void);
+static void consoleCmdInfo(void);
+static void consoleCmdSrc(void);
+static void consoleCmdMix(void);
+static void consoleCmdV(void);
+static void consoleCmdTrig(void);
+static void consoleCmdSer(void);
+static void consoleCmdBaud(void);
+static void consoleCmdTr(void);
+static void consoleCmdAct(void);
+static void consoleCmdSteal(void);
+static void consoleCmdPlay(void);
+static void consoleCmdStop(void);
+static void consoleCmdMode(void);
+static void consoleCmdProf(void);
+static void consoleCmdLoad(void);
+static void consoleCmdIdle(void);
+static void consoleCmdLoud(void);
+static void consoleCmdDith(void);
+static void consoleCmdMeq(void);
+static void consoleCmdEq(void);
+static void consoleCmdHelp(void);
+
+static bool consoleGenSrc(uint16_t step);
+static bool consoleGenProf(uint16_t step);
+static bool consoleGenEq(uint16_t b);
+static bool consoleGenHelp(uint16_t step);
+
+// The command table, sorted by name for a binary search. The parameter
+//  counts are checked before the handler is called.
+
+static const CONSOLE_CMD_STRUCTURE consoleCmds[] = {
+	{ "act",   1, 5, consoleCmdAct,         "Trigger action",  "trigNum<, action, trackNum, gainDb, fadeMs>" },
+	{ "baud",  0, 2, consoleCmdBaud,        "Baud rate",       "<rate, autobaud>" },
+	{ "begin", 0, 0, consoleCmdBegin,       "Begin batch",     "none" },
+	{ "commit",0, 0, consoleCmdCommit,      "Commit batch",    "none" },
+	{ "dith",  0, 1, consoleCmdDith,        "Dither",          "<0 = off, 1 = TPDF, 2 = shaped>" },
+	{ "eq",    0, 5, consoleCmdEq,          "Master EQ",       "<band, type, freqHz, gainDb, Q x100>" },
+	{ "help",  0, 0, consoleCmdHelp,        "Help",            "none" },
+	{ "idle",  0, 1, consoleCmdIdle,        "Idle time",       "<0 = normal, 1 = low power>" },
+	{ "info",  1, 1, consoleCmdInfo,        "Track info",      "trackNum" },
+	{ "load",  0, 3, consoleCmdLoad,        "CPU load",        "<onPct, offPct, cutoffHz>" },
+	{ "loud",  0, 2, consoleCmdLoud,        "Loudness",        "<trackNum> or <enable, targetLufs>" },
+	{ "meq",   0, 3, consoleCmdMeq,         "Voice EQ",        "<voice, <band, gainDb>>" },
+	{ "mix",   0, 0, consoleCmdMix,         "Mix cycles",      "none" },
+	{ "mode",  3, 3, consoleCmdMode,        "Track mode",      "trackNum, loop, lock" },
+	{ "play",  1, 8, consoleCmdPlay,        "Play track",      "trackNum<, gainDb, bal, attackMs, cents, loop, lock, pri>" },
+	{ "prof",  0, 1, consoleCmdProf,        "Profiler",        "<0 = reset>" },
+	{ "ser",   0, 0, consoleCmdSer,         "Serial stats",    "none" },
+	{ "src",   0, 1, consoleCmdSrc,         "SRC quality",     "<0 - 3>" },
+	{ "stat",  0, 0, consoleCmdStat,        "Status",          "none" },
+	{ "steal", 0, 1, consoleCmdSteal,       "Steal policy",    "<0 old, 1 quiet, 2 priority, 3 retrig>" },
+	{ "stop",  0, 2, consoleCmdStop,        "Stop track/all",  "<trackNum, releaseMs>" },
+	{ "tel",   0, 1, consoleCmdTel,         "Telemetry",       "<periodMs, 0 = off>" },
+	{ "tr",    1, 1, consoleCmdTr,          "Fire trigger",    "trigNum" },
+	{ "trig",  0, 0, consoleCmdTrig,        "Triggers",        "none" },
+	{ "v",     0, 0, consoleCmdV,           "Active voices",   "none" }
+};
+
+#define CONSOLE_NUM_CMDS	(sizeof(consoleCmds) / sizeof(CONSOLE_CMD_STRUCTURE))
+
+
 //*****************************************************************************
-// consoleDoCommand
+// consoleCmdStat
 //*****************************************************************************
-void consoleDoCommand(void) {
-		
-	if (consoleParseLine()) {
-				
-		// ==============================================
-		// stat
-		// ==============================================
-		if (strcmp((const char *)conCmd, "stat") == 0)
-			consoleSignOn();
-/*
-		// ==============================================
-		// v
-		// ==============================================
-		else if (strcmp((const char *)conCmd, "v") == 0) {
-			consoleSendString("Active voices: ");
-			consoleSendInt32(voiceCheck());
-			consoleNewLine(1);
-		}
-		
-		// ==============================================
-		// sd <0>
-		// ==============================================
-		else if (strcmp((const char *)conCmd, "sd") == 0) {
-			if (conNumParams == 0) {		
-				consoleSendString("Max microSD block read = ");
-				consoleSendInt32(gMaxSdReaduSecs);
-				consoleSendString(" usecs\n\r");
-			}
-			else if ((conNumParams == 1) && (conParam[0] == 0)) {
-				consoleSendString("microSD block read time reset\n\r");
-				gMaxSdReaduSecs = 0;
-			}
-		}
+static void consoleCmdStat(void) {
 
-		// ==============================================
-		// play t, <gain, bal, attack, pitch, loop, lock>
-		// ==============================================
-		else if (strcmp((const char *)conCmd, "play") == 0) {
-			
-			if (conNumParams < 1) {
-				consoleSyntaxErr();
-				return;
-			}
-			if (conParam[0] < MAX_NUM_TRACKS) {
-				pNa.function = MIDI_ACTION_TRIG1;
-				pNa.trackIndex = conParam[0];
-				pNa.minGainDb = DEFAULT_MIN_VEL_GAINDB;
-				pNa.maxGainDb = 0;
-				pNa.balance = 64;
-				pNa.pitchOffset = 0;
-				pNa.attack = 0;
-				pNa.looping = false;
-				pNa.locked = false;						
-			}
-			if (conNumParams >= 2) {
-				if ((conParam[1] >= MIN_GAIN_DB) && (conParam[1] < MAX_GAIN_DB))
-					pNa.maxGainDb = conParam[1];
-			}
-			if (conNumParams >= 3) {
-				if (conParam[2] <= 127)
-					pNa.balance = conParam[2];
-			}
-			if (conNumParams >= 4) {
-				if ((conParam[3] > 0) & (conParam[3] <= 4000))
-					pNa.attack = conParam[3];
-			}					
-			if (conNumParams >= 5) {
-				if ((conParam[4] >= -700) & (conParam[4] <= 700))
-					pNa.pitchOffset = conParam[4];
-			}					
-			if (conNumParams >= 6) {
-				if (conParam[5] > 0)
-					pNa.looping = true;
-			}
-			if (conNumParams >= 7) {
-				if (conParam[6] > 0)
-					pNa.locked = true;
-			}				
-			voicePlayNote(0xff, 0x7f, &pNa, 0);		
-		}
-		
-		// ==============================================
-		// stop t, <release>
-		// ==============================================
-		else if (strcmp((const char *)conCmd, "stop") == 0) {
-			
-			if (conNumParams < 1) {
-				voiceStopAll();
-				return;
-			}
-			if (conParam[0] < MAX_NUM_TRACKS) {
-				pNa.function = MIDI_ACTION_STOP;
-				pNa.trackIndex = conParam[0];
-			}
-			if (conNumParams >= 2) {
-				if ((conParam[1] > 0) && (conParam[1] < 10000))
-					pNa.release = conParam[1];
-			}
-			voiceStopTrack(&pNa);
+	consoleSignOn();
+}
+
+//*****************************************************************************
+// consoleCmdInfo
+//*****************************************************************************
+static void consoleCmdInfo(void) {
+
+	if ((conNumParams < 1) || (conParam[0] < 0) || (conParam[0] >= MAX_NUM_TRACKS)) {
+		consoleSyntaxErr();
+		return;
+	}
+	consoleSendTrackInfo(conParam[0]);
+}
+
+//*****************************************************************************
+// consoleGenSrc
+//*****************************************************************************
+static bool consoleGenSrc(uint16_t step) {
+
+	if (step == 0) {
+		consoleSendString("Resampler quality = ");
+		consoleSendInt32(resampleGetQuality());
+		consoleNewLine(1);
+		return true;
+	}
+	consoleSendString("  Quality ");
+	consoleSendInt32(step - 1);
+	consoleSendString(" = ");
+	consoleSendInt32(resampleGetCycles(step - 1));
+	consoleSendString(" cycles/buffer\n\r");
+	return (step < RS_NUM_QUALITIES);
+}
+
+//*****************************************************************************
+// consoleCmdSrc
+//*****************************************************************************
+static void consoleCmdSrc(void) {
+
+	if (conNumParams == 0)
+		consoleStartGen(consoleGenSrc);
+	else if ((conParam[0] >= 0) && (conParam[0] < RS_NUM_QUALITIES))
+		resampleSetQuality(conParam[0]);
+	else
+		consoleSyntaxErr();
+}
+
+//*****************************************************************************
+// consoleCmdMix
+//*****************************************************************************
+static void consoleCmdMix(void) {
+
+	consoleSendString("Voice mix 3-pass = ");
+	consoleSendInt32(dspGetMixCycles(MIX_BENCH_3PASS));
+	consoleSendString(" cycles/buffer\n\r");
+	consoleSendString("Voice mix fused  = ");
+	consoleSendInt32(dspGetMixCycles(MIX_BENCH_FUSED));
+	consoleSendString(" cycles/buffer\n\r");
+}
+
+//*****************************************************************************
+// consoleCmdV
+//*****************************************************************************
+// Lists each playing voice's time played against its track's length, so a
+//  looping voice shows it has run past the end of the file.
+//*****************************************************************************
+static void consoleCmdV(void) {
+
+uint8_t v;
+
+	consoleSendString("Active voices: ");
+	consoleSendInt32(voicesCheck());
+	consoleNewLine(1);
+	for (v = 0; v < gNumMP3Voices; v++) {
+		if (mp3GetState(v) != VOICE_STATE_PLAYING)
+			continue;
+		consoleSendString("  v");
+		consoleSendInt32(v);
+		consoleSendString(" track ");
+		consoleSendInt32(mp3[v].track);
+		consoleSendString(", played ");
+		consoleSendInt32((uint32_t)(((uint64_t)mp3[v].framesPlayed * 1000) / AUDIO_SAMPLE_RATE));
+		consoleSendString("ms of ");
+		consoleSendInt32(trackGetDurationMs(mp3[v].track));
+		consoleSendString("ms, loops ");
+		consoleSendInt32(mp3GetLoops(v));
+		consoleNewLine(1);
+	}
+}
+
+//*****************************************************************************
+// consoleCmdTrig
+//*****************************************************************************
+static void consoleCmdTrig(void) {
+
+	consoleSendString("Trigger state = ");
+	consoleSendInt32(triggerGetState());
+	consoleSendString(", dropped = ");
+	consoleSendInt32(triggerGetDropped());
+	consoleNewLine(1);
+}
+
+//*****************************************************************************
+// consoleCmdSer
+//*****************************************************************************
+static void consoleCmdSer(void) {
+
+uint32_t serIrqs;
+uint32_t serRx;
+uint32_t serTx;
+
+	biosGetSerialStats(&serIrqs, &serRx, &serTx);
+	consoleSendString("Serial rx ");
+	consoleSendInt32(serRx);
+	consoleSendString(", tx ");
+	consoleSendInt32(serTx);
+	consoleSendString(" bytes, ");
+	consoleSendInt32(serIrqs);
+	consoleSendString(" interrupts, ");
+	if ((serRx + serTx) > 0)
+		consoleSendInt32((uint32_t)(((uint64_t)serIrqs * 1024) / (serRx + serTx)));
+	else
+		consoleSendString("0");
+	consoleSendString(" per KB, ");
+	consoleSendInt32(consoleGetDrops());
+	consoleSendString(" dropped, ");
+	consoleSendInt32(biosSerialGetOverruns());
+	consoleSendString(" rx overruns\n\r");
+}
+
+//*****************************************************************************
+// consoleCmdBaud
+//*****************************************************************************
+static void consoleCmdBaud(void) {
+
+	if (conNumParams == 0) {
+		consoleSendString("Baud rate ");
+		consoleSendInt32(biosSerialGetBaud());
+		if (protoGetAutobaud())
+			consoleSendString(", autobaud on\n\r");
+		else
+			consoleSendString(", autobaud off\n\r");
+		return;
+	}
+	if (conNumParams >= 2)
+		protoSetAutobaud(conParam[1] > 0);
+	if ((conParam[0] != 0) && !protoSetBaud(conParam[0]))
+		consoleSyntaxErr();
+}
+
+//*****************************************************************************
+// consoleCmdTr
+//*****************************************************************************
+static void consoleCmdTr(void) {
+
+	if ((conNumParams < 1) || (conParam[0] < 0) || (conParam[0] >= MAX_NUM_TRIGGERS))
+		consoleSyntaxErr();
+	else
+		actionDispatch(conParam[0], TRIG_EDGE_PRESS);
+}
+
+//*****************************************************************************
+// consoleCmdAct
+//*****************************************************************************
+static void consoleCmdAct(void) {
+
+ACTION_STRUCTURE action;
+ACTION_STRUCTURE * pAction;
+
+	if ((conNumParams < 1) || (conParam[0] < 0) || (conParam[0] >= MAX_NUM_TRIGGERS)) {
+		consoleSyntaxErr();
+		return;
+	}
+	if (conNumParams == 1) {
+		pAction = actionGet(conParam[0]);
+		consoleSendString("Trigger ");
+		consoleSendInt32(conParam[0]);
+		consoleSendString(": action ");
+		consoleSendInt32(pAction->type);
+		consoleSendString(", track ");
+		consoleSendInt32(pAction->track);
+		consoleSendString(", gain ");
+		consoleSendSigned(pAction->gainDb);
+		consoleSendString("dB, fade ");
+		consoleSendInt32(pAction->fadeMs);
+		consoleSendString("ms\n\r");
+		return;
+	}
+	if ((conNumParams < 5) || (conParam[1] < 0) || (conParam[2] < 0) ||
+		(conParam[3] < MIN_GAIN_DB) || (conParam[3] > MAX_GAIN_DB) ||
+		(conParam[4] < 0) || (conParam[4] > 30000)) {
+		consoleSyntaxErr();
+		return;
+	}
+	action.type = conParam[1];
+	action.reserved = 0;
+	action.track = conParam[2];
+	action.gainDb = conParam[3];
+	action.fadeMs = conParam[4];
+	if (!actionSet(conParam[0], &action))
+		consoleSyntaxErr();
+}
+
+//*****************************************************************************
+// consoleCmdSteal
+//*****************************************************************************
+static void consoleCmdSteal(void) {
+
+	if (conNumParams == 0) {
+		consoleSendString("Voice steal policy = ");
+		consoleSendInt32(voicesGetStealPolicy());
+		consoleNewLine(1);
+	}
+	else if ((conParam[0] >= 0) && (conParam[0] < VOICE_NUM_POLICIES))
+		voicesSetStealPolicy(conParam[0]);
+	else
+		consoleSyntaxErr();
+}
+
+//*****************************************************************************
+// consoleCmdPlay
+//*****************************************************************************
+static void consoleCmdPlay(void) {
+
+int16_t playGainDb;
+uint16_t playAttack;
+int16_t playCents;
+uint8_t playPan;
+uint8_t playPriority;
+bool playLoop;
+bool playLock;
+
+	if ((conNumParams < 1) || (conParam[0] < 0) || (conParam[0] >= MAX_NUM_TRACKS)) {
+		consoleSyntaxErr();
+		return;
+	}
+	playGainDb = 0;
+	playPan = PAN_CENTER;
+	playAttack = 0;
+	playCents = 0;
+	playLoop = false;
+	playLock = false;
+	playPriority = 0;
+	if (conNumParams >= 2) {
+		if ((conParam[1] >= MIN_GAIN_DB) && (conParam[1] < MAX_GAIN_DB))
+			playGainDb = conParam[1];
+	}
+	if (conNumParams >= 3) {
+		if ((conParam[2] >= -PAN_CENTER) && (conParam[2] <= PAN_CENTER))
+			playPan = PAN_CENTER + conParam[2];
+	}
+	if (conNumParams >= 4) {
+		if ((conParam[3] > 0) & (conParam[3] <= 4000))
+			playAttack = conParam[3];
+	}					
+	if (conNumParams >= 5) {
+		if ((conParam[4] >= -RS_MAX_CENTS) & (conParam[4] <= RS_MAX_CENTS))
+			playCents = conParam[4];
+	}					
+	if (conNumParams >= 6) {
+		if (conParam[5] > 0)
+			playLoop = true;
+	}
+	if (conNumParams >= 7) {
+		if (conParam[6] > 0)
+			playLock = true;
+	}
+	if (conNumParams >= 8) {
+		if ((conParam[7] >= 0) && (conParam[7] <= 255))
+			playPriority = conParam[7];
+	}				
+	voicesPlayTrack(conParam[0], playGainDb, playPan, playAttack, playCents, playLoop, playLock,
+					playPriority);
+}
+
+//*****************************************************************************
+// consoleCmdStop
+//*****************************************************************************
+static void consoleCmdStop(void) {
+
+uint16_t playAttack;
+
+	if (conNumParams < 1) {
+		voicesStopAll();
+		return;
+	}
+	if ((conParam[0] < 0) || (conParam[0] >= MAX_NUM_TRACKS)) {
+		consoleSyntaxErr();
+		return;
+	}
+	playAttack = 0;
+	if (conNumParams >= 2) {
+		if ((conParam[1] > 0) && (conParam[1] < 10000))
+			playAttack = conParam[1];
+	}
+	voicesStopTrack(conParam[0], playAttack);
+}
+
+//*****************************************************************************
+// consoleCmdBegin
+//*****************************************************************************
+static void consoleCmdBegin(void) {
+
+	if (!voicesBatchBegin())
+		consoleSendString("Batch busy\n\r");
+}
+
+//*****************************************************************************
+// consoleCmdCommit
+//*****************************************************************************
+static void consoleCmdCommit(void) {
+
+	if (!voicesBatchIsOpen()) {
+		consoleSyntaxErr();
+		return;
+	}
+	if (!voicesBatchCommit())
+		consoleSendString("Batch overflow\n\r");
+}
+
+//*****************************************************************************
+// consoleCmdTel
+//*****************************************************************************
+static void consoleCmdTel(void) {
+
+	if (conNumParams == 0) {
+		consoleSendString("Telemetry period = ");
+		consoleSendInt32(telemGetPeriod());
+		consoleSendString("ms, drops = ");
+		consoleSendInt32(telemGetDrops());
+		consoleNewLine(1);
+	}
+	else if ((conParam[0] < 0) || (conParam[0] > TELEM_MAX_PERIOD_MS) || !telemSetPeriod(conParam[0]))
+		consoleSyntaxErr();
+}
+
+//*****************************************************************************
+// consoleCmdMode
+//*****************************************************************************
+static void consoleCmdMode(void) {
+
+	if ((conNumParams < 3) || (conParam[0] < 0)) {
+		consoleSyntaxErr();
+		return;
+	}
+	if (!trackSetMode(conParam[0], (conParam[1] > 0), (conParam[2] > 0)))
+		consoleSyntaxErr();
+}
+
+//*****************************************************************************
+// consoleGenProf
+//*****************************************************************************
+static bool consoleGenProf(uint16_t step) {
+
+	if (step == 0) {
+		consoleSendString("Cycles per buffer   last    peak     avg\n\r");
+		return true;
+	}
+	if (step <= PROF_NUM_SLOTS) {
+		consoleSendString("  ");
+		consoleSendString((char *)profileGetName(step - 1));
+		consoleSendString("  ");
+		consoleSendInt32(profileGetLast(step - 1));
+		consoleSendString("  ");
+		consoleSendInt32(profileGetPeak(step - 1));
+		consoleSendString("  ");
+		consoleSendInt32(profileGetAverage(step - 1));
+		consoleNewLine(1);
+		return true;
+	}
+	
+	// Then the latency of each execution tier
+	step -= PROF_NUM_SLOTS + 1;
+	if (step == 0) {
+		consoleSendString("Latency cycles      last    peak\n\r");
+		return true;
+	}
+	consoleSendString("  ");
+	consoleSendString((char *)profileGetLatencyName(step - 1));
+	consoleSendString("  ");
+	consoleSendInt32(profileGetLatencyLast(step - 1));
+	consoleSendString("  ");
+	consoleSendInt32(profileGetLatencyPeak(step - 1));
+	consoleNewLine(1);
+	return (step < LAT_NUM_TIERS);
+}
+
+//*****************************************************************************
+// consoleCmdProf
+//*****************************************************************************
+static void consoleCmdProf(void) {
+
+	if (conNumParams == 0)
+		consoleStartGen(consoleGenProf);
+	else if ((conNumParams == 1) && (conParam[0] == 0)) {
+		consoleSendString("Profiler reset\n\r");
+		profileReset();
+	}
+}
+
+//*****************************************************************************
+// consoleCmdLoad
+//*****************************************************************************
+static void consoleCmdLoad(void) {
+
+	if (conNumParams == 0) {
+		consoleSendString("CPU load = ");
+		consoleSendInt32(profileGetLoad());
+		consoleSendString("%, degrade ");
+		if (mdctDegradeIsActive())
+			consoleSendString("on, cutoff ");
+		else
+			consoleSendString("off, cutoff ");
+		consoleSendInt32(mdctDegradeGetCutoff());
+		consoleSendString("Hz\n\r");
+	}
+	else if ((conNumParams == 3) && (conParam[0] > 0) && (conParam[0] <= 100) &&
+			(conParam[1] >= 0) && (conParam[1] < conParam[0]) &&
+			(conParam[2] >= 1000) && (conParam[2] <= 24000))
+		mdctDegradeSet(conParam[0], conParam[1], conParam[2]);
+	else
+		consoleSyntaxErr();
+}
+
+//*****************************************************************************
+// consoleCmdIdle
+//*****************************************************************************
+static void consoleCmdIdle(void) {
+
+	if (conNumParams == 0) {
+		consoleSendString("Idle = ");
+		consoleSendInt32(profileGetIdle());
+		consoleSendString("%, tick = ");
+		consoleSendInt32(biosGetTickMs());
+		if (sdTestGetLowPower())
+			consoleSendString("ms, low power on\n\r");
+		else
+			consoleSendString("ms, low power off\n\r");
+	}
+	else if ((conParam[0] == 0) || (conParam[0] == 1))
+		sdTestSetLowPower(conParam[0] == 1);
+	else
+		consoleSyntaxErr();
+}
+
+//*****************************************************************************
+// consoleCmdLoud
+//*****************************************************************************
+static void consoleCmdLoud(void) {
+
+	if (conNumParams == 0) {
+		consoleSendString("Loudness normalization ");
+		if (loudGetNormalize())
+			consoleSendString("on, target ");
+		else
+			consoleSendString("off, target ");
+		consoleSendSigned(loudGetTarget());
+		consoleSendString(" LUFS\n\r");
+	}
+	else if ((conNumParams == 1) && (conParam[0] >= 0) && (conParam[0] < MAX_NUM_TRACKS)) {
+		if ((trackGetInfo(conParam[0]) == NULL) ||
+			((trackGetInfo(conParam[0])->flags & TRACK_INFO_LOUD) == 0))
+			consoleSendString("Not measured yet\n\r");
+		else {
+			consoleSendSigned(trackGetInfo(conParam[0])->loudness);
+			consoleSendString(" LUFS, offset ");
+			consoleSendSigned(loudGetOffsetDb(conParam[0]));
+			consoleSendString(" dB\n\r");
 		}
-			
-		// ==============================================
-		// load p
-		// ==============================================
-		else if (strcmp((const char *)conCmd, "load") == 0) {		
-
-			if (conNumParams < 1) {
-				consoleSyntaxErr();
-				return;
-			}
-			if (conParam[0] <= 9999) {
-				storeReadPreset(conParam[0], true);
-			}
+	}
+	else if ((conNumParams == 2) && (conParam[1] >= -40) && (conParam[1] <= 0))
+		loudSetNormalize((conParam[0] > 0), conParam[1]);
+	else
+		consoleSyntaxErr();
+}
+
+//*****************************************************************************
+// consoleCmdDith
+//*****************************************************************************
+static void consoleCmdDith(void) {
+
+	if (conNumParams == 0) {
+		consoleSendString("Dither mode = ");
+		consoleSendInt32(dspGetDitherMode());
+		consoleNewLine(1);
+	}
+	else if ((conParam[0] >= 0) && (conParam[0] < DITHER_NUM_MODES))
+		dspSetDitherMode(conParam[0]);
+	else
+		consoleSyntaxErr();
+}
+
+//*****************************************************************************
+// consoleCmdMeq
+//*****************************************************************************
+static void consoleCmdMeq(void) {
+
+	if (conNumParams == 0) {
+		consoleSendString("Stereo granule EQ, MDCT = ");
+		consoleSendInt32(mdctEqGetCycles(MDCT_BENCH_MDCT));
+		consoleSendString(" cycles, 5 biquads = ");
+		consoleSendInt32(mdctEqGetCycles(MDCT_BENCH_BIQUAD));
+		consoleSendString(" cycles\n\r");
+	}
+	else if ((conNumParams == 1) && (conParam[0] >= 0) && (conParam[0] < MAX_NUM_MP3_VOICES)) {
+		consoleSendString("Voice EQ dB:");
+		for (int b = 0; b < MDCT_EQ_BANDS; b++) {
+			consoleSendString(" ");
+			consoleSendSigned(mdctEqGetBand(conParam[0], b));
 		}
-		
-		// ==============================================
-		// gain g
-		// ==============================================
-		else if (strcmp((const char *)conCmd, "gain") == 0) {		
-
-			if (conNumParams < 1) {
-				consoleSyntaxErr();
-				return;
-			}
-			if ((conParam[0] >= MIN_GAIN_DB) && (conParam[0] <= MAX_GAIN_DB)) {
-				audioSetGainDb(conParam[0]);
-			}
+		consoleNewLine(1);
+	}
+	else if ((conNumParams < 3) || (conParam[0] < 0) || (conParam[0] >= MAX_NUM_MP3_VOICES) ||
+			(conParam[1] < 0) || (conParam[1] >= MDCT_EQ_BANDS) ||
+			(conParam[2] < -MDCT_EQ_MAX_GAIN_DB) || (conParam[2] > MDCT_EQ_MAX_GAIN_DB) ||
+			!mdctEqSetBand(conParam[0], conParam[1], conParam[2]))
+		consoleSyntaxErr();
+}
+
+//*****************************************************************************
+// consoleGenEq
+//*****************************************************************************
+static bool consoleGenEq(uint16_t b) {
+
+	consoleSendString("  Band ");
+	consoleSendInt32(b);
+	consoleSendString(": type ");
+	consoleSendInt32(eqGetBand(b)->type);
+	consoleSendString(", ");
+	consoleSendInt32(eqGetBand(b)->freqHz);
+	consoleSendString("Hz, ");
+	consoleSendSigned(eqGetBand(b)->gainDb);
+	consoleSendString("dB, Q x100 = ");
+	consoleSendInt32(eqGetBand(b)->q100);
+	consoleNewLine(1);
+	return (b < (EQ_MAX_BANDS - 1));
+}
+
+//*****************************************************************************
+// consoleCmdEq
+//*****************************************************************************
+static void consoleCmdEq(void) {
+
+	if (conNumParams == 0)
+		consoleStartGen(consoleGenEq);
+	else if ((conNumParams == 2) && (conParam[1] == EQ_TYPE_OFF) &&
+			(conParam[0] >= 0) && (conParam[0] < EQ_MAX_BANDS)) {
+		eqSetBand(conParam[0], EQ_TYPE_OFF, eqGetBand(conParam[0])->freqHz, 0,
+					eqGetBand(conParam[0])->q100);
+	}
+	else if ((conNumParams < 5) || (conParam[0] < 0) || (conParam[0] >= EQ_MAX_BANDS) ||
+			(conParam[1] < 0) || (conParam[1] >= EQ_NUM_TYPES) || (conParam[2] < 0) || (conParam[2] > 0xffff) || (conParam[4] < 0) ||
+			(conParam[4] > 0xffff) || (conParam[3] < -128) || (conParam[3] > 127) ||
+			!eqSetBand(conParam[0], conParam[1], conParam[2], conParam[3], conParam[4]))
+		consoleSyntaxErr();
+}
+
+//*****************************************************************************
+// consoleSendHelpLine
+//*****************************************************************************
+static void consoleSendHelpLine(const CONSOLE_CMD_STRUCTURE * pCmd) {
+
+char line[16];
+uint8_t n;
+
+	n = strlen(pCmd->pHelp);
+	memset(line, ' ', 15);
+	memcpy(line, pCmd->pHelp, (n < 15) ? n : 15);
+	line[15] = 0;
+	consoleSendString(line);
+	n = strlen(pCmd->pName);
+	memset(line, ' ', 9);
+	memcpy(line, pCmd->pName, (n < 9) ? n : 9);
+	line[9] = 0;
+	consoleSendString(line);
+	consoleSendString((char *)pCmd->pParams);
+	consoleNewLine(1);
+}
+
+//*****************************************************************************
+// consoleGenHelp
+//*****************************************************************************
+// Lists the commands from the command table, a line at a time.
+//*****************************************************************************
+static bool consoleGenHelp(uint16_t step) {
+
+	if (step == 0) {
+		consoleNewLine(1);
+		consoleSendString("Function       Command  Parameters <optional>\n\r");
+		consoleSendString("========       =======  =====================\n\r");
+		return true;
+	}
+	if (step <= CONSOLE_NUM_CMDS) {
+		consoleSendHelpLine(&consoleCmds[step - 1]);
+		return true;
+	}
+	consoleNewLine(1);
+	return false;
+}
+
+//*****************************************************************************
+// consoleCmdHelp
+//*****************************************************************************
+static void consoleCmdHelp(void) {
+
+	consoleStartGen(consoleGenHelp);
+}
+
+//*****************************************************************************
+// consoleFindCmd
+//*****************************************************************************
+// Binary search of the command table. Returns NULL if there's no match.
+//*****************************************************************************
+static const CONSOLE_CMD_STRUCTURE * consoleFindCmd(const char * pName) {
+
+int lo = 0;
+int hi = CONSOLE_NUM_CMDS - 1;
+int mid;
+int cmp;
+
+	while (lo <= hi) {
+		mid = (lo + hi) >> 1;
+		cmp = strcmp(pName, consoleCmds[mid].pName);
+		if (cmp == 0)
+			return &consoleCmds[mid];
+		if (cmp < 0)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
+	return NULL;
+}
+
+//*****************************************************************************
+// consoleDoLine
+//*****************************************************************************
+// Runs each of the ';' separated commands on the line. When there's more than
+//  one they go out as a batch, so their starts and stops land in the same
+//  audio buffer. A line inside an explicit begin/commit joins that batch.
+//*****************************************************************************
+void consoleDoLine(void) {
+
+uint8_t n;
+bool batch = false;
+
+	for (n = 0; n < conCount; n++) {
+		if (conLine[n] == ';') {
+			if (!voicesBatchIsOpen())
+				batch = voicesBatchBegin();
+			break;
 		}
-*/		
-		// ==============================================
-		// help
-		// ==============================================
-		else if (strcmp((const char *)conCmd, "help") == 0) {
-
-			consoleNewLine(1);
-			consoleSendString("Function       Command  Parameters <optional>\n\r");
-			consoleSendString("========       =======  =====================\n\r");
-			consoleSendString("Status         stat     none\n\r");
-			consoleSendString("Play track     play     trackNum<, gainDb, bal, attackMs, cents, loop, lock>\n\r");
-			consoleSendString("Stop track     stop     trackNum<, releaseMs>\n\r");
-			consoleSendString("Stop all       stop     none\n\r");
-			consoleSendString("Output gain    gain     dB (-70 to 0)\n\r");
-			consoleSendString("Active voices  v        none\n\r");
-			consoleNewLine(1);
+	}
+	
+	conStart = 0;
+	for (n = 0; n < conCount; n++) {
+		if ((conLine[n] == ';') || (conLine[n] == 0x0d)) {
+			conLine[n] = 0x0d;
+			conEnd = n + 1;
+			consoleDoCommand();
+			conStart = n + 1;
 		}
 	}
-	else {
+	
+	if (batch && !voicesBatchCommit())
+		consoleSendString("Batch overflow\n\r");
+}
+
+//*****************************************************************************
+// consoleDoCommand
+//*****************************************************************************
+// Looks up the command in the table, checks the number of parameters and
+//  runs its handler. The lookup is timed by the PROF_CONSOLE profiler slot.
+//*****************************************************************************
+void consoleDoCommand(void) {
+
+const CONSOLE_CMD_STRUCTURE * pCmd;
+		
+	if (!consoleParseLine())
+		return;
+		
+	profileStart(PROF_CONSOLE);
+	pCmd = consoleFindCmd((const char *)conCmd);
+	profileEnd(PROF_CONSOLE);
+	
+	if (pCmd == NULL)
+		return;
+	if ((conNumParams < pCmd->minParams) || (conNumParams > pCmd->maxParams)) {
+		consoleSyntaxErr();
+		return;
 	}
+	pCmd->handler();
 }
 
 //*****************************************************************************
@@ -257,7 +915,7 @@ bool consoleParseLine(void) {
 int n = 1;
 int32_t p;
 	
-	conPtr = 0;
+	conPtr = conStart;
 	conNumParams = 0;
 	for (int i = 0; i < MAX_CONSOLE_PARAMS; i++)
 		conParam[i] = 0;
@@ -267,7 +925,7 @@ int32_t p;
 		return false;
 	
 	// Parse any included command line parameters
-	while ((n > 0) && (conPtr < conCount) && (conNumParams < MAX_CONSOLE_PARAMS)){
+	while ((n > 0) && (conPtr < conEnd) && (conNumParams < MAX_CONSOLE_PARAMS)){
 		n = consoleGetValue((int32_t *)&p);
 		if (n != 0)
 			conParam[conNumParams++] = p;
@@ -285,7 +943,7 @@ char c;
 char * dstPtr;
 	
 	dstPtr = cmdString;
-	while (conPtr < conCount) {
+	while (conPtr < conEnd) {
 		
 		c = conLine[conPtr];
 		
@@ -324,7 +982,7 @@ char c;
 int32_t iSign = 1;
 int32_t iVal = 0;
 	
-	while (conPtr < conCount) {
+	while (conPtr < conEnd) {
 		
 		c = conLine[conPtr];
 		
@@ -433,6 +1091,35 @@ uint32_t gCardMB;
 	consoleNewLine(1);
 }
 
+//*****************************************************************************
+// consoleSendTrackInfo
+//*****************************************************************************
+void consoleSendTrackInfo(uint16_t t) {
+
+TRACK_INFO_STRUCTURE * pInfo;
+
+	consoleSendString("Track ");
+	consoleSendInt32(t);
+	if ((pInfo = trackGetInfo(t)) == NULL) {
+		consoleSendString(": not found\n\r");
+		return;
+	}
+	consoleSendString(": ");
+	consoleSendInt32(trackGetSampleRate(t));
+	consoleSendString(" Hz, ");
+	consoleSendInt32(pInfo->bitrateKbps);
+	if (pInfo->flags & TRACK_INFO_VBR)
+		consoleSendString(" kbps VBR, ");
+	else
+		consoleSendString(" kbps, ");
+	if (trackGetChannels(t) == 1)
+		consoleSendString("mono, ");
+	else
+		consoleSendString("stereo, ");
+	consoleSendInt32(trackGetDurationMs(t));
+	consoleSendString(" ms\n\r");
+}
+
 //*****************************************************************************
 // consoleNewLine
 //*****************************************************************************
@@ -449,13 +1136,17 @@ uint8_t i;
 		gTxBuffer[iPtr] = 0x0d;
 		if (++iPtr >= TX_BUFFER_SIZE)
 			iPtr = 0;
-		if (iPtr == gTxOutPtr)
+		if (iPtr == gTxOutPtr) {
+			gConsoleDrops++;
 			return false;
+		}
 		gTxBuffer[iPtr] = 0x0a;
 		if (++iPtr >= TX_BUFFER_SIZE)
 			iPtr = 0;
-		if (iPtr == gTxOutPtr)
+		if (iPtr == gTxOutPtr) {
+			gConsoleDrops++;
 			return false;
+		}
 	}
 	gTxInPtr = iPtr;
 	biosStartSerialXmt();
@@ -479,8 +1170,10 @@ uint8_t len;
 		gTxBuffer[iPtr] = pMsg[i];
 		if (++iPtr >= TX_BUFFER_SIZE)
 			iPtr = 0;
-		if (iPtr == gTxOutPtr)
+		if (iPtr == gTxOutPtr) {
+			gConsoleDrops++;
 			return false;
+		}
 	}
 	gTxInPtr = iPtr;
 	biosStartSerialXmt();
@@ -503,14 +1196,82 @@ uint8_t i;
 		gTxBuffer[iPtr] = pMsg[i];
 		if (++iPtr >= TX_BUFFER_SIZE)
 			iPtr = 0;
-		if (iPtr == gTxOutPtr)
+		if (iPtr == gTxOutPtr) {
+			gConsoleDrops++;
 			return false;
+		}
 	}
 	gTxInPtr = iPtr;
 	biosStartSerialXmt();
 	return true;
 }
 
+//*****************************************************************************
+// consoleStartGen
+//*****************************************************************************
+// Starts a generator for a command with more output than the transmit
+//  buffer can take at once. consoleService calls it with step 0, 1, 2...
+//  each time there's CONSOLE_GEN_MIN_FREE bytes free, until it returns
+//  false. Each step should send no more than that. Only one generator runs
+//  at a time, so a second command on the same line, ie. "help;prof", is
+//  turned away rather than cutting the first one off.
+//*****************************************************************************
+void consoleStartGen(CONSOLE_GEN_FUNC gen) {
+
+	if (conGen != NULL) {
+		consoleSendString("Output busy\n\r");
+		return;
+	}
+	conGen = gen;
+	conGenStep = 0;
+}
+
+//*****************************************************************************
+// consoleTxFree
+//*****************************************************************************
+// Returns the free space in the transmit buffer.
+//*****************************************************************************
+uint16_t consoleTxFree(void) {
+
+	return (uint16_t)(gTxOutPtr + TX_BUFFER_SIZE - gTxInPtr - 1) % TX_BUFFER_SIZE;
+}
+
+//*****************************************************************************
+// consoleBusy
+//*****************************************************************************
+// Returns true if there are received bytes to process, a generator that
+//  can take its next step, or a held command line that can now run.
+//*****************************************************************************
+bool consoleBusy(void) {
+
+	if ((conGen != NULL) && (consoleTxFree() >= CONSOLE_GEN_MIN_FREE))
+		return true;
+	if (conLineReady)
+		return (conGen == NULL);
+	return (gRxInPtr != gRxOutPtr);
+}
+
+//*****************************************************************************
+// consoleGetDrops
+//*****************************************************************************
+uint32_t consoleGetDrops(void) {
+
+	return gConsoleDrops;
+}
+
+//*****************************************************************************
+// consoleSendSigned
+//*****************************************************************************
+bool consoleSendSigned(int32_t n) {
+
+	if (n < 0) {
+		if (!consoleSendString("-"))
+			return false;
+		n = -n;
+	}
+	return consoleSendInt32((uint32_t)n);
+}
+
 //*****************************************************************************
 // consoleSendInt32
 //*****************************************************************************
@@ -536,7 +1297,7 @@ uint8_t k = 0;
 		k++;		
 	}
 	i = 0;
-	while (((sBuf[i] == 0x30) || (sBuf[i] == 0x2c)) && (i < 13))
+	while (((sBuf[i] == 0x30) || (sBuf[i] == 0x2c)) && (i < 12))
 		i++;
 	sBuf[13] = 0;
 	return consoleSendString(&sBuf[i]);
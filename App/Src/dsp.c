@@ -32,11 +32,22 @@
 
 extern uint16_t gMidiPitchUp;			// MIDI pitch bend up
 extern uint16_t gMidiPitchDn;			// MIDI pitch bend down
+extern MP3_VOICE_STRUCTURE mp3[];		// Our mp3 voices
+extern q15_t gMP3VoiceBuff[];			// Voice mix buffer
 
 
 // ****************************************************************************
 // Global variables
 
+// Cycles to mix one buffer on the old and the fused paths, measured at boot
+//  by dspMixBenchmark().
+uint32_t gMixCycles[2];
+
+// Output dither state
+uint32_t gDitherSeed = DITHER_SEED;
+uint8_t gDitherMode = DITHER_TPDF;
+q31_t gShapeErrL = 0;
+q31_t gShapeErrR = 0;
 
 // In order not to have to use floating point math, we use a lookup table
 //  to convert dB Gain values to linear Q1_15 values that we need for volume
@@ -209,6 +220,143 @@ q15_t gain_tble[] = {
 		30935,
 		32767
 };
+
+// Constant-power pan table. Entry i is sin(i * pi / 256) in Q1_15, so a pan
+//  position p from 0 (left) to 128 (right) gives a left gain of
+//  pan_tble[128 - p] and a right gain of pan_tble[p]. Also calculated
+//  off-line.
+
+q15_t pan_tble[] = {
+		0,
+		402,
+		804,
+		1206,
+		1608,
+		2009,
+		2411,
+		2811,
+		3212,
+		3612,
+		4011,
+		4410,
+		4808,
+		5205,
+		5602,
+		5998,
+		6393,
+		6787,
+		7180,
+		7571,
+		7962,
+		8351,
+		8740,
+		9127,
+		9512,
+		9896,
+		10279,
+		10660,
+		11039,
+		11417,
+		11793,
+		12167,
+		12540,
+		12910,
+		13279,
+		13646,
+		14010,
+		14373,
+		14733,
+		15091,
+		15447,
+		15800,
+		16151,
+		16500,
+		16846,
+		17190,
+		17531,
+		17869,
+		18205,
+		18538,
+		18868,
+		19195,
+		19520,
+		19841,
+		20160,
+		20475,
+		20788,
+		21097,
+		21403,
+		21706,
+		22006,
+		22302,
+		22595,
+		22884,
+		23170,
+		23453,
+		23732,
+		24008,
+		24279,
+		24548,
+		24812,
+		25073,
+		25330,
+		25583,
+		25833,
+		26078,
+		26320,
+		26557,
+		26791,
+		27020,
+		27246,
+		27467,
+		27684,
+		27897,
+		28106,
+		28311,
+		28511,
+		28707,
+		28899,
+		29086,
+		29269,
+		29448,
+		29622,
+		29792,
+		29957,
+		30118,
+		30274,
+		30425,
+		30572,
+		30715,
+		30853,
+		30986,
+		31114,
+		31238,
+		31357,
+		31471,
+		31581,
+		31686,
+		31786,
+		31881,
+		31972,
+		32058,
+		32138,
+		32214,
+		32286,
+		32352,
+		32413,
+		32470,
+		32522,
+		32568,
+		32610,
+		32647,
+		32679,
+		32706,
+		32729,
+		32746,
+		32758,
+		32766,
+		32767
+};
 	
 
 //*****************************************************************************
@@ -216,6 +364,117 @@ q15_t gain_tble[] = {
 //*****************************************************************************
 void initDsp(void) {
 
+	gDitherSeed = DITHER_SEED;
+	gDitherMode = DITHER_TPDF;
+	gShapeErrL = 0;
+	gShapeErrR = 0;
+}
+
+
+//*****************************************************************************
+// dspGetDither
+//*****************************************************************************
+// Returns 32 new random bits from a xorshift LFSR. One call covers the two
+//  uniform values each for both channels of a TPDF dithered frame.
+//*****************************************************************************
+uint32_t dspGetDither(void) {
+
+uint32_t x;
+
+	x = gDitherSeed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	gDitherSeed = x;
+	return x;
+}
+
+
+//*****************************************************************************
+// dspSetDitherMode
+//*****************************************************************************
+void dspSetDitherMode(uint8_t mode) {
+
+	gShapeErrL = 0;
+	gShapeErrR = 0;
+	gDitherMode = mode;
+}
+
+
+//*****************************************************************************
+// dspGetDitherMode
+//*****************************************************************************
+uint8_t dspGetDitherMode(void) {
+
+	return gDitherMode;
+}
+
+
+//*****************************************************************************
+// dspOutput24
+//*****************************************************************************
+// Reduces the Q30 stereo master bus to 24-bit samples, left justified in
+//  32-bit I2S words, with the halves swapped for the I2S data register. The
+//  dither mode picks plain truncation, TPDF dither of +/-1 LSB, or TPDF
+//  dither with first order error feedback noise shaping, which moves the
+//  requantization noise up out of the midrange. The LFSR is stepped once
+//  per frame and its 32 bits split into the four uniform values needed.
+//*****************************************************************************
+void dspOutput24(uint32_t * pDst, q31_t * pBus, uint32_t numFrames) {
+
+q31_t inL, inR;
+q31_t vL, vR;
+q31_t outL, outR;
+q31_t errL, errR;
+uint32_t r;
+
+	switch (gDitherMode) {
+	
+		case DITHER_OFF:
+			while (numFrames > 0U) {
+				outL = __SSAT(*pBus++, 31) & DITHER_QUANT_MASK;
+				outR = __SSAT(*pBus++, 31) & DITHER_QUANT_MASK;
+				*pDst++ = __ROR((uint32_t)(outL << 1), 16);
+				*pDst++ = __ROR((uint32_t)(outR << 1), 16);
+				numFrames--;
+			}
+		break;
+		
+		case DITHER_TPDF:
+			while (numFrames > 0U) {
+				r = dspGetDither();
+				inL = *pBus++ + (q31_t)(r & DITHER_RAND_MASK) + (q31_t)((r >> 8) & DITHER_RAND_MASK) - DITHER_LSB;
+				inR = *pBus++ + (q31_t)((r >> 16) & DITHER_RAND_MASK) + (q31_t)((r >> 24) & DITHER_RAND_MASK) - DITHER_LSB;
+				outL = __SSAT(inL, 31) & DITHER_QUANT_MASK;
+				outR = __SSAT(inR, 31) & DITHER_QUANT_MASK;
+				*pDst++ = __ROR((uint32_t)(outL << 1), 16);
+				*pDst++ = __ROR((uint32_t)(outR << 1), 16);
+				numFrames--;
+			}
+		break;
+		
+		default:
+			errL = gShapeErrL;
+			errR = gShapeErrR;
+			while (numFrames > 0U) {
+				r = dspGetDither();
+				vL = __SSAT(*pBus++, 31) - errL;
+				vR = __SSAT(*pBus++, 31) - errR;
+				inL = vL + (q31_t)(r & DITHER_RAND_MASK) + (q31_t)((r >> 8) & DITHER_RAND_MASK) - DITHER_LSB;
+				inR = vR + (q31_t)((r >> 16) & DITHER_RAND_MASK) + (q31_t)((r >> 24) & DITHER_RAND_MASK) - DITHER_LSB;
+				outL = __SSAT(inL, 31) & DITHER_QUANT_MASK;
+				outR = __SSAT(inR, 31) & DITHER_QUANT_MASK;
+				// Clamp the error so a clipped sample can't upset the loop
+				errL = __SSAT(outL - vL, 10);
+				errR = __SSAT(outR - vR, 10);
+				*pDst++ = __ROR((uint32_t)(outL << 1), 16);
+				*pDst++ = __ROR((uint32_t)(outR << 1), 16);
+				numFrames--;
+			}
+			gShapeErrL = errL;
+			gShapeErrR = errR;
+		break;
+	}
 }
 
 
@@ -505,6 +764,243 @@ void arm_copy_split_q15(
 }
 
 
+//*****************************************************************************
+// arm_stereo_to_mono_q15
+//*****************************************************************************
+// Keeps the left channel of an interleaved stereo buffer. pSrc and pDst may
+//  be the same buffer since the output never overtakes the input.
+//*****************************************************************************
+void arm_stereo_to_mono_q15(
+	q15_t * pSrc,
+	q15_t * pDst,
+	uint32_t numFrames)
+{
+	q31_t inA1, inA2;
+	uint32_t blkCnt;                               /* loop counter */
+
+	/*loop Unrolling */
+	blkCnt = numFrames >> 1U;
+
+	/* Read 2 stereo frames and pack the 2 left samples into one word */
+	while (blkCnt > 0U) {
+	  
+		inA1 = *__SIMD32(pSrc)++;
+		inA2 = *__SIMD32(pSrc)++;
+		*__SIMD32(pDst)++ = __PKHBT(inA1, inA2, 16);
+
+		/* Decrement the loop counter */
+		blkCnt--;
+	}
+
+	/* If numFrames is odd, copy the last sample */
+	if (numFrames & 0x1U)
+		*pDst = *pSrc;
+}
+
+
+//*****************************************************************************
+// dspPanGains
+//*****************************************************************************
+// Combines a voice gain with a pan position (0 - 128, 64 = center) and
+//  returns the left and right gains packed in one word, left in the bottom
+//  half, ready for the mix kernels. Mono sources follow the constant-power
+//  law and are -3dB on each side at center. Stereo sources use the same
+//  curve boosted by 3dB and limited to unity, so a centered stereo track
+//  plays at its full gain on both sides.
+//*****************************************************************************
+q31_t dspPanGains(q15_t gain, uint8_t pan, bool mono) {
+
+q31_t gL, gR;
+
+	if (pan > PAN_RIGHT)
+		pan = PAN_RIGHT;
+	gL = pan_tble[PAN_RIGHT - pan];
+	gR = pan_tble[pan];
+	if (!mono) {
+		gL = __SSAT((gL * PAN_STEREO_BOOST) >> 14, 16);
+		gR = __SSAT((gR * PAN_STEREO_BOOST) >> 14, 16);
+	}
+	gL = (gL * gain) >> 15;
+	gR = (gR * gain) >> 15;
+	return __PKHBT(gL, gR, 16);
+}
+
+
+//*****************************************************************************
+// dspRampStart
+//*****************************************************************************
+// Sets up a mix gain ramp from gainStart to gainEnd (packed left/right gains)
+//  over rampFrames frames. Frames mixed after the ramp finishes use gainEnd.
+//  The gains are kept in the top halves of 32-bit accumulators so that the
+//  per-frame steps don't lose precision.
+//*****************************************************************************
+void dspRampStart(MIX_RAMP_STRUCTURE * pRamp, q31_t gainStart, q31_t gainEnd,
+					uint32_t rampFrames) {
+
+	pRamp->gEnd = gainEnd;
+	if ((gainStart == gainEnd) || (rampFrames == 0))
+		gainStart = gainEnd;
+	pRamp->gL = gainStart << 16;
+	pRamp->gR = (q31_t)(gainStart & 0xffff0000);
+	if (gainStart == gainEnd) {
+		pRamp->rampFrames = 0;
+		return;
+	}
+	pRamp->rampFrames = rampFrames;
+	pRamp->dL = ((gainEnd << 16) - pRamp->gL) / (q31_t)rampFrames;
+	pRamp->dR = ((q31_t)(gainEnd & 0xffff0000) - pRamp->gR) / (q31_t)rampFrames;
+}
+
+
+//*****************************************************************************
+// arm_mix_q15_q31
+//*****************************************************************************
+// Applies independent left and right gains to an interleaved stereo q15
+//  source and accumulates the result into the q31 mix bus in a single pass.
+//  The source can be read straight from a voice's wav buffer, so there is no
+//  copy, scale or add pass. Any part of the block that falls inside the gain
+//  ramp steps the gains per frame, the rest is mixed two frames at a time at
+//  the final gain. The halfword products compile to SMLABB/SMLATT, one MAC
+//  per sample.
+//*****************************************************************************
+void arm_mix_q15_q31(
+	q15_t * pSrc,
+	q31_t * pDst,
+	MIX_RAMP_STRUCTURE * pRamp,
+	uint32_t numFrames)
+{
+	q31_t in1, in2, g;
+	q31_t gL, gR;
+	uint32_t blkCnt;                               /* loop counter */
+
+	// Ramp section
+	blkCnt = (numFrames < pRamp->rampFrames) ? numFrames : pRamp->rampFrames;
+	numFrames -= blkCnt;
+	pRamp->rampFrames -= blkCnt;
+	gL = pRamp->gL;
+	gR = pRamp->gR;
+	while (blkCnt > 0U) {
+		in1 = read_q15x2_ia(&pSrc);
+		g = __PKHTB(gR, gL, 16);
+		*pDst++ += (q15_t)in1 * (q15_t)g;
+		*pDst++ += (in1 >> 16) * (g >> 16);
+		gL += pRamp->dL;
+		gR += pRamp->dR;
+		blkCnt--;
+	}
+	pRamp->gL = gL;
+	pRamp->gR = gR;
+	
+	// Constant gain section
+	g = pRamp->gEnd;
+	blkCnt = numFrames >> 1U;
+	while (blkCnt > 0U) {
+		in1 = read_q15x2_ia(&pSrc);
+		in2 = read_q15x2_ia(&pSrc);
+		pDst[0] += (q15_t)in1 * (q15_t)g;
+		pDst[1] += (in1 >> 16) * (g >> 16);
+		pDst[2] += (q15_t)in2 * (q15_t)g;
+		pDst[3] += (in2 >> 16) * (g >> 16);
+		pDst += 4;
+		blkCnt--;
+	}
+	if (numFrames & 1U) {
+		in1 = read_q15x2_ia(&pSrc);
+		*pDst++ += (q15_t)in1 * (q15_t)g;
+		*pDst++ += (in1 >> 16) * (g >> 16);
+	}
+}
+
+
+//*****************************************************************************
+// arm_mix_mono_q15_q31
+//*****************************************************************************
+// Same as arm_mix_q15_q31 but for a mono source, which gets upmixed to
+//  both sides of the mix bus by the left and right gains.
+//*****************************************************************************
+void arm_mix_mono_q15_q31(
+	q15_t * pSrc,
+	q31_t * pDst,
+	MIX_RAMP_STRUCTURE * pRamp,
+	uint32_t numFrames)
+{
+	q31_t in, g;
+	q31_t gL, gR;
+	uint32_t blkCnt;                               /* loop counter */
+
+	// Ramp section
+	blkCnt = (numFrames < pRamp->rampFrames) ? numFrames : pRamp->rampFrames;
+	numFrames -= blkCnt;
+	pRamp->rampFrames -= blkCnt;
+	gL = pRamp->gL;
+	gR = pRamp->gR;
+	while (blkCnt > 0U) {
+		in = *pSrc++;
+		g = __PKHTB(gR, gL, 16);
+		*pDst++ += in * (q15_t)g;
+		*pDst++ += in * (g >> 16);
+		gL += pRamp->dL;
+		gR += pRamp->dR;
+		blkCnt--;
+	}
+	pRamp->gL = gL;
+	pRamp->gR = gR;
+
+	// Constant gain section
+	g = pRamp->gEnd;
+	blkCnt = numFrames;
+	while (blkCnt > 0U) {
+		in = *pSrc++;
+		*pDst++ += in * (q15_t)g;
+		*pDst++ += in * (g >> 16);
+		blkCnt--;
+	}
+}
+
+
+//*****************************************************************************
+// dspMixBenchmark
+//*****************************************************************************
+// Measures the cycles to mix one stereo buffer of a voice with a gain ramp,
+//  first the old way (copy out of the wav buffer, ramp, then add to a q15
+//  bus) and then with the fused kernel into the q31 bus. Must be called
+//  before any voices start since it borrows voice 0's wav buffer and the
+//  voice buffer.
+//*****************************************************************************
+void dspMixBenchmark(void) {
+
+MIX_RAMP_STRUCTURE ramp;
+q15_t * pSrc = mp3[0].wavBuff;
+q15_t * pBus16 = &gMP3VoiceBuff[MIX_BUFF_SAMPLES];
+q31_t * pBus32 = (q31_t *)gMP3VoiceBuff;
+uint32_t start;
+
+	arm_fill_q15(0x1234, pSrc, MIX_BUFF_SAMPLES);
+
+	arm_fill_q15(0, pBus16, MIX_BUFF_SAMPLES);
+	start = biosGetCycleCount();
+	arm_copy_q15(pSrc, gMP3VoiceBuff, MIX_BUFF_SAMPLES);
+	arm_ramp_q15(gMP3VoiceBuff, 0x2000, 0x6000, 0, gMP3VoiceBuff, MIX_BUFF_SAMPLES);
+	arm_add_q15(pBus16, gMP3VoiceBuff, pBus16, MIX_BUFF_SAMPLES);
+	gMixCycles[MIX_BENCH_3PASS] = biosGetCycleCount() - start;
+
+	arm_fill_q31(0, pBus32, MIX_BUFF_SAMPLES);
+	start = biosGetCycleCount();
+	dspRampStart(&ramp, 0x20002000, 0x60006000, MIX_BUFF_FRAMES);
+	arm_mix_q15_q31(pSrc, pBus32, &ramp, MIX_BUFF_FRAMES);
+	gMixCycles[MIX_BENCH_FUSED] = biosGetCycleCount() - start;
+}
+
+
+//*****************************************************************************
+// dspGetMixCycles
+//*****************************************************************************
+uint32_t dspGetMixCycles(uint8_t path) {
+
+	return gMixCycles[path];
+}
+
+
 //*****************************************************************************
 // copy_q15
 //*****************************************************************************
@@ -0,0 +1,245 @@
+// ****************************************************************************
+//     Filename: EQ.C
+// Date Created: 10/19/2026
+//
+//     Comments: Master bus parametric EQ for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+#include "player.h"
+#include <math.h>
+
+
+// ****************************************************************************
+// Global variables
+
+EQ_BAND_STRUCTURE eqBand[EQ_MAX_BANDS];
+
+// Two coefficient sets. The audio interrupt filters with the active set
+//  while the console builds the other one, and the sets are swapped at the
+//  start of the next audio buffer so a change never lands mid-block.
+q31_t eqCoeffs[2][EQ_MAX_BANDS * 5];
+uint8_t eqActiveSet = 0;
+uint8_t eqPendingStages = 0;
+volatile bool eqPendingFlag = false;
+
+arm_biquad_cas_df1_32x64_ins_q31 eqLeft;
+arm_biquad_cas_df1_32x64_ins_q31 eqRight;
+q63_t eqStateL[EQ_MAX_BANDS * 4];
+q63_t eqStateR[EQ_MAX_BANDS * 4];
+
+q31_t eqBuffL[MIX_BUFF_FRAMES];
+q31_t eqBuffR[MIX_BUFF_FRAMES];
+
+
+//*****************************************************************************
+// eqInit
+//*****************************************************************************
+void eqInit(void) {
+
+uint8_t b;
+
+	for (b = 0; b < EQ_MAX_BANDS; b++) {
+		eqBand[b].type = EQ_TYPE_OFF;
+		eqBand[b].gainDb = 0;
+		eqBand[b].freqHz = 1000;
+		eqBand[b].q100 = 71;
+	}
+	eqPendingFlag = false;
+	eqActiveSet = 0;
+	arm_biquad_cas_df1_32x64_init_q31(&eqLeft, EQ_MAX_BANDS, eqCoeffs[0], eqStateL, EQ_POST_SHIFT);
+	arm_biquad_cas_df1_32x64_init_q31(&eqRight, EQ_MAX_BANDS, eqCoeffs[0], eqStateR, EQ_POST_SHIFT);
+	eqLeft.numStages = 0;
+	eqRight.numStages = 0;
+}
+
+
+//*****************************************************************************
+// eqMakeBand
+//*****************************************************************************
+// Calculates one band's biquad coefficients from the RBJ cookbook formulas
+//  and stores them in CMSIS order {b0, b1, b2, -a1, -a2}, normalized by a0
+//  and scaled down by 2^EQ_POST_SHIFT. Bands that are off get a unity
+//  pass-through.
+//*****************************************************************************
+static void eqMakeBand(EQ_BAND_STRUCTURE * pBand, q31_t * pCoeffs) {
+
+float A, w0, cosw, alpha, sqA;
+float b0, b1, b2, a0, a1, a2;
+float scale;
+
+	b0 = 1.0f;
+	b1 = 0.0f;
+	b2 = 0.0f;
+	a0 = 1.0f;
+	a1 = 0.0f;
+	a2 = 0.0f;
+
+	A = powf(10.0f, (float)pBand->gainDb / 40.0f);
+	w0 = 2.0f * PI * (float)pBand->freqHz / (float)AUDIO_SAMPLE_RATE;
+	cosw = cosf(w0);
+	alpha = sinf(w0) / (2.0f * ((float)pBand->q100 / 100.0f));
+	sqA = 2.0f * sqrtf(A) * alpha;
+
+	switch (pBand->type) {
+
+		case EQ_TYPE_PEAK:
+			b0 = 1.0f + (alpha * A);
+			b1 = -2.0f * cosw;
+			b2 = 1.0f - (alpha * A);
+			a0 = 1.0f + (alpha / A);
+			a1 = -2.0f * cosw;
+			a2 = 1.0f - (alpha / A);
+		break;
+
+		case EQ_TYPE_LOWSHELF:
+			b0 = A * ((A + 1.0f) - ((A - 1.0f) * cosw) + sqA);
+			b1 = 2.0f * A * ((A - 1.0f) - ((A + 1.0f) * cosw));
+			b2 = A * ((A + 1.0f) - ((A - 1.0f) * cosw) - sqA);
+			a0 = (A + 1.0f) + ((A - 1.0f) * cosw) + sqA;
+			a1 = -2.0f * ((A - 1.0f) + ((A + 1.0f) * cosw));
+			a2 = (A + 1.0f) + ((A - 1.0f) * cosw) - sqA;
+		break;
+
+		case EQ_TYPE_HIGHSHELF:
+			b0 = A * ((A + 1.0f) + ((A - 1.0f) * cosw) + sqA);
+			b1 = -2.0f * A * ((A - 1.0f) + ((A + 1.0f) * cosw));
+			b2 = A * ((A + 1.0f) + ((A - 1.0f) * cosw) - sqA);
+			a0 = (A + 1.0f) - ((A - 1.0f) * cosw) + sqA;
+			a1 = 2.0f * ((A - 1.0f) - ((A + 1.0f) * cosw));
+			a2 = (A + 1.0f) - ((A - 1.0f) * cosw) - sqA;
+		break;
+
+		default:
+		break;
+	}
+
+	scale = 1.0f / (a0 * (float)(1 << EQ_POST_SHIFT));
+	pCoeffs[0] = MAKEQ1_31(b0 * scale);
+	pCoeffs[1] = MAKEQ1_31(b1 * scale);
+	pCoeffs[2] = MAKEQ1_31(b2 * scale);
+	pCoeffs[3] = MAKEQ1_31(-a1 * scale);
+	pCoeffs[4] = MAKEQ1_31(-a2 * scale);
+}
+
+
+//*****************************************************************************
+// eqSetBand
+//*****************************************************************************
+// Sets up one EQ band and rebuilds the inactive coefficient set, which the
+//  audio interrupt picks up at its next buffer. Returns false if any of the
+//  parameters are out of range.
+//*****************************************************************************
+bool eqSetBand(uint8_t band, uint8_t type, uint16_t freqHz, int8_t gainDb, uint16_t q100) {
+
+uint8_t b;
+uint8_t set;
+uint8_t numStages;
+
+	if ((band >= EQ_MAX_BANDS) || (type >= EQ_NUM_TYPES))
+		return false;
+	if ((freqHz < EQ_MIN_FREQ) || (freqHz > EQ_MAX_FREQ))
+		return false;
+	if ((gainDb < -EQ_MAX_GAIN_DB) || (gainDb > EQ_MAX_GAIN_DB))
+		return false;
+	if ((q100 < EQ_MIN_Q100) || (q100 > EQ_MAX_Q100))
+		return false;
+
+	eqBand[band].type = type;
+	eqBand[band].freqHz = freqHz;
+	eqBand[band].gainDb = gainDb;
+	eqBand[band].q100 = q100;
+
+	// Hold off the swap while we build. The interrupt can't change the
+	//  active set once the pending flag is clear.
+	eqPendingFlag = false;
+	set = eqActiveSet ^ 1;
+
+	// Only run the stages up to the last band that's on
+	numStages = 0;
+	for (b = 0; b < EQ_MAX_BANDS; b++) {
+		eqMakeBand(&eqBand[b], &eqCoeffs[set][b * 5]);
+		if (eqBand[b].type != EQ_TYPE_OFF)
+			numStages = b + 1;
+	}
+	eqPendingStages = numStages;
+	eqPendingFlag = true;
+	return true;
+}
+
+
+//*****************************************************************************
+// eqGetBand
+//*****************************************************************************
+EQ_BAND_STRUCTURE * eqGetBand(uint8_t band) {
+
+	return &eqBand[band];
+}
+
+
+//*****************************************************************************
+// eqProcess
+//*****************************************************************************
+// Called by the audio interrupt to filter the master bus in place. The
+//  CMSIS biquads work on one channel at a time, so the interleaved bus is
+//  split into left and right buffers on the way in and merged back on the
+//  way out. The filter state is kept across a coefficient swap, which the
+//  direct form I structure tolerates without clicks.
+//*****************************************************************************
+void eqProcess(q31_t * pBus, uint32_t numFrames) {
+
+uint32_t n;
+uint8_t s;
+q31_t * pSrc;
+
+	// Swap in new coefficients at the buffer boundary. Stages that weren't
+	//  running before start from silence.
+	if (eqPendingFlag) {
+		eqActiveSet ^= 1;
+		for (s = eqLeft.numStages; s < eqPendingStages; s++) {
+			memset((uint8_t *)&eqStateL[s * 4], 0, 4 * sizeof(q63_t));
+			memset((uint8_t *)&eqStateR[s * 4], 0, 4 * sizeof(q63_t));
+		}
+		eqLeft.pCoeffs = eqCoeffs[eqActiveSet];
+		eqRight.pCoeffs = eqCoeffs[eqActiveSet];
+		eqLeft.numStages = eqPendingStages;
+		eqRight.numStages = eqPendingStages;
+		eqPendingFlag = false;
+	}
+
+	if (eqLeft.numStages == 0)
+		return;
+
+	pSrc = pBus;
+	for (n = 0; n < numFrames; n++) {
+		eqBuffL[n] = *pSrc++ >> EQ_HEADROOM_BITS;
+		eqBuffR[n] = *pSrc++ >> EQ_HEADROOM_BITS;
+	}
+
+	arm_biquad_cas_df1_32x64_q31(&eqLeft, eqBuffL, eqBuffL, numFrames);
+	arm_biquad_cas_df1_32x64_q31(&eqRight, eqBuffR, eqBuffR, numFrames);
+
+	for (n = 0; n < numFrames; n++) {
+		*pBus++ = __SSAT(eqBuffL[n], 32 - EQ_HEADROOM_BITS) << EQ_HEADROOM_BITS;
+		*pBus++ = __SSAT(eqBuffR[n], 32 - EQ_HEADROOM_BITS) << EQ_HEADROOM_BITS;
+	}
+}
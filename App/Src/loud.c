@@ -0,0 +1,432 @@
+// ****************************************************************************
+//     Filename: LOUD.C
+// Date Created: 10/19/2026
+//
+//     Comments: Track loudness analysis for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+#include "player.h"
+#include "spiritMP3Dec.h"
+#include <math.h>
+
+
+// ****************************************************************************
+// External variables
+
+extern TRACK_STRUCTURE track[];				// Our track structure array
+extern TRACK_INFO_STRUCTURE trackInfo[];		// Our track info array
+extern uint8_t gSdBuff[];					// General SD buffer
+extern q15_t gDecodeOutputBuffer[];			// Decoder output buffer
+extern TSpiritMP3Decoder loudDecoder;		// Our analysis decoder
+
+
+// ****************************************************************************
+// Global variables
+
+bool gLoudNormFlag = true;					// Apply loudness offsets
+int8_t gLoudTarget = LOUD_TARGET_LUFS;		// Normalization target
+
+uint16_t gLoudIndex = 0;					// Next track to look at
+bool gLoudBusyFlag = false;					// Measuring gLoudTrack
+uint16_t gLoudTrack;
+uint8_t loudNumChannels;
+FIL loudFile;
+
+// K-weighting filters, pre-filter shelf then RLB high-pass, per channel
+arm_biquad_cas_df1_32x64_ins_q31 loudFiltL;
+arm_biquad_cas_df1_32x64_ins_q31 loudFiltR;
+q31_t loudCoeffs[2 * 5];
+q63_t loudStateL[2 * 4];
+q63_t loudStateR[2 * 4];
+q31_t loudBuffL[MIX_BUFF_FRAMES];
+q31_t loudBuffR[MIX_BUFF_FRAMES];
+
+// Gating. 400ms blocks overlap by 75%, so we keep the energy of the last
+//  four 100ms sub-blocks. Blocks above the absolute gate go into a
+//  histogram so the relative gate can be applied at the end.
+uint32_t loudSubFrames;						// Frames per 100ms sub-block
+uint32_t loudFrameCnt;
+uint32_t loudNumSubs;
+uint64_t loudSubSum;
+float loudSub[4];
+uint32_t loudHistCnt[LOUD_HIST_BINS];
+float loudHistSum[LOUD_HIST_BINS];
+
+
+//*****************************************************************************
+// loudReadCallback
+//*****************************************************************************
+// Feeds the analysis decoder from the file. The decoder's input buffer is
+//  in CCM RAM, which the SDIO DMA can't reach, and FatFs reads whole sectors
+//  straight into the caller's buffer, so the reads go through gSdBuff.
+//*****************************************************************************
+static unsigned int loudReadCallback(void * pMP3CompressedData,
+							 unsigned int nMP3DataSizeInChars,
+							 void * token) {
+uint8_t * pDst;
+UINT req;
+UINT br;
+unsigned int total;
+
+	UNUSED(token);
+	pDst = (uint8_t *)pMP3CompressedData;
+	total = 0;
+	while (total < nMP3DataSizeInChars) {
+		req = nMP3DataSizeInChars - total;
+		if (req > LOUD_READ_BYTES)
+			req = LOUD_READ_BYTES;
+		if (f_read(&loudFile, gSdBuff, req, &br) != FR_OK)
+			break;
+		memcpy(&pDst[total], gSdBuff, br);
+		total += br;
+		if (br < req)
+			break;
+	}
+	return total;
+}
+
+
+//*****************************************************************************
+// loudMakeFilters
+//*****************************************************************************
+// Calculates the BS.1770 K-weighting biquads for sample rate fs.
+//*****************************************************************************
+static void loudMakeFilters(uint32_t fs) {
+
+float K, Vh, Vb, a0, Q;
+float c[10];
+uint8_t i;
+
+	// Stage 1, high shelf
+	K = tanf(PI * 1681.974450955533f / (float)fs);
+	Q = 0.7071752369554196f;
+	Vh = powf(10.0f, 3.999843853973347f / 20.0f);
+	Vb = powf(Vh, 0.4996667741545416f);
+	a0 = 1.0f + (K / Q) + (K * K);
+	c[0] = (Vh + (Vb * K / Q) + (K * K)) / a0;
+	c[1] = 2.0f * ((K * K) - Vh) / a0;
+	c[2] = (Vh - (Vb * K / Q) + (K * K)) / a0;
+	c[3] = -2.0f * ((K * K) - 1.0f) / a0;
+	c[4] = -(1.0f - (K / Q) + (K * K)) / a0;
+
+	// Stage 2, high-pass
+	K = tanf(PI * 38.13547087602444f / (float)fs);
+	Q = 0.5003270373238773f;
+	a0 = 1.0f + (K / Q) + (K * K);
+	c[5] = 1.0f;
+	c[6] = -2.0f;
+	c[7] = 1.0f;
+	c[8] = -2.0f * ((K * K) - 1.0f) / a0;
+	c[9] = -(1.0f - (K / Q) + (K * K)) / a0;
+
+	for (i = 0; i < 10; i++)
+		loudCoeffs[i] = MAKEQ1_31(c[i] / (float)(1 << LOUD_POST_SHIFT));
+	arm_biquad_cas_df1_32x64_init_q31(&loudFiltL, 2, loudCoeffs, loudStateL, LOUD_POST_SHIFT);
+	arm_biquad_cas_df1_32x64_init_q31(&loudFiltR, 2, loudCoeffs, loudStateR, LOUD_POST_SHIFT);
+}
+
+
+//*****************************************************************************
+// loudInit
+//*****************************************************************************
+// Loads the saved loudness values for tracks that haven't changed. Must be
+//  called after trackInit().
+//*****************************************************************************
+void loudInit(void) {
+
+FIL fil;
+UINT br;
+uint16_t t;
+uint16_t i;
+LOUD_ENTRY_STRUCTURE * pEntry;
+
+	gLoudIndex = 0;
+	gLoudBusyFlag = false;
+	if (f_open(&fil, LOUD_FILE_NAME, FA_READ) != FR_OK)
+		return;
+	t = 0;
+	while (t < MAX_NUM_TRACKS) {
+		if ((f_read(&fil, gSdBuff, 8192, &br) != FR_OK) || (br == 0))
+			break;
+		pEntry = (LOUD_ENTRY_STRUCTURE *)gSdBuff;
+		for (i = 0; (i < (br / sizeof(LOUD_ENTRY_STRUCTURE))) && (t < MAX_NUM_TRACKS); i++, t++) {
+			if ((track[t].flags & TRACK_FLAG_EXISTS) && (pEntry[i].mark == LOUD_ENTRY_MARK) &&
+				(pEntry[i].fileSize == track[t].fileSize.lSize)) {
+				trackInfo[t].loudness = pEntry[i].lufs;
+				trackInfo[t].flags |= TRACK_INFO_LOUD;
+			}
+		}
+	}
+	f_close(&fil);
+}
+
+
+//*****************************************************************************
+// loudSave
+//*****************************************************************************
+static void loudSave(uint16_t t) {
+
+FIL fil;
+UINT bw;
+LOUD_ENTRY_STRUCTURE entry;
+
+	if (f_open(&fil, LOUD_FILE_NAME, FA_OPEN_ALWAYS | FA_WRITE) != FR_OK)
+		return;
+	entry.fileSize = track[t].fileSize.lSize;
+	entry.lufs = trackInfo[t].loudness;
+	entry.mark = LOUD_ENTRY_MARK;
+	entry.reserved = 0;
+	if (f_lseek(&fil, (FSIZE_t)t * sizeof(LOUD_ENTRY_STRUCTURE)) == FR_OK)
+		f_write(&fil, &entry, sizeof(LOUD_ENTRY_STRUCTURE), &bw);
+	f_close(&fil);
+}
+
+
+//*****************************************************************************
+// loudStart
+//*****************************************************************************
+static bool loudStart(uint16_t t) {
+
+uint32_t fs;
+
+	if (!trackOpen(t, &loudFile))
+		return false;
+	fs = trackGetSampleRate(t);
+	if (fs == 0) {
+		f_close(&loudFile);
+		return false;
+	}
+	loudNumChannels = trackGetChannels(t);
+	SpiritMP3DecoderInit(&loudDecoder, loudReadCallback, NULL, NULL);
+	loudMakeFilters(fs);
+	loudSubFrames = fs / 10;
+	loudFrameCnt = 0;
+	loudNumSubs = 0;
+	loudSubSum = 0;
+	memset((uint8_t *)loudHistCnt, 0, sizeof(loudHistCnt));
+	memset((uint8_t *)loudHistSum, 0, sizeof(loudHistSum));
+	gLoudTrack = t;
+	gLoudBusyFlag = true;
+	return true;
+}
+
+
+//*****************************************************************************
+// loudAddSubBlock
+//*****************************************************************************
+// Closes a 100ms sub-block and, once there are four, gates the 400ms block
+//  that ends with it.
+//*****************************************************************************
+static void loudAddSubBlock(void) {
+
+float z;
+float l;
+int32_t bin;
+
+	loudSub[loudNumSubs & 3] = (float)loudSubSum / ((float)loudSubFrames * 1073741824.0f);
+	loudSubSum = 0;
+	loudNumSubs++;
+	if (loudNumSubs < 4)
+		return;
+
+	z = (loudSub[0] + loudSub[1] + loudSub[2] + loudSub[3]) * 0.25f;
+	if (z <= 0.0f)
+		return;
+	l = -0.691f + (10.0f * log10f(z));
+	if (l <= (float)LOUD_ABS_GATE_LUFS)
+		return;
+	bin = (int32_t)((l - (float)LOUD_ABS_GATE_LUFS) * LOUD_HIST_BINS_PER_LU);
+	if (bin >= LOUD_HIST_BINS)
+		bin = LOUD_HIST_BINS - 1;
+	loudHistCnt[bin]++;
+	loudHistSum[bin] += z;
+}
+
+
+//*****************************************************************************
+// loudFinish
+//*****************************************************************************
+// Applies the relative gate and stores the integrated loudness.
+//*****************************************************************************
+static void loudFinish(void) {
+
+uint32_t cnt;
+float sum;
+float gate;
+int32_t bin;
+int32_t first;
+float l;
+
+	f_close(&loudFile);
+	gLoudBusyFlag = false;
+
+	cnt = 0;
+	sum = 0.0f;
+	for (bin = 0; bin < LOUD_HIST_BINS; bin++) {
+		cnt += loudHistCnt[bin];
+		sum += loudHistSum[bin];
+	}
+	if (cnt == 0)
+		l = (float)LOUD_ABS_GATE_LUFS;
+	else {
+		gate = -0.691f + (10.0f * log10f(sum / (float)cnt)) - (float)LOUD_REL_GATE_LU;
+		first = (int32_t)((gate - (float)LOUD_ABS_GATE_LUFS) * LOUD_HIST_BINS_PER_LU);
+		if (first < 0)
+			first = 0;
+		cnt = 0;
+		sum = 0.0f;
+		for (bin = first; bin < LOUD_HIST_BINS; bin++) {
+			cnt += loudHistCnt[bin];
+			sum += loudHistSum[bin];
+		}
+		l = -0.691f + (10.0f * log10f(sum / (float)cnt));
+	}
+
+	trackInfo[gLoudTrack].loudness = (int8_t)(l - 0.5f);
+	trackInfo[gLoudTrack].flags |= TRACK_INFO_LOUD;
+	loudSave(gLoudTrack);
+}
+
+
+//*****************************************************************************
+// loudService
+//*****************************************************************************
+// Called from the main loop only while no voices are playing. Each call
+//  decodes and measures one granule of the track being analyzed, so the
+//  loop stays responsive, and the analysis picks up where it left off when
+//  playback stops.
+//*****************************************************************************
+void loudService(void) {
+
+uint32_t numFrames;
+uint32_t n, i, blk;
+q15_t * pSrc;
+q31_t yL, yR;
+
+	// Find the next track that needs measuring
+	if (!gLoudBusyFlag) {
+		while (gLoudIndex < MAX_NUM_TRACKS) {
+			n = gLoudIndex++;
+			if ((track[n].flags & TRACK_FLAG_EXISTS) &&
+				((trackInfo[n].flags & TRACK_INFO_LOUD) == 0)) {
+				if (loudStart(n))
+					break;
+			}
+		}
+		if (!gLoudBusyFlag)
+			return;
+	}
+
+	numFrames = SpiritMP3Decode(&loudDecoder, (short *)gDecodeOutputBuffer,
+					MP3_FRAME_SIZE_IN_FRAMES, NULL);
+	if (numFrames == 0) {
+		loudFinish();
+		return;
+	}
+
+	pSrc = gDecodeOutputBuffer;
+	for (n = 0; n < numFrames; n += blk) {
+		blk = numFrames - n;
+		if (blk > MIX_BUFF_FRAMES)
+			blk = MIX_BUFF_FRAMES;
+		for (i = 0; i < blk; i++) {
+			loudBuffL[i] = (q31_t)*pSrc++ << LOUD_INPUT_SHIFT;
+			loudBuffR[i] = (q31_t)*pSrc++ << LOUD_INPUT_SHIFT;
+		}
+		arm_biquad_cas_df1_32x64_q31(&loudFiltL, loudBuffL, loudBuffL, blk);
+		if (loudNumChannels != 1)
+			arm_biquad_cas_df1_32x64_q31(&loudFiltR, loudBuffR, loudBuffR, blk);
+		for (i = 0; i < blk; i++) {
+			yL = loudBuffL[i] >> LOUD_INPUT_SHIFT;
+			loudSubSum += (uint64_t)((int64_t)yL * yL);
+			if (loudNumChannels != 1) {
+				yR = loudBuffR[i] >> LOUD_INPUT_SHIFT;
+				loudSubSum += (uint64_t)((int64_t)yR * yR);
+			}
+			if (++loudFrameCnt >= loudSubFrames) {
+				loudFrameCnt = 0;
+				loudAddSubBlock();
+			}
+		}
+	}
+}
+
+
+//*****************************************************************************
+// loudBusy
+//*****************************************************************************
+// Returns true while there are tracks left to measure.
+//*****************************************************************************
+bool loudBusy(void) {
+
+	return (gLoudBusyFlag || (gLoudIndex < MAX_NUM_TRACKS));
+}
+
+
+//*****************************************************************************
+// loudGetOffsetDb
+//*****************************************************************************
+// Returns the gain offset that brings track t to the normalization target,
+//  or 0 if it hasn't been measured or normalization is off.
+//*****************************************************************************
+int8_t loudGetOffsetDb(uint16_t t) {
+
+int16_t offset;
+
+	if (!gLoudNormFlag || (t >= MAX_NUM_TRACKS) || ((trackInfo[t].flags & TRACK_INFO_LOUD) == 0))
+		return 0;
+	offset = gLoudTarget - trackInfo[t].loudness;
+	if (offset > LOUD_MAX_OFFSET_DB)
+		offset = LOUD_MAX_OFFSET_DB;
+	else if (offset < -LOUD_MAX_OFFSET_DB)
+		offset = -LOUD_MAX_OFFSET_DB;
+	return (int8_t)offset;
+}
+
+
+//*****************************************************************************
+// loudSetNormalize
+//*****************************************************************************
+void loudSetNormalize(bool enable, int8_t targetLufs) {
+
+	gLoudNormFlag = enable;
+	gLoudTarget = targetLufs;
+}
+
+
+//*****************************************************************************
+// loudGetNormalize
+//*****************************************************************************
+bool loudGetNormalize(void) {
+
+	return gLoudNormFlag;
+}
+
+
+//*****************************************************************************
+// loudGetTarget
+//*****************************************************************************
+int8_t loudGetTarget(void) {
+
+	return gLoudTarget;
+}
@@ -0,0 +1,357 @@
+// ****************************************************************************
+//     Filename: MDCTEQ.C
+// Date Created: 10/19/2026
+//
+//     Comments: MDCT domain voice EQ for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+#include "player.h"
+#include <math.h>
+
+
+// ****************************************************************************
+// External variables
+
+extern MDCT_EQ_STRUCTURE mdctEq[];			// Our voice MDCT EQ array
+extern q15_t gDecodeOutputBuffer[];			// Decoder output buffer
+extern MP3_VOICE_STRUCTURE mp3[];			// Our mp3 voices
+
+
+// ****************************************************************************
+// Global variables
+
+// Cycles to equalize one stereo granule in the MDCT domain and with a
+//  5 band biquad cascade in the time domain, measured at boot by
+//  mdctEqBenchmark().
+uint32_t gMdctEqCycles[2];
+
+// Degrade under load settings and state
+uint8_t gDegradeOnLoad = MDCT_DEGRADE_ON_LOAD;
+uint8_t gDegradeOffLoad = MDCT_DEGRADE_OFF_LOAD;
+uint16_t gDegradeCutoffHz = MDCT_DEGRADE_CUTOFF_HZ;
+bool gDegradeFlag = false;
+
+static void mdctEqSetCutoff(uint8_t v);
+
+
+//*****************************************************************************
+// mdctEqInit
+//*****************************************************************************
+void mdctEqInit(void) {
+
+uint8_t v;
+
+	for (v = 0; v < MAX_NUM_MP3_VOICES; v++) {
+		memset((uint8_t *)&mdctEq[v], 0, sizeof(MDCT_EQ_STRUCTURE));
+		mdctEq[v].sampleRate = AUDIO_SAMPLE_RATE;
+		mdctEqSetCutoff(v);
+	}
+}
+
+
+//*****************************************************************************
+// mdctEqSetCutoff
+//*****************************************************************************
+// Works out where the degrade cutoff falls in voice v's MDCT lines and
+//  subbands for its sample rate.
+//*****************************************************************************
+static void mdctEqSetCutoff(uint8_t v) {
+
+uint32_t tmp32;
+
+	tmp32 = ((uint32_t)gDegradeCutoffHz * 2 * MDCT_LINES) / mdctEq[v].sampleRate;
+	mdctEq[v].cutLine = (tmp32 > MDCT_LINES) ? MDCT_LINES : tmp32;
+	tmp32 = ((uint32_t)gDegradeCutoffHz * 2 * MDCT_SUBBANDS) / mdctEq[v].sampleRate;
+	mdctEq[v].cutSubband = (tmp32 > MDCT_SUBBANDS) ? MDCT_SUBBANDS : tmp32;
+}
+
+
+//*****************************************************************************
+// mdctEqGainAt
+//*****************************************************************************
+// Returns the EQ curve's linear gain at frequency f. The curve is linear in
+//  dB between band centers on a log frequency scale and flat beyond the
+//  outer bands.
+//*****************************************************************************
+static float mdctEqGainAt(uint8_t v, float f) {
+
+float pos;
+float dB;
+uint8_t b;
+
+	pos = log2f(f / MDCT_EQ_FIRST_CENTER);
+	if (pos <= 0.0f)
+		dB = (float)mdctEq[v].bandDb[0];
+	else if (pos >= (float)(MDCT_EQ_BANDS - 1))
+		dB = (float)mdctEq[v].bandDb[MDCT_EQ_BANDS - 1];
+	else {
+		b = (uint8_t)pos;
+		pos -= (float)b;
+		dB = ((1.0f - pos) * (float)mdctEq[v].bandDb[b]) +
+				(pos * (float)mdctEq[v].bandDb[b + 1]);
+	}
+	return powf(10.0f, dB / 20.0f);
+}
+
+
+//*****************************************************************************
+// mdctEqUpdate
+//*****************************************************************************
+// Maps the band gains onto the MDCT lines for the voice's sample rate. Long
+//  blocks have 576 lines evenly spaced from 0 to half the sample rate. Short
+//  blocks only resolve down to the 32 polyphase subbands, so they get one
+//  gain per subband of 18 values.
+//*****************************************************************************
+static void mdctEqUpdate(uint8_t v) {
+
+uint16_t k;
+uint8_t b;
+float binHz;
+
+	mdctEq[v].active = false;
+	for (b = 0; b < MDCT_EQ_BANDS; b++) {
+		if (mdctEq[v].bandDb[b] != 0)
+			mdctEq[v].active = true;
+	}
+	if (!mdctEq[v].active)
+		return;
+
+	binHz = (float)mdctEq[v].sampleRate / (2.0f * MDCT_LINES);
+	for (k = 0; k < MDCT_LINES; k++)
+		mdctEq[v].longGain[k] = MAKEQ3_13(mdctEqGainAt(v, ((float)k + 0.5f) * binHz));
+
+	binHz = (float)mdctEq[v].sampleRate / (2.0f * MDCT_SUBBANDS);
+	for (k = 0; k < MDCT_SUBBANDS; k++)
+		mdctEq[v].shortGain[k] = MAKEQ3_13(mdctEqGainAt(v, ((float)k + 0.5f) * binHz));
+}
+
+
+//*****************************************************************************
+// mdctEqSetBand
+//*****************************************************************************
+// Sets one band of voice v's EQ. The decode tier reads the gain tables
+//  mid-granule, so it's held off while they're rebuilt and the new gains
+//  take effect cleanly at the next granule.
+//*****************************************************************************
+bool mdctEqSetBand(uint8_t v, uint8_t band, int8_t gainDb) {
+
+	if ((v >= MAX_NUM_MP3_VOICES) || (band >= MDCT_EQ_BANDS))
+		return false;
+	if ((gainDb < -MDCT_EQ_MAX_GAIN_DB) || (gainDb > MDCT_EQ_MAX_GAIN_DB))
+		return false;
+	voicesDecodeLock();
+	mdctEq[v].bandDb[band] = gainDb;
+	mdctEqUpdate(v);
+	voicesDecodeUnlock();
+	return true;
+}
+
+
+//*****************************************************************************
+// mdctEqGetBand
+//*****************************************************************************
+int8_t mdctEqGetBand(uint8_t v, uint8_t band) {
+
+	return mdctEq[v].bandDb[band];
+}
+
+
+//*****************************************************************************
+// mdctEqSetRate
+//*****************************************************************************
+// Called when a voice opens a file, since the MDCT lines scale with the
+//  file's sample rate, not the output rate. The caller holds the decode lock.
+//*****************************************************************************
+void mdctEqSetRate(uint8_t v, uint32_t sampleRate) {
+
+	if (sampleRate == 0)
+		sampleRate = AUDIO_SAMPLE_RATE;
+	if (sampleRate == mdctEq[v].sampleRate)
+		return;
+	mdctEq[v].sampleRate = sampleRate;
+	mdctEqSetCutoff(v);
+	mdctEqUpdate(v);
+}
+
+
+//*****************************************************************************
+// mdctEqProcess
+//*****************************************************************************
+// SpiritMP3 processing callback, called once per granule and channel with
+//  the 576 fixed point MDCT coefficients before the inverse transform. The
+//  token is the voice number. Applies the voice EQ and, when we're degrading
+//  under load, zeroes everything above the cutoff for voices that aren't
+//  locked.
+//*****************************************************************************
+void mdctEqProcess(void * mdct_samples, int isShort, int ch, void * token) {
+
+uint8_t v;
+int32_t * pX;
+q15_t * pG;
+int64_t acc;
+uint16_t k;
+uint8_t sb;
+q15_t g;
+bool cutFlag;
+
+	UNUSED(ch);
+	v = *(uint8_t *)token;
+	cutFlag = gDegradeFlag && !mp3[v].lockFlag;
+	if (!mdctEq[v].active && !cutFlag)
+		return;
+
+	profileStart(PROF_MDCT_EQ);
+	pX = (int32_t *)mdct_samples;
+	if (cutFlag) {
+		if (!isShort)
+			k = mdctEq[v].cutLine;
+		else
+			k = mdctEq[v].cutSubband * MDCT_LINES_PER_SUBBAND;
+		memset((uint8_t *)&pX[k], 0, (MDCT_LINES - k) * sizeof(int32_t));
+	}
+	if (!mdctEq[v].active) {
+		profileEnd(PROF_MDCT_EQ);
+		return;
+	}
+	if (!isShort) {
+		pG = mdctEq[v].longGain;
+		for (k = 0; k < MDCT_LINES; k++) {
+			acc = ((int64_t)*pX * *pG++) >> 13;
+			*pX++ = (acc > INT32_MAX) ? INT32_MAX : ((acc < INT32_MIN) ? INT32_MIN : (int32_t)acc);
+		}
+	}
+	else {
+		for (sb = 0; sb < MDCT_SUBBANDS; sb++) {
+			g = mdctEq[v].shortGain[sb];
+			for (k = 0; k < MDCT_LINES_PER_SUBBAND; k++) {
+				acc = ((int64_t)*pX * g) >> 13;
+				*pX++ = (acc > INT32_MAX) ? INT32_MAX : ((acc < INT32_MIN) ? INT32_MIN : (int32_t)acc);
+			}
+		}
+	}
+	profileEnd(PROF_MDCT_EQ);
+}
+
+
+//*****************************************************************************
+// mdctDegradeSet
+//*****************************************************************************
+// Sets the load thresholds (percent) and cutoff frequency for degrading
+//  voices under load. The decode tier is held off while the voices' cutoff
+//  lines change.
+//*****************************************************************************
+void mdctDegradeSet(uint8_t onLoad, uint8_t offLoad, uint16_t cutoffHz) {
+
+uint8_t v;
+
+	voicesDecodeLock();
+	gDegradeOnLoad = onLoad;
+	gDegradeOffLoad = offLoad;
+	gDegradeCutoffHz = cutoffHz;
+	for (v = 0; v < MAX_NUM_MP3_VOICES; v++)
+		mdctEqSetCutoff(v);
+	voicesDecodeUnlock();
+}
+
+
+//*****************************************************************************
+// mdctDegradeService
+//*****************************************************************************
+// Called from the main loop to switch degrading on and off from the CPU
+//  load meter, with hysteresis so it doesn't flap.
+//*****************************************************************************
+void mdctDegradeService(void) {
+
+uint8_t load;
+
+	load = profileGetLoad();
+	if (!gDegradeFlag && (load >= gDegradeOnLoad))
+		gDegradeFlag = true;
+	else if (gDegradeFlag && (load < gDegradeOffLoad))
+		gDegradeFlag = false;
+}
+
+
+//*****************************************************************************
+// mdctDegradeIsActive
+//*****************************************************************************
+bool mdctDegradeIsActive(void) {
+
+	return gDegradeFlag;
+}
+
+
+//*****************************************************************************
+// mdctDegradeGetCutoff
+//*****************************************************************************
+uint16_t mdctDegradeGetCutoff(void) {
+
+	return gDegradeCutoffHz;
+}
+
+
+//*****************************************************************************
+// mdctEqBenchmark
+//*****************************************************************************
+// Measures the cycles to equalize one stereo granule (576 frames) in the
+//  MDCT domain against running the same frames through a 5 band biquad
+//  cascade in the time domain. Borrows voice 0's EQ and the decoder output
+//  buffer, so it must run before any voices start.
+//*****************************************************************************
+void mdctEqBenchmark(void) {
+
+int32_t * pX = (int32_t *)gDecodeOutputBuffer;
+uint8_t token = 0;
+uint32_t start;
+arm_biquad_cas_df1_32x64_ins_q31 bq;
+q31_t coeffs[5 * 5];
+q63_t state[5 * 4];
+uint8_t b;
+
+	arm_fill_q31(0x00123456, pX, MDCT_LINES);
+
+	mdctEqSetBand(0, 0, 6);
+	start = biosGetCycleCount();
+	mdctEqProcess(pX, 0, 0, &token);
+	mdctEqProcess(pX, 0, 1, &token);
+	gMdctEqCycles[MDCT_BENCH_MDCT] = biosGetCycleCount() - start;
+	mdctEqSetBand(0, 0, 0);
+
+	arm_fill_q31(0, coeffs, 5 * 5);
+	for (b = 0; b < 5; b++)
+		coeffs[b * 5] = 1 << (31 - EQ_POST_SHIFT);
+	arm_biquad_cas_df1_32x64_init_q31(&bq, 5, coeffs, state, EQ_POST_SHIFT);
+	start = biosGetCycleCount();
+	arm_biquad_cas_df1_32x64_q31(&bq, pX, pX, MDCT_LINES);
+	arm_biquad_cas_df1_32x64_q31(&bq, pX, pX, MDCT_LINES);
+	gMdctEqCycles[MDCT_BENCH_BIQUAD] = biosGetCycleCount() - start;
+}
+
+
+//*****************************************************************************
+// mdctEqGetCycles
+//*****************************************************************************
+uint32_t mdctEqGetCycles(uint8_t path) {
+
+	return gMdctEqCycles[path];
+}
@@ -25,14 +25,33 @@
 // ****************************************************************************
 
 #include "player.h"
+#include "spiritMP3Dec.h"
 
 uint8_t gSdBuff[8192] __attribute__((aligned (32)));
 
 FATFS fatFs __attribute__((aligned (32)));
 
 MP3_VOICE_STRUCTURE mp3[MAX_NUM_MP3_VOICES] __attribute__((aligned (32)));
+FIL mp3File[MAX_NUM_MP3_VOICES] __attribute__((aligned (4)));
+RESAMPLE_STRUCTURE mp3Resample[MAX_NUM_MP3_VOICES] __attribute__((aligned (4)));
 TRACK_STRUCTURE track[MAX_NUM_TRACKS];
 
+// The track info table is only touched by the CPU, so keep it in CCM RAM.
+//  The .ccmbss section isn't loaded or zeroed by the startup code, so these
+//  are set up by trackInit(), mdctEqInit() and loudStart().
+TRACK_INFO_STRUCTURE trackInfo[MAX_NUM_TRACKS] __attribute__((section(".ccmbss")));
+MDCT_EQ_STRUCTURE mdctEq[MAX_NUM_MP3_VOICES] __attribute__((section(".ccmbss")));
+TSpiritMP3Decoder loudDecoder __attribute__((section(".ccmbss")));
+
 q15_t gVoiceSdBuff[SAMPLES_PER_BLOCK] __attribute__((aligned (32)));
 
+// The mix bus is interleaved stereo q31, full scale at Q30. The mix kernels
+//  add q15 samples times q15 gains, and the gains top out at 0x7fff, so one
+//  voice peaks at 0x8000 * 0x7fff = 2^30 - 2^15. Two voices stay within
+//  2^31 - 2^16, which leaves room for the dither before dspOutput24()
+//  saturates the bus back to Q30. A third voice could wrap the bus.
+q31_t gMixBus[MIX_BUFF_SAMPLES] __attribute__((aligned (4)));
+uint32_t gAudioBuff[AUDIO_BUFF_SAMPLES] __attribute__((aligned (32)));
+uint16_t gTrigBuff[TRIG_BUFF_SAMPLES] __attribute__((aligned (4)));
+
 
@@ -37,7 +37,10 @@ extern MP3_VOICE_STRUCTURE mp3[];	// Our MP3 voice structure array
 
 extern q15_t gain_tble[];			// Our gain table
 
-//extern TRACK_STRUCTURE track[];	// Our track structure array
+extern TRACK_STRUCTURE track[];	// Our track structure array
+
+extern FIL mp3File[];				// Our MP3 voice file objects
+extern RESAMPLE_STRUCTURE mp3Resample[];	// Our MP3 voice resamplers
 
 extern uint8_t gNumMP3Voices;		//
 
@@ -46,6 +49,7 @@ extern uint8_t gNumMP3Voices;		//
 // Global variables
 
 q15_t gMP3VoiceBuff[(MIX_BUFF_SAMPLES * 2) + 4] __attribute__((aligned (4)));
+volatile uint32_t gUnderruns = 0;		// Buffers a voice ran short of audio
 
 
 //*****************************************************************************
@@ -103,8 +107,51 @@ void mp3SetCurrentGain(uint8_t v, int16_t gain) {
 	
 	// If our fader is active, stop it
 	mp3[v].fader.active = false;
-	mp3[v].currGainIdx = dBtoIndex(gain);
+	mp3[v].currGainIdx = dBtoIndex(gain + mp3[v].gainOffsetDb);
 	mp3[v].currGain = gain_tble[mp3[v].currGainIdx];
+	mp3[v].currGainLR = dspPanGains(mp3[v].currGain, mp3[v].pan, (mp3[v].numChannels == 1));
+}
+
+
+//*****************************************************************************
+// mp3SetPan
+//*****************************************************************************
+// Sets the voice pan position, 0 (left) to 128 (right). The mix kernel ramps
+//  to the new left and right gains over the next audio buffer.
+//*****************************************************************************
+void mp3SetPan(uint8_t v, uint8_t pan) {
+	
+	if (pan > PAN_RIGHT)
+		pan = PAN_RIGHT;
+	mp3[v].pan = pan;
+}
+
+
+//*****************************************************************************
+// mp3SetPitch
+//*****************************************************************************
+void mp3SetPitch(uint8_t v, int16_t cents) {
+	
+	resampleSetPitch(&mp3Resample[v], cents);
+}
+
+
+//*****************************************************************************
+// mp3GetRunwayFrames
+//*****************************************************************************
+// Returns how many output frames the voice can produce from the audio it
+//  has already decoded. A voice that's pitched up burns through its wav
+//  buffer faster, so this is what the decode scheduler goes by.
+//*****************************************************************************
+uint32_t mp3GetRunwayFrames(uint8_t v) {
+
+uint32_t frames;
+
+	frames = mp3GetWavSamples(v) / mp3[v].numChannels;
+	if (!mp3Resample[v].active)
+		return frames;
+	frames += mp3Resample[v].histFrames;
+	return (uint32_t)(((uint64_t)frames << 16) / mp3Resample[v].inc);
 }
 
 
@@ -127,7 +174,7 @@ uint32_t tmp32;
 	// Handle times < 3m separately
 	if (mTime < 3) {
 		mp3[v].fader.shortFade = mTime;
-		mp3[v].fader.targGainIdx = dBtoIndex(gain);
+		mp3[v].fader.targGainIdx = dBtoIndex(gain + mp3[v].gainOffsetDb);
 		mp3[v].fader.stopFlag = fStop;
 		mp3[v].fader.shortFadeDone = false;
 		mp3[v].fader.active = true;
@@ -136,7 +183,7 @@ uint32_t tmp32;
 	
 	// Calculate the delta gain index for the fade. Return now
 	//  if we're already there
-	mp3[v].fader.targGainIdx = dBtoIndex(gain);
+	mp3[v].fader.targGainIdx = dBtoIndex(gain + mp3[v].gainOffsetDb);
 	if (mp3[v].fader.targGainIdx == mp3[v].currGainIdx)
 		return;
 
@@ -245,10 +292,15 @@ bool mp3ServiceFader(uint8_t v)
 //*****************************************************************************
 // mp3OpenFile
 //*****************************************************************************
-uint16_t mp3OpenFile(uint8_t v, uint16_t t, int16_t gainDb) {
-/*
+// Opens track t on voice v and decodes the first frames. A looping voice
+//  rewinds to the start of the audio, past any ID3 tag, each time the SD
+//  reads reach the end of the file.
+//*****************************************************************************
+uint16_t mp3OpenFile(uint8_t v, uint16_t t, int16_t gainDb, bool loop) {
+
 uint8_t *sdBuff;
 q15_t newGain;
+UINT br;
 						   					   
 	// Do some sanity checking						   
 	if ((v >= MAX_NUM_MP3_VOICES) || (t >= MAX_NUM_TRACKS))
@@ -256,37 +308,62 @@ q15_t newGain;
 	if ((track[t].flags & TRACK_FLAG_EXISTS) == 0)
 		return VOICE_ERR_BADINDEX;	
 		
-	// We'll read the first DOUBLE block directly into our wav buffer	
+	// We'll read the first DOUBLE block directly into our mp3 buffer	
 	sdBuff = (uint8_t *)&mp3[v].buff[0];
 	
-	if (!openFileByIndex(t, v, sdBuff))
-		return VOICE_ERR_BADINDEX;
+	if (!trackOpen(t, &mp3File[v]))
+		return VOICE_ERR_BADOPEN;
+	if (f_read(&mp3File[v], sdBuff, BYTES_PER_BLOCK * 2, &br) != FR_OK)
+		return VOICE_ERR_BADOPEN;
 
 	mp3[v].mp3OutPtr = 0;
-	mp3[v].mp3InPtr = BYTES_PER_BLOCK * 2;
-	mp3[v].bytesSdRead = BYTES_PER_BLOCK * 2;
+	mp3[v].mp3InPtr = br;
+	mp3[v].bytesSdRead = br;
 	mp3[v].bytesFetched = 0;
+	mp3[v].loopStart = trackGetId3Bytes(sdBuff, br);
+	if (mp3[v].loopStart >= track[t].fileSize.lSize)
+		mp3[v].loopStart = 0;
+	mp3[v].loopsPending = 0;
+	mp3[v].loopCount = 0;
 	mp3[v].framesPlayed = 0;
 	
 	mp3[v].wavInPtr = 0;
 	mp3[v].wavOutPtr = 0;
 			
 	mp3[v].stopReqFlag = false;
-	mp3[v].loopFlag = false;
+	mp3[v].loopFlag = loop;
 	mp3[v].lockFlag = false;
-	mp3[v].eofFlag = false;
+	mp3[v].eofFlag = (br < (BYTES_PER_BLOCK * 2));
+	mp3[v].decodeDoneFlag = false;
 	mp3[v].track = t;
 	mp3[v].size = track[t].fileSize;
+
+	// Mono files get a mono wav buffer. If the track hasn't been probed
+	//  successfully, fall back to stereo.
+	mp3[v].numChannels = trackGetChannels(t);
+	if (mp3[v].numChannels == 0)
+		mp3[v].numChannels = 2;
+
+	// Files that aren't at our output rate get resampled
+	resampleReset(&mp3Resample[v], trackGetSampleRate(t), resampleGetQuality());
+	mdctEqSetRate(v, trackGetSampleRate(t));
 	
-	// Set initial gain	
-	mp3[v].currGainIdx = dBtoIndex(gainDb);
+	// Set initial gain, offset to the normalization target if the track's
+	//  loudness has been measured
+	mp3[v].gainOffsetDb = loudGetOffsetDb(t);
+	mp3[v].currGainIdx = dBtoIndex(gainDb + mp3[v].gainOffsetDb);
 	newGain = gain_tble[mp3[v].currGainIdx];
 	mp3[v].currGain = newGain;
+	mp3[v].pan = PAN_CENTER;
+	mp3[v].currGainLR = dspPanGains(newGain, PAN_CENTER, (mp3[v].numChannels == 1));
 	
+	mp3DecodeReset(v);
 	while (mp3CheckWavSpace(v)) {
-		mp3DecodeWavData(v);
+		if (mp3DecodeWavData(v) == 0) {
+			mp3[v].decodeDoneFlag = true;
+			break;
+		}
 	}
-*/	
 	return VOICE_ERR_NOERROR;
 }
 
@@ -311,23 +388,47 @@ uint16_t tp;
 	return false;
 }
 
+//*****************************************************************************
+// mp3LoopRewind
+//*****************************************************************************
+// Called when the SD reads for voice v have reached the end of the file.
+//  If the voice is looping and hasn't been told to stop, seeks back to the
+//  start of the audio so the reads carry on from there. The decoder reaches
+//  the rewind when it fetches the last byte before it.
+//*****************************************************************************
+static bool mp3LoopRewind(uint8_t v) {
+
+	if (!mp3[v].loopFlag || mp3[v].stopReqFlag || (mp3[v].fader.active && mp3[v].fader.stopFlag))
+		return false;
+	if (mp3[v].loopsPending == 0xff)
+		return false;
+	if (f_lseek(&mp3File[v], mp3[v].loopStart) != FR_OK)
+		return false;
+	mp3[v].bytesSdRead = mp3[v].loopStart;
+	mp3[v].eofFlag = false;
+	mp3[v].loopsPending++;
+	return true;
+}
+
 //*****************************************************************************
 // mp3ReadSdMp3Data
 //*****************************************************************************
 // This function reads the next block from the SD MP3 file into the voice's
 //  MP3 buffer. It should only be called after checking that there's enough
 //  room by calling mp3CheckSdMp3Space(). It returns the number of bytes
-//  read, which will be less than a block if we reach the end of the file.
+//  read, which will be less than a block if we reach the end of the file,
+//  and 0 once there's nothing more to read.
 //*****************************************************************************
 int16_t mp3ReadSdMp3Data(uint8_t v)
 {
 	
 uint32_t b;
+uint32_t tmp32;
 uint16_t tmp16;
 uint8_t * srcPtr;
 uint8_t * dstPtr;
 	
-	if (mp3[v].eofFlag)
+	if (mp3[v].eofFlag && !mp3LoopRewind(v))
 		return 0;
 	
 	if ((b = mp3[v].size.lSize - mp3[v].bytesSdRead) > BYTES_PER_BLOCK)
@@ -336,8 +437,12 @@ uint8_t * dstPtr;
 	// Set up our source and destination pointers for the copy
 	dstPtr = &mp3[v].buff[mp3[v].mp3InPtr];
 	
-	//if (!readNextBlock(v, (uint8_t *)gVoiceSdBuff))
-	//	return 0;
+	profileStart(PROF_SD_READ);
+	if (f_read(&mp3File[v], gVoiceSdBuff, BYTES_PER_BLOCK, (UINT *)&tmp32) != FR_OK) {
+		profileEnd(PROF_SD_READ);
+		return 0;
+	}
+	profileEnd(PROF_SD_READ);
 	
 	srcPtr = &gVoiceSdBuff[0];
 
@@ -382,13 +487,26 @@ uint16_t mp3FetchMp3Data(uint8_t v, uint8_t *pDest, uint16_t reqBytes) {
 
 uint32_t b;
 uint32_t numBytes;
+uint32_t loopBytes;
 uint32_t tmp32;
 uint16_t nReturn;
 
 uint8_t *ptrSrc = &mp3[v].buff[mp3[v].mp3OutPtr];
 uint8_t *ptrDst = pDest;
 	
-	if ((numBytes = mp3[v].size.lSize - mp3[v].bytesFetched) > reqBytes)
+	// If the reads have rewound a looping voice, the buffer carries on with
+	//  the start of the audio after the end of the file, so the fetch can run
+	//  straight across the loop point. bytesFetched can pass through a
+	//  wrapped value here, but it's back in the file once numBytes is added.
+	numBytes = mp3[v].size.lSize - mp3[v].bytesFetched;
+	loopBytes = mp3[v].size.lSize - mp3[v].loopStart;
+	while ((numBytes < reqBytes) && (mp3[v].loopsPending > 0)) {
+		mp3[v].loopsPending--;
+		mp3[v].loopCount++;
+		mp3[v].bytesFetched -= loopBytes;
+		numBytes += loopBytes;
+	}
+	if (numBytes > reqBytes)
 		numBytes = reqBytes;
 	mp3[v].bytesFetched += numBytes;
 	nReturn = numBytes;
@@ -426,18 +544,36 @@ uint8_t *ptrDst = pDest;
 bool mp3CheckWavSpace(uint8_t v) {
 	
 uint16_t tp;
+uint16_t frameSamples;
 	
+	// A mono voice only needs half the space for a decoded frame
+	frameSamples = MP3_FRAME_SIZE_IN_FRAMES * mp3[v].numChannels;
+
 	tp = mp3[v].wavOutPtr;
 	if (mp3[v].wavInPtr >= tp ) {
-		if ((MP3_WAV_BUFFER_SIZE - (mp3[v].wavInPtr - tp)) > MP3_FRAME_SIZE_IN_SAMPLES)
+		if ((MP3_WAV_BUFFER_SIZE - (mp3[v].wavInPtr - tp)) > frameSamples)
 			return true;
 	}
-	else if ((tp - mp3[v].wavInPtr) > MP3_FRAME_SIZE_IN_SAMPLES)
+	else if ((tp - mp3[v].wavInPtr) > frameSamples)
 		return true;
 	return false;
 }
 
 
+//*****************************************************************************
+// mp3GetWavSamples
+//*****************************************************************************
+// Returns the number of samples waiting in the voice's wav buffer. Since
+//  mp3CheckWavSpace never lets the buffer fill, equal pointers mean empty.
+//*****************************************************************************
+uint16_t mp3GetWavSamples(uint8_t v) {
+
+	if (mp3[v].wavInPtr >= mp3[v].wavOutPtr)
+		return mp3[v].wavInPtr - mp3[v].wavOutPtr;
+	return MP3_WAV_BUFFER_SIZE - (mp3[v].wavOutPtr - mp3[v].wavInPtr);
+}
+
+
 // ****************************************************************************
 // voiceFetchWavData
 // ****************************************************************************
@@ -466,7 +602,7 @@ uint16_t tmp16;
 	
 	ptrSrc = pSrc;
 	ptrDst = &mp3[v].wavBuff[mp3[v].wavInPtr];
-	numSamples = numFrames * 2;
+	numSamples = numFrames * mp3[v].numChannels;
 	
 	if ((tmp16 = (MP3_WAV_BUFFER_SIZE - mp3[v].wavInPtr)) >= numSamples) {
 		arm_copy_q15(ptrSrc, ptrDst, numSamples);
@@ -488,6 +624,48 @@ uint16_t tmp16;
 }
 
 
+//*****************************************************************************
+// mp3ReadWavFrames
+//*****************************************************************************
+// Reads numFrames from the voice's wav buffer into separate left and right
+//  buffers for the resampler. Mono voices only fill pDstL. If we run out
+//  of decoded audio the balance is filled with silence. Returns the number
+//  of frames actually read.
+//*****************************************************************************
+uint16_t mp3ReadWavFrames(uint8_t v, q15_t * pDstL, q15_t * pDstR, uint16_t numFrames) {
+
+uint16_t n;
+uint16_t numRead;
+uint16_t outPtr;
+q15_t * pSrc;
+
+	numRead = mp3GetWavSamples(v) / mp3[v].numChannels;
+	if (numRead > numFrames)
+		numRead = numFrames;
+
+	outPtr = mp3[v].wavOutPtr;
+	pSrc = &mp3[v].wavBuff[outPtr];
+	for (n = 0; n < numRead; n++) {
+		*pDstL++ = *pSrc++;
+		if (mp3[v].numChannels != 1)
+			*pDstR++ = *pSrc++;
+		outPtr += mp3[v].numChannels;
+		if (outPtr >= MP3_WAV_BUFFER_SIZE) {
+			outPtr = 0;
+			pSrc = &mp3[v].wavBuff[0];
+		}
+	}
+	mp3[v].wavOutPtr = outPtr;
+
+	if (numRead < numFrames) {
+		arm_fill_q15(0, pDstL, numFrames - numRead);
+		if (mp3[v].numChannels != 1)
+			arm_fill_q15(0, pDstR, numFrames - numRead);
+	}
+	return numRead;
+}
+
+
 //*****************************************************************************
 // Function:    mp3GetAudio
 //*****************************************************************************
@@ -495,8 +673,13 @@ uint16_t tmp16;
 //  sample frames from the voice's decoded wav buffer. Because of the way the
 //  code is structure, there should always be this many samples available UN-
 //  LESS we have reached the end of the mp3 file.
+//
+// The voice gain and pan are applied in the same pass that accumulates the
+//  voice into the q31 mix bus. Unless the voice is being resampled, the mix
+//  kernel reads straight out of the wav buffer, so the samples are touched
+//  once. Mono voices are upmixed by the mix kernel.
 //*****************************************************************************
-bool mp3GetAudio(uint8_t v, q15_t * pDest, uint16_t reqFrames) {
+bool mp3GetAudio(uint8_t v, q31_t * pDest, uint16_t reqFrames) {
 
 uint16_t reqSamples;
 uint16_t numSamples;
@@ -504,22 +687,28 @@ uint16_t n;
 uint32_t samplesInBuffer;
 uint32_t tmp32;
 q15_t newGain;
+q31_t newLR;
+uint8_t nCh;
+MIX_RAMP_STRUCTURE ramp;
+RESAMPLE_STRUCTURE * pRs;
+void (*pMix)(q15_t *, q31_t *, MIX_RAMP_STRUCTURE *, uint32_t);
 
 q15_t * qPtrSrc;
-q15_t * qPtrDst;
 	
-	reqSamples = 2 * reqFrames;
+	nCh = mp3[v].numChannels;
+	reqSamples = nCh * reqFrames;
 	
 	numSamples = reqSamples;
 	
 	// If there aren't enough samples in the buffer, adjust the count
-	if (mp3[v].wavInPtr > mp3[v].wavOutPtr)
-		samplesInBuffer = mp3[v].wavInPtr - mp3[v].wavOutPtr;
-	else
-		samplesInBuffer = MP3_WAV_BUFFER_SIZE - (mp3[v].wavOutPtr - mp3[v].wavInPtr);
+	samplesInBuffer = mp3GetWavSamples(v);
 	if (samplesInBuffer < reqSamples)
 		numSamples = samplesInBuffer;
 
+	// Once the decoder is done and we've played everything, we're finished
+	if (mp3[v].decodeDoneFlag && (samplesInBuffer == 0))
+		return true;
+
 	// Check for a stop request
 	if (mp3[v].stopReqFlag) {
 		if (mp3[v].currGainIdx > 0)
@@ -532,47 +721,13 @@ q15_t * qPtrDst;
 	if (mp3ServiceFader(v))
 		return true;
 
-	qPtrSrc = &mp3[v].wavBuff[mp3[v].wavOutPtr];
-	qPtrDst = &gMP3VoiceBuff[0];
-	
-	// If this read doesn't wrap the end of the wav buffer
-	if ((tmp32 = (MP3_WAV_BUFFER_SIZE - mp3[v].wavOutPtr)) >= numSamples) {
-						
-		// Copy the requested number of samples to the destination mono
-		//  buffers
-		arm_copy_q15(qPtrSrc, qPtrDst, numSamples);
-		qPtrDst += numSamples;
-		mp3[v].wavOutPtr += numSamples;
-	}
-	
-	// Else we have to wrap. Tmp32
-	//  contains the number of samples to the end of the buffer
-	else {	
-		n = tmp32;		
-		arm_copy_q15(qPtrSrc, qPtrDst, n);
-		qPtrDst += n;
-		qPtrSrc = &mp3[v].wavBuff[0];
-		n = numSamples - tmp32;
-		arm_copy_q15(qPtrSrc, qPtrDst, n);
-		qPtrDst += n;
-		mp3[v].wavOutPtr = n;
-	}
-
-	// If end of file, fill balance with silence
-	if (numSamples != reqSamples) {	
-		numSamples = (reqSamples - numSamples);
-		arm_fill_q15(0, qPtrDst, numSamples);
-	}
-
-/*	
-	// Calculate a new gain value based on the current voice gain index and the output
-	//  gain index.
+	// Calculate the new left and right gains from the current voice gain
+	//  index and pan position, and set up the ramp to them.
 	newGain = gain_tble[mp3[v].currGainIdx];
+	newLR = dspPanGains(newGain, mp3[v].pan, (nCh == 1));
 	
-	// Apply track gain to the data in the source buffer and mix
-	//  results to the destination buffer
-	if (newGain == mp3[v].currGain) {
-		arm_scale_q15(gMP3VoiceBuff, mp3[v].currGain, 0, gMP3VoiceBuff, reqSamples);
+	if (newLR == mp3[v].currGainLR) {
+		dspRampStart(&ramp, newLR, newLR, 0);
 		mp3[v].fader.shortFade = 0;
 		mp3[v].fader.shortFadeDone = true;
 	}
@@ -580,25 +735,62 @@ q15_t * qPtrDst;
 		
 		// If fading over the whole buffer
 		if (mp3[v].fader.shortFade == 0) {
-			arm_ramp_q15(gMP3VoiceBuff, mp3[v].currGain, newGain, 0, gMP3VoiceBuff, reqSamples);
-			mp3[v].currGain = newGain;
+			dspRampStart(&ramp, mp3[v].currGainLR, newLR, reqFrames);
 		}
 		
 		// Short fade
 		else {
-			tmp32 = reqSamples / 3;
+			tmp32 = reqFrames / 3;
 			if (mp3[v].fader.shortFade == 2)
 				tmp32 = tmp32 << 1;
-			arm_ramp_q15(gMP3VoiceBuff, mp3[v].currGain, newGain, 0, gMP3VoiceBuff, tmp32);
-			arm_scale_q15(&gMP3VoiceBuff[tmp32], newGain, 0, &gMP3VoiceBuff[tmp32], reqSamples - tmp32);
-			mp3[v].currGain = newGain;
+			dspRampStart(&ramp, mp3[v].currGainLR, newLR, tmp32);
 			mp3[v].fader.shortFade = 0;
 			mp3[v].fader.shortFadeDone = true;
-		}			
+		}
+		mp3[v].currGain = newGain;
+		mp3[v].currGainLR = newLR;
+	}
+	
+	// If the file isn't at our output rate, the resampler pulls what it
+	//  needs from the wav buffer and produces a stereo voice buffer
+	if (mp3Resample[v].active) {
+		pRs = &mp3Resample[v];
+		n = resampleGetInputFrames(pRs, reqFrames);
+		if ((mp3ReadWavFrames(v, &pRs->histL[pRs->histFrames], &pRs->histR[pRs->histFrames], n) < n) &&
+			!mp3[v].decodeDoneFlag)
+			gUnderruns++;
+		pRs->histFrames += n;
+		resampleProcess(pRs, gMP3VoiceBuff, reqFrames, nCh);
+		arm_mix_q15_q31(gMP3VoiceBuff, pDest, &ramp, reqFrames);
+	}
+	else {
+		if ((numSamples < reqSamples) && !mp3[v].decodeDoneFlag)
+			gUnderruns++;
+		if (nCh == 1)
+			pMix = arm_mix_mono_q15_q31;
+		else
+			pMix = arm_mix_q15_q31;
+		qPtrSrc = &mp3[v].wavBuff[mp3[v].wavOutPtr];
+	
+		// If this read doesn't wrap the end of the wav buffer
+		if ((tmp32 = (MP3_WAV_BUFFER_SIZE - mp3[v].wavOutPtr)) >= numSamples) {
+			pMix(qPtrSrc, pDest, &ramp, numSamples / nCh);
+			mp3[v].wavOutPtr += numSamples;
+		}
+	
+		// Else we have to wrap. Tmp32
+		//  contains the number of samples to the end of the buffer
+		else {	
+			pMix(qPtrSrc, pDest, &ramp, tmp32 / nCh);
+			pDest += (tmp32 / nCh) * 2;
+			n = numSamples - tmp32;
+			pMix(&mp3[v].wavBuff[0], pDest, &ramp, n / nCh);
+			mp3[v].wavOutPtr = n;
+		}
+		
+		// If end of file, the balance is silence, which adds nothing to the
+		//  mix bus
 	}
-*/	
-	// Add the result to the destination output mix buffer
-	arm_add_q15(pDest, gMP3VoiceBuff, pDest, reqSamples);
 	
 	mp3[v].framesPlayed += reqFrames;
 
@@ -606,3 +798,25 @@ q15_t * qPtrDst;
 
 }
 
+
+//*****************************************************************************
+// mp3GetUnderruns
+//*****************************************************************************
+// Returns the number of times a voice that was still decoding didn't have
+//  enough audio for a buffer.
+//*****************************************************************************
+uint32_t mp3GetUnderruns(void) {
+
+	return gUnderruns;
+}
+
+
+//*****************************************************************************
+// mp3GetLoops
+//*****************************************************************************
+// Returns the number of times voice v has looped back to the start.
+//*****************************************************************************
+uint16_t mp3GetLoops(uint8_t v) {
+
+	return mp3[v].loopCount;
+}
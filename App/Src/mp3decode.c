@@ -62,9 +62,11 @@ uint16_t numBytes;
 	// Grab the voice number for this stream
 	v = *(uint8_t *)token;
 								 
-	// Make sure we have a full buffer of SD MP3 data
+	// Make sure we have a full buffer of SD MP3 data, or everything left in
+	//  the file
 	while (mp3CheckSdMp3Space(v)) {
-		mp3ReadSdMp3Data(v);
+		if (mp3ReadSdMp3Data(v) == 0)
+			break;
 	}
 	
 	// Copy the request number of MP3 bytes to the decoders destination buffer
@@ -84,10 +86,20 @@ uint8_t v;
 			
 	for (v = 0; v < MAX_NUM_MP3_VOICES; v++) {
 		gMP3VoiceNum[v] = v;
-		SpiritMP3DecoderInit( &g_MP3Decoder[v], mp3DecodeCallback, NULL, &gMP3VoiceNum[v]);
+		SpiritMP3DecoderInit( &g_MP3Decoder[v], mp3DecodeCallback, mdctEqProcess, &gMP3VoiceNum[v]);
 	}
 }
 
+//*****************************************************************************
+// mp3DecodeReset
+//*****************************************************************************
+// Resets the decoder for voice v before starting a new file.
+//*****************************************************************************
+void mp3DecodeReset(uint8_t v) {
+
+	SpiritMP3DecoderInit( &g_MP3Decoder[v], mp3DecodeCallback, mdctEqProcess, &gMP3VoiceNum[v]);
+}
+
 //*****************************************************************************
 // mp3DecodeNewData
 //*****************************************************************************
@@ -107,6 +119,11 @@ uint16_t numFrames;
 		}
 	}
 			
+	// The decoder always produces stereo. For mono files, keep just the left
+	//  channel so the voice's wav buffer only holds one sample per frame.
+	if (mp3[v].numChannels == 1)
+		arm_stereo_to_mono_q15(gDecodeOutputBuffer, gDecodeOutputBuffer, numFrames);
+
 	mp3PutWavData(v, (q15_t *)&gDecodeOutputBuffer, numFrames);
 	
 	//DEBUG0_OFF;
@@ -47,10 +47,17 @@ volatile uint32_t gMsTicks = 0;				// our global system tick variable
 volatile uint16_t gLED0_timeout = 0;		// LED timeout counter
 volatile uint32_t lastHeartBeatTicks = 0;
 volatile uint32_t lastSdCardCheckTicks = 0;
+uint32_t lastLoopCycles = 0;
+bool gLowPowerFlag = false;					// Slow the tick when not playing
 
 char gVersion[] = {VERSION_STRING};			// Our version string
 char gNewLine[] = {0x0d, 0x0a, 0x00};		// New line character string
 
+// Local functions
+
+static void sdTestIdle(void);
+static void sdTestSetTick(uint8_t ms);
+
 
 // ****************************************************************************
 // sdTestInit
@@ -71,21 +78,35 @@ void sdTestInit(void) {
 		gSysFlags |= SYS_NO_SDCARD;
 	}
 
-	// Initialize our MP3 voices
-	for (int v = 0; v < MAX_NUM_MP3_VOICES; v++) {
-		memset((uint8_t *)&mp3[v], 0, sizeof(MP3_VOICE_STRUCTURE));
-		mp3[v].state = VOICE_STATE_AVAIL;
-		mp3[v].fader.active = false;
-	}
-	gNumMP3Voices = MAX_NUM_MP3_VOICES;
-	mp3DecodeInit();
-
-	// Initialize our tracks
-	if (trackInit(&gNumMp3Tracks))
+	// Initialize our MP3 voices with flat voice EQs
+	mdctEqInit();
+	voicesInit();
+
+	// Build the resampler tables and measure what each quality tier and the
+	//  voice mix costs
+	resampleInit();
+	resampleBenchmark();
+	dspMixBenchmark();
+	mdctEqBenchmark();
+
+	// Start the audio output with a flat master EQ
+	profileReset();
+	initDsp();
+	eqInit();
+	audioInit();
+	triggerInit();
+
+	// Initialize our tracks and the trigger map
+	if (!trackInit((uint16_t *)&gNumMp3Tracks))
 		gSysFlags |= SYS_FILESYS_ERROR;
+	else
+		loudInit();
+	actionInit();
 
-	// Initialize the ASCII serial console interface
+	// Initialize the ASCII serial console, binary protocol and telemetry
 	consoleInit();
+	protoInit();
+	telemInit();
 
 	// Blink appropriately
 	if (gSysFlags == 0)
@@ -94,6 +115,7 @@ void sdTestInit(void) {
 		doBlink(BLINK_ERR);
 		
 	lastHeartBeatTicks = gMsTicks;
+	lastLoopCycles = biosGetCycleCount();
 }
 
 
@@ -103,9 +125,18 @@ void sdTestInit(void) {
 void sdTestProcess(void)
 {
 
+uint32_t now;
+
+	// Measure the main loop pass time
+	now = biosGetCycleCount();
+	profileLatency(LAT_LOOP, now - lastLoopCycles);
+	lastLoopCycles = now;
+
 	// ================== MAIN LOOP TASK 1 ===================
-	// Service the ASCII serial console
+	// Service the ASCII serial console, binary protocol and telemetry
 	consoleService();
+	protoService();
+	telemService();
 
 	// ================== MAIN LOOP TASK 2 ===================
 	// Service the heartbeat LED
@@ -127,6 +158,92 @@ void sdTestProcess(void)
 		}
 	}
 
+	// ================== MAIN LOOP TASK 4 ===================
+	// Start tracks for trigger presses. The voices' wav buffers are kept
+	//  topped up by the decode tier in PendSV.
+	triggerService();
+	voicesService();
+
+	// ================== MAIN LOOP TASK 5 ===================
+	// Probe the next track header and measure track loudness in the
+	//  background, when nothing is playing, primed or waiting to start
+	if ((gSysFlags == 0) && voicesIdle()) {
+		trackProbeService();
+		voicesDecodeLock();
+		loudService();
+		voicesDecodeUnlock();
+	}
+
+	// ================== MAIN LOOP TASK 6 ===================
+	// Update the CPU load meter and degrade unlocked voices if overloaded
+	profileService();
+	voicesDecodeLock();
+	mdctDegradeService();
+	voicesDecodeUnlock();
+
+#ifndef PLAYER_RTOS
+	// ================== MAIN LOOP TASK 7 ===================
+	// Slow the tick down when nothing is playing, if allowed, and sleep
+	//  until the next interrupt if there's nothing left to do
+	if (gLowPowerFlag && (voicesCheck() == 0) && !voicesBusy())
+		sdTestSetTick(SD_TEST_LOW_POWER_TICK_MS);
+	else
+		sdTestSetTick(1);
+	sdTestIdle();
+#endif
+}
+
+//*****************************************************************************
+// sdTestIdle
+//*****************************************************************************
+// Sleeps until the next interrupt if none of the main loop tasks has work
+//  waiting. Interrupts are held off from the check through the WFI so one
+//  that makes work in between still wakes us, and the time asleep goes to
+//  the profiler's idle fraction.
+//*****************************************************************************
+static void sdTestIdle(void) {
+
+uint32_t start;
+
+	__disable_irq();
+	if (consoleBusy() || triggerBusy() || telemBusy() || voicesBusy() ||
+			((gSysFlags == 0) && voicesIdle() && (trackProbeBusy() || loudBusy()))) {
+		__enable_irq();
+		return;
+	}
+	start = biosGetHiResTimer();
+	__WFI();
+	profileIdle(biosGetHiResTimer() - start);
+	__enable_irq();
+}
+
+//*****************************************************************************
+// sdTestSetTick
+//*****************************************************************************
+static void sdTestSetTick(uint8_t ms) {
+
+	if (biosGetTickMs() != ms)
+		biosSetTickMs(ms);
+}
+
+//*****************************************************************************
+// sdTestSetLowPower
+//*****************************************************************************
+// Allows the tick to slow down while nothing is playing. Timing done in
+//  the main loop gets coarser, but the audio interrupt and everything it
+//  drives is unaffected.
+//*****************************************************************************
+void sdTestSetLowPower(bool enable) {
+
+	gLowPowerFlag = enable;
+}
+
+//*****************************************************************************
+// sdTestGetLowPower
+//*****************************************************************************
+bool sdTestGetLowPower(void) {
+
+	return gLowPowerFlag;
 }
 
 //*****************************************************************************
@@ -137,7 +254,8 @@ void delayMs(uint32_t dlyTicks) {
 uint32_t curTicks;
 
 	curTicks = gMsTicks;
-	while ((gMsTicks - curTicks) < dlyTicks);
+	while ((gMsTicks - curTicks) < dlyTicks)
+		__WFI();
 }
 
 // *****************************************************************************
@@ -202,15 +320,23 @@ UNUSED(p);
 //*****************************************************************************
 // MyTick_Handler - Our 1ms Interrupt Routine
 //*****************************************************************************
+// The tick is slowed to 10ms in low power mode, so count the ms it stands for.
+//*****************************************************************************
 void mySysTick_Handler( void )
 {
-	gMsTicks++;
+uint32_t step;
+
+	step = (uint32_t)HAL_GetTickFreq();
+	gMsTicks += step;
 	
 	// Check to see if we're timing out any of the LEDs and turn if off if time.
 	if (gLED0_timeout > 0) {
-		if (--gLED0_timeout == 0) {
+		if (gLED0_timeout <= step) {
+			gLED0_timeout = 0;
 			biosLED(0, LED_OFF);
 		}
+		else
+			gLED0_timeout -= step;
 	}
 }
 
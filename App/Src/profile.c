@@ -0,0 +1,263 @@
+// ****************************************************************************
+//     Filename: PROFILE.C
+// Date Created: 10/19/2026
+//
+//     Comments: Cycle profiler for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+#include "player.h"
+
+
+// ****************************************************************************
+// External variables
+
+extern volatile uint32_t gMsTicks;			// Our 1ms global system tick
+
+
+// ****************************************************************************
+// Global variables
+
+PROFILE_STRUCTURE gProfile[PROF_NUM_SLOTS];
+uint32_t gLatLast[LAT_NUM_TIERS];
+uint32_t gLatPeak[LAT_NUM_TIERS];
+volatile uint32_t gProfAudioCycles = 0;		// Running total of audio interrupt cycles
+
+uint32_t profWindowStart = 0;				// Load window start, us
+uint32_t profWindowTicks = 0;				// Load window start, ms
+volatile uint8_t gCpuLoad = 0;				// CPU load in percent
+uint32_t gIdleUs = 0;						// Time asleep in this load window
+volatile uint8_t gIdlePct = 0;				// Time asleep in percent
+
+const char * profNames[PROF_NUM_SLOTS] = {
+	"Audio buffer",
+	"Voice mix   ",
+	"Master EQ   ",
+	"MDCT EQ     ",
+	"MP3 decode  ",
+	"Dither/out  ",
+	"Console cmd ",
+	"SD read     "
+};
+
+const char * latNames[LAT_NUM_TIERS] = {
+	"Audio int   ",
+	"Decode tier ",
+	"Main loop   "
+};
+
+
+//*****************************************************************************
+// profileReset
+//*****************************************************************************
+void profileReset(void) {
+
+	memset((uint8_t *)gProfile, 0, sizeof(gProfile));
+	memset((uint8_t *)gLatLast, 0, sizeof(gLatLast));
+	memset((uint8_t *)gLatPeak, 0, sizeof(gLatPeak));
+}
+
+
+//*****************************************************************************
+// profileStart
+//*****************************************************************************
+void profileStart(uint8_t slot) {
+
+	gProfile[slot].start = biosGetCycleCount();
+	gProfile[slot].audio = gProfAudioCycles;
+}
+
+
+//*****************************************************************************
+// profileEnd
+//*****************************************************************************
+// Closes a timed section and updates its last, peak and running total. Any
+//  audio interrupts that preempted the section are left out of its time.
+//*****************************************************************************
+void profileEnd(uint8_t slot) {
+
+uint32_t cycles;
+uint32_t audio;
+
+	// Read the audio total before the cycle count. An interrupt landing in
+	//  between is then left in the section, rather than being subtracted
+	//  from time it wasn't part of.
+	audio = gProfAudioCycles - gProfile[slot].audio;
+	cycles = biosGetCycleCount() - gProfile[slot].start - audio;
+	if (slot == PROF_AUDIO)
+		gProfAudioCycles += cycles;
+	gProfile[slot].last = cycles;
+	if (cycles > gProfile[slot].peak)
+		gProfile[slot].peak = cycles;
+	gProfile[slot].total += cycles;
+	gProfile[slot].count++;
+	gProfile[slot].window += cycles;
+}
+
+
+//*****************************************************************************
+// profileService
+//*****************************************************************************
+// Called from the main loop to update the CPU load meter and the idle
+//  fraction once per window. The window is timed with the microsecond timer,
+//  since the cycle counter stops while the core sleeps.
+//*****************************************************************************
+void profileService(void) {
+
+uint32_t now;
+uint32_t busy;
+uint32_t elapsed;
+uint64_t cycles;
+
+	if ((gMsTicks - profWindowTicks) < PROF_LOAD_WINDOW_MS)
+		return;
+	profWindowTicks = gMsTicks;
+
+	now = biosGetHiResTimer();
+	elapsed = now - profWindowStart;
+	profWindowStart = now;
+	if (elapsed == 0)
+		return;
+
+	if (gIdleUs >= elapsed)
+		gIdlePct = 100;
+	else
+		gIdlePct = (uint8_t)(((uint64_t)gIdleUs * 100) / elapsed);
+	gIdleUs = 0;
+
+	cycles = (uint64_t)elapsed * (SystemCoreClock / 1000000);
+
+	__disable_irq();
+	busy = gProfile[PROF_AUDIO].window + gProfile[PROF_DECODE].window;
+	gProfile[PROF_AUDIO].window = 0;
+	gProfile[PROF_DECODE].window = 0;
+	__enable_irq();
+
+	if (busy >= cycles)
+		gCpuLoad = 100;
+	else
+		gCpuLoad = (uint8_t)(((uint64_t)busy * 100) / cycles);
+}
+
+
+//*****************************************************************************
+// profileIdle
+//*****************************************************************************
+// Adds the microseconds the main loop just spent asleep to the window.
+//*****************************************************************************
+void profileIdle(uint32_t us) {
+
+	gIdleUs += us;
+}
+
+
+//*****************************************************************************
+// profileGetIdle
+//*****************************************************************************
+uint8_t profileGetIdle(void) {
+
+	return gIdlePct;
+}
+
+
+//*****************************************************************************
+// profileGetLoad
+//*****************************************************************************
+uint8_t profileGetLoad(void) {
+
+	return gCpuLoad;
+}
+
+
+//*****************************************************************************
+// profileGetName
+//*****************************************************************************
+const char * profileGetName(uint8_t slot) {
+
+	return profNames[slot];
+}
+
+
+//*****************************************************************************
+// profileGetLast
+//*****************************************************************************
+uint32_t profileGetLast(uint8_t slot) {
+
+	return gProfile[slot].last;
+}
+
+
+//*****************************************************************************
+// profileGetPeak
+//*****************************************************************************
+uint32_t profileGetPeak(uint8_t slot) {
+
+	return gProfile[slot].peak;
+}
+
+
+//*****************************************************************************
+// profileGetAverage
+//*****************************************************************************
+uint32_t profileGetAverage(uint8_t slot) {
+
+	if (gProfile[slot].count == 0)
+		return 0;
+	return (uint32_t)(gProfile[slot].total / gProfile[slot].count);
+}
+
+
+//*****************************************************************************
+// profileLatency
+//*****************************************************************************
+void profileLatency(uint8_t tier, uint32_t cycles) {
+
+	gLatLast[tier] = cycles;
+	if (cycles > gLatPeak[tier])
+		gLatPeak[tier] = cycles;
+}
+
+
+//*****************************************************************************
+// profileGetLatencyName
+//*****************************************************************************
+const char * profileGetLatencyName(uint8_t tier) {
+
+	return latNames[tier];
+}
+
+
+//*****************************************************************************
+// profileGetLatencyLast
+//*****************************************************************************
+uint32_t profileGetLatencyLast(uint8_t tier) {
+
+	return gLatLast[tier];
+}
+
+
+//*****************************************************************************
+// profileGetLatencyPeak
+//*****************************************************************************
+uint32_t profileGetLatencyPeak(uint8_t tier) {
+
+	return gLatPeak[tier];
+}
@@ -0,0 +1,413 @@
+// ****************************************************************************
+//     Filename: PROTO.C
+// Date Created: 10/19/2026
+//
+//     Comments: Binary serial protocol for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+#include "player.h"
+
+
+// ****************************************************************************
+// External variables
+
+extern volatile uint32_t gMsTicks;		// 1ms global system tick
+
+
+// ****************************************************************************
+// Global variables
+
+static const uint32_t protoBaudRates[PROTO_NUM_BAUD_RATES] = {
+	2000000, 921600, 460800, 230400, 115200, 57600, 38400, 19200, 9600
+};
+
+static const uint16_t crcNibbleTable[16] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+	0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef
+};
+
+#define PROTO_STATE_IDLE		0
+#define PROTO_STATE_LEN			1
+#define PROTO_STATE_SEQ			2
+#define PROTO_STATE_DATA		3
+#define PROTO_STATE_CRC_HI		4
+#define PROTO_STATE_CRC_LO		5
+
+uint8_t gProtoState = PROTO_STATE_IDLE;
+uint8_t gProtoLen;
+uint8_t gProtoSeq;
+uint8_t gProtoCount;
+uint16_t gProtoCrc;
+uint32_t gProtoByteTicks;
+uint8_t protoFrame[PROTO_MAX_PAYLOAD + 2];
+
+uint8_t gProtoLastSeq;
+bool gProtoLastValid = false;
+
+bool gAutobaudEnable = true;
+bool gAutobaudHunting = false;
+uint8_t gAutobaudIndex;
+uint8_t gAutobaudCount;
+uint32_t gAutobaudTicks;
+uint32_t gAutobaudErrors;
+
+
+//*****************************************************************************
+// protoInit
+//*****************************************************************************
+void protoInit(void) {
+
+	gProtoState = PROTO_STATE_IDLE;
+	gProtoLastValid = false;
+	gAutobaudHunting = false;
+	gAutobaudErrors = biosSerialGetErrors();
+	gAutobaudTicks = gMsTicks;
+}
+
+
+//*****************************************************************************
+// protoCrc16
+//*****************************************************************************
+// CRC-16/CCITT, a nibble at a time.
+//*****************************************************************************
+uint16_t protoCrc16(uint16_t crc, uint8_t * pData, uint16_t len) {
+
+	while (len--) {
+		crc = (crc << 4) ^ crcNibbleTable[(crc >> 12) ^ (*pData >> 4)];
+		crc = (crc << 4) ^ crcNibbleTable[(crc >> 12) ^ (*pData++ & 0x0f)];
+	}
+	return crc;
+}
+
+
+//*****************************************************************************
+// protoSendFrame
+//*****************************************************************************
+// Sends a frame, or nothing at all if the transmit buffer can't take the
+//  whole of it. Returns false if it wasn't sent.
+//*****************************************************************************
+bool protoSendFrame(uint8_t seq, uint8_t * pPayload, uint8_t len) {
+
+uint8_t header[3];
+uint8_t trailer[2];
+uint16_t crc;
+
+	header[0] = PROTO_SOF;
+	header[1] = len;
+	header[2] = seq;
+	crc = protoCrc16(0xffff, &header[1], 2);
+	crc = protoCrc16(crc, pPayload, len);
+	trailer[0] = crc >> 8;
+	trailer[1] = crc & 0xff;
+	if (consoleTxFree() < ((uint16_t)len + 5))
+		return false;
+	consoleSendBytes((char *)header, 3);
+	if (len > 0)
+		consoleSendBytes((char *)pPayload, len);
+	consoleSendBytes((char *)trailer, 2);
+	return true;
+}
+
+
+//*****************************************************************************
+// protoSendAck
+//*****************************************************************************
+static void protoSendAck(uint8_t seq, uint8_t status) {
+
+uint8_t payload[2];
+
+	payload[0] = PROTO_RSP_ACK;
+	payload[1] = status;
+	protoSendFrame(seq, payload, 2);
+}
+
+
+//*****************************************************************************
+// protoRunCmds
+//*****************************************************************************
+// Walks the commands in a payload, checking them, and carrying them out if
+//  apply is set. Returns PROTO_OK if every command was good.
+//*****************************************************************************
+static uint8_t protoRunCmds(uint8_t * p, uint8_t len, bool apply) {
+
+uint8_t * pEnd = p + len;
+uint16_t t;
+uint16_t ms;
+
+	while (p < pEnd) {
+		switch (*p) {
+		
+			case PROTO_CMD_PLAY:
+				if ((pEnd - p) < 9)
+					return PROTO_ERR_CMD;
+				t = p[1] | (p[2] << 8);
+				if ((t >= MAX_NUM_TRACKS) || ((int8_t)p[3] < MIN_GAIN_DB) ||
+					((int8_t)p[3] > MAX_GAIN_DB) || (p[4] > PAN_RIGHT))
+					return PROTO_ERR_CMD;
+				if (apply)
+					voicesPlayTrack(t, (int8_t)p[3], p[4], p[5] | (p[6] << 8), 0,
+							(p[7] & PROTO_PLAY_FLAG_LOOP) != 0, (p[7] & PROTO_PLAY_FLAG_LOCK) != 0, p[8]);
+				p += 9;
+			break;
+			
+			case PROTO_CMD_STOP:
+				if ((pEnd - p) < 5)
+					return PROTO_ERR_CMD;
+				t = p[1] | (p[2] << 8);
+				if (t >= MAX_NUM_TRACKS)
+					return PROTO_ERR_CMD;
+				if (apply)
+					voicesStopTrack(t, p[3] | (p[4] << 8));
+				p += 5;
+			break;
+			
+			case PROTO_CMD_STOP_ALL:
+				if (apply)
+					voicesStopAll();
+				p += 1;
+			break;
+			
+			case PROTO_CMD_TRIGGER:
+				if (((pEnd - p) < 2) || (p[1] >= MAX_NUM_TRIGGERS))
+					return PROTO_ERR_CMD;
+				if (apply)
+					actionDispatch(p[1], TRIG_EDGE_PRESS);
+				p += 2;
+			break;
+			
+			case PROTO_CMD_FADE_ALL:
+				if ((pEnd - p) < 3)
+					return PROTO_ERR_CMD;
+				ms = p[1] | (p[2] << 8);
+				if (apply)
+					voicesFadeAll(ms);
+				p += 3;
+			break;
+			
+			case PROTO_CMD_TELEM:
+				if ((pEnd - p) < 3)
+					return PROTO_ERR_CMD;
+				ms = p[1] | (p[2] << 8);
+				if ((ms != 0) && ((ms < TELEM_MIN_PERIOD_MS) || (ms > TELEM_MAX_PERIOD_MS)))
+					return PROTO_ERR_CMD;
+				if (apply)
+					telemSetPeriod(ms);
+				p += 3;
+			break;
+			
+			default:
+				return PROTO_ERR_CMD;
+		}
+	}
+	return PROTO_OK;
+}
+
+
+//*****************************************************************************
+// protoDoFrame
+//*****************************************************************************
+// The commands in a frame go to the voices as one batch, so they all take
+//  effect in the same audio buffer. If a batch is still open or on its way
+//  to the audio interrupt the frame isn't applied, and it's answered with
+//  PROTO_ERR_BUSY so the host can retry it with the same sequence number.
+//*****************************************************************************
+static void protoDoFrame(void) {
+
+uint8_t status;
+
+	if (((gProtoCrc >> 8) != protoFrame[gProtoLen]) || ((gProtoCrc & 0xff) != protoFrame[gProtoLen + 1])) {
+		protoSendAck(gProtoSeq, PROTO_ERR_CRC);
+		return;
+	}
+	if (gProtoLastValid && (gProtoSeq == gProtoLastSeq)) {
+		protoSendAck(gProtoSeq, PROTO_OK);
+		return;
+	}
+	status = protoRunCmds(protoFrame, gProtoLen, false);
+	if ((status == PROTO_OK) && !voicesBatchBegin())
+		status = PROTO_ERR_BUSY;
+	if (status == PROTO_OK) {
+		protoRunCmds(protoFrame, gProtoLen, true);
+		if (!voicesBatchCommit())
+			status = PROTO_ERR_BATCH;
+		else {
+			gProtoLastSeq = gProtoSeq;
+			gProtoLastValid = true;
+		}
+	}
+	protoSendAck(gProtoSeq, status);
+}
+
+
+//*****************************************************************************
+// protoRxByte
+//*****************************************************************************
+// Called by the console with each received byte. Returns true if the byte
+//  was taken by the binary protocol or autobaud, false if it belongs to the
+//  console.
+//*****************************************************************************
+bool protoRxByte(uint8_t c) {
+
+	// While hunting for the baud rate, only sync bytes count
+	if (gAutobaudHunting) {
+		if (c == PROTO_AUTOBAUD_SYNC) {
+			if (++gAutobaudCount >= PROTO_AUTOBAUD_COUNT) {
+				gAutobaudHunting = false;
+				gAutobaudErrors = biosSerialGetErrors();
+				c = PROTO_AUTOBAUD_SYNC;
+				consoleSendBytes((char *)&c, 1);
+			}
+		}
+		else
+			gAutobaudCount = 0;
+		return true;
+	}
+
+	gProtoByteTicks = gMsTicks;
+	switch (gProtoState) {
+	
+		case PROTO_STATE_IDLE:
+			if (c != PROTO_SOF)
+				return false;
+			gProtoState = PROTO_STATE_LEN;
+		break;
+		
+		case PROTO_STATE_LEN:
+			if (c > PROTO_MAX_PAYLOAD) {
+				gProtoState = PROTO_STATE_IDLE;
+				break;
+			}
+			gProtoLen = c;
+			gProtoCrc = protoCrc16(0xffff, &c, 1);
+			gProtoState = PROTO_STATE_SEQ;
+		break;
+		
+		case PROTO_STATE_SEQ:
+			gProtoSeq = c;
+			gProtoCrc = protoCrc16(gProtoCrc, &c, 1);
+			gProtoCount = 0;
+			gProtoState = (gProtoLen > 0) ? PROTO_STATE_DATA : PROTO_STATE_CRC_HI;
+		break;
+		
+		case PROTO_STATE_DATA:
+			protoFrame[gProtoCount++] = c;
+			gProtoCrc = protoCrc16(gProtoCrc, &c, 1);
+			if (gProtoCount >= gProtoLen)
+				gProtoState = PROTO_STATE_CRC_HI;
+		break;
+		
+		case PROTO_STATE_CRC_HI:
+			protoFrame[gProtoLen] = c;
+			gProtoState = PROTO_STATE_CRC_LO;
+		break;
+		
+		default:
+			protoFrame[gProtoLen + 1] = c;
+			gProtoState = PROTO_STATE_IDLE;
+			protoDoFrame();
+		break;
+	}
+	return true;
+}
+
+
+//*****************************************************************************
+// protoService
+//*****************************************************************************
+// Called from the main loop to drop stalled frames and run the autobaud
+//  hunt. A burst of receive errors at the current rate starts a hunt, which
+//  tries each rate in turn for PROTO_AUTOBAUD_DWELL_MS.
+//*****************************************************************************
+void protoService(void) {
+
+uint32_t errors;
+
+	if ((gProtoState != PROTO_STATE_IDLE) && ((gMsTicks - gProtoByteTicks) > PROTO_FRAME_TIMEOUT_MS))
+		gProtoState = PROTO_STATE_IDLE;
+		
+	if (!gAutobaudEnable)
+		return;
+	if (!gAutobaudHunting) {
+		errors = biosSerialGetErrors();
+		if ((errors - gAutobaudErrors) >= PROTO_AUTOBAUD_ERRORS) {
+			gAutobaudHunting = true;
+			gAutobaudIndex = 0;
+			gAutobaudCount = 0;
+			gProtoState = PROTO_STATE_IDLE;
+			biosSerialSetBaud(protoBaudRates[0]);
+			gAutobaudTicks = gMsTicks;
+		}
+		else if ((gMsTicks - gAutobaudTicks) > 1000) {
+			gAutobaudErrors = errors;
+			gAutobaudTicks = gMsTicks;
+		}
+	}
+	else if ((gMsTicks - gAutobaudTicks) > PROTO_AUTOBAUD_DWELL_MS) {
+		if (++gAutobaudIndex >= PROTO_NUM_BAUD_RATES)
+			gAutobaudIndex = 0;
+		gAutobaudCount = 0;
+		biosSerialSetBaud(protoBaudRates[gAutobaudIndex]);
+		gAutobaudTicks = gMsTicks;
+	}
+}
+
+
+//*****************************************************************************
+// protoSetAutobaud
+//*****************************************************************************
+void protoSetAutobaud(bool enable) {
+
+	gAutobaudEnable = enable;
+	gAutobaudHunting = false;
+	gAutobaudErrors = biosSerialGetErrors();
+	gAutobaudTicks = gMsTicks;
+}
+
+
+//*****************************************************************************
+// protoGetAutobaud
+//*****************************************************************************
+bool protoGetAutobaud(void) {
+
+	return gAutobaudEnable;
+}
+
+
+//*****************************************************************************
+// protoSetBaud
+//*****************************************************************************
+// Sets one of the supported baud rates.
+//*****************************************************************************
+bool protoSetBaud(uint32_t baud) {
+
+uint8_t i;
+
+	for (i = 0; i < PROTO_NUM_BAUD_RATES; i++) {
+		if (protoBaudRates[i] == baud) {
+			gAutobaudHunting = false;
+			biosSerialSetBaud(baud);
+			gAutobaudErrors = biosSerialGetErrors();
+			return true;
+		}
+	}
+	return false;
+}
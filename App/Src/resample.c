@@ -0,0 +1,394 @@
+// ****************************************************************************
+//     Filename: RESAMPLE.C
+// Date Created: 10/19/2026
+//
+//     Comments: Sample rate converter for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+#include "player.h"
+#include <math.h>
+
+
+// ****************************************************************************
+// External variables
+
+extern RESAMPLE_STRUCTURE mp3Resample[];	// Our voice resampler array
+extern q15_t gMP3VoiceBuff[];				// Our voice mix buffer
+
+
+// ****************************************************************************
+// Global variables
+
+uint8_t gResampleQuality = RS_DEFAULT_QUALITY;
+
+// Worst case cycles to produce one stereo mix buffer, per quality tier.
+//  Measured at boot by resampleBenchmark().
+uint32_t gResampleCycles[RS_NUM_QUALITIES];
+
+// Taps and log2(phases) for each quality tier
+const uint8_t rsNumTaps[RS_NUM_QUALITIES] = {2, 4, 8, 16};
+const uint8_t rsPhaseBits[RS_NUM_QUALITIES] = {0, 7, 5, 6};
+
+// Polyphase coefficient tables, one row of taps per phase. These are
+//  computed at init rather than stored, since they're cheap to make.
+q15_t rsCoefCubic[128 * 4] __attribute__((aligned (4)));
+q15_t rsCoefMedium[32 * 8] __attribute__((aligned (4)));
+q15_t rsCoefHigh[64 * 16] __attribute__((aligned (4)));
+
+
+//*****************************************************************************
+// resampleMakeTable
+//*****************************************************************************
+// Builds a Blackman windowed-sinc polyphase table. Each phase row is
+//  normalized to unity DC gain.
+//*****************************************************************************
+static void resampleMakeTable(q15_t * pTable, uint8_t numTaps, uint8_t phaseBits) {
+
+uint16_t numPhases = 1 << phaseBits;
+uint16_t p;
+uint8_t k;
+float t, x, w, sum;
+float fCoef[RS_MAX_TAPS];
+
+	for (p = 0; p < numPhases; p++) {
+		sum = 0.0f;
+		for (k = 0; k < numTaps; k++) {
+			t = (float)k - (float)((numTaps >> 1) - 1) - ((float)p / (float)numPhases);
+			x = PI * RS_CUTOFF * t;
+			fCoef[k] = (t == 0.0f) ? RS_CUTOFF : (RS_CUTOFF * sinf(x) / x);
+			w = 0.42f + (0.5f * cosf(2.0f * PI * t / (float)numTaps)) +
+					(0.08f * cosf(4.0f * PI * t / (float)numTaps));
+			fCoef[k] *= w;
+			sum += fCoef[k];
+		}
+		for (k = 0; k < numTaps; k++)
+			pTable[(p * numTaps) + k] = (q15_t)MAKEQ1_15(fCoef[k] / sum);
+	}
+}
+
+
+//*****************************************************************************
+// resampleMakeCubicTable
+//*****************************************************************************
+// Builds a 4-tap Catmull-Rom interpolation table in the same polyphase
+//  layout as the FIR tables, so the same dual-MAC kernel can run it. The
+//  center weight of phase 0 is 1.0, which saturates to 32767.
+//*****************************************************************************
+static void resampleMakeCubicTable(q15_t * pTable, uint8_t phaseBits) {
+
+uint16_t numPhases = 1 << phaseBits;
+uint16_t p;
+uint8_t k;
+float t, w;
+
+	for (p = 0; p < numPhases; p++) {
+		for (k = 0; k < 4; k++) {
+			t = fabsf((float)k - 1.0f - ((float)p / (float)numPhases));
+			if (t < 1.0f)
+				w = (1.5f * t * t * t) - (2.5f * t * t) + 1.0f;
+			else
+				w = (-0.5f * t * t * t) + (2.5f * t * t) - (4.0f * t) + 2.0f;
+			pTable[(p * 4) + k] = (q15_t)MAKEQ1_15(w);
+		}
+	}
+}
+
+
+//*****************************************************************************
+// resampleInit
+//*****************************************************************************
+void resampleInit(void) {
+
+	resampleMakeCubicTable(rsCoefCubic, rsPhaseBits[RS_QUALITY_CUBIC]);
+	resampleMakeTable(rsCoefMedium, rsNumTaps[RS_QUALITY_MEDIUM], rsPhaseBits[RS_QUALITY_MEDIUM]);
+	resampleMakeTable(rsCoefHigh, rsNumTaps[RS_QUALITY_HIGH], rsPhaseBits[RS_QUALITY_HIGH]);
+}
+
+
+//*****************************************************************************
+// resampleReset
+//*****************************************************************************
+// Sets up a resampler to convert from srcRate to our output rate. If the
+//  rates are the same the resampler is left inactive and costs nothing.
+//*****************************************************************************
+void resampleReset(RESAMPLE_STRUCTURE * pRs, uint32_t srcRate, uint8_t quality) {
+
+uint32_t inc;
+
+	if (quality >= RS_NUM_QUALITIES)
+		quality = RS_DEFAULT_QUALITY;
+	
+	inc = UNITY_PITCH_INC;
+	if (srcRate != 0)
+		inc = (uint32_t)(((uint64_t)srcRate << 16) / AUDIO_SAMPLE_RATE);
+	if (inc > RS_MAX_INC)
+		inc = RS_MAX_INC;
+
+	pRs->active = (inc != UNITY_PITCH_INC);
+	pRs->running = false;
+	pRs->quality = quality;
+	pRs->numTaps = rsNumTaps[quality];
+	pRs->cents = 0;
+	pRs->baseInc = inc;
+	pRs->inc = inc;
+	pRs->phase = 0;
+
+	// Pre-roll with silence so the first output frame is centered on the
+	//  first input frame
+	arm_fill_q15(0, pRs->histL, RS_MAX_TAPS);
+	arm_fill_q15(0, pRs->histR, RS_MAX_TAPS);
+	pRs->histFrames = (pRs->numTaps >> 1) - 1;
+}
+
+
+//*****************************************************************************
+// resampleSetPitch
+//*****************************************************************************
+// Offsets the pitch by up to +/-700 cents on top of the sample rate ratio.
+//  Pitched voices use the cubic tier, since the FIR tables are only cut off
+//  low enough for the small ratios between standard sample rates. The tier
+//  can only change before the voice starts producing audio, so this should
+//  be called at trigger time - later calls just update the increment.
+//*****************************************************************************
+void resampleSetPitch(RESAMPLE_STRUCTURE * pRs, int16_t cents) {
+
+uint32_t inc;
+
+	if (cents > RS_MAX_CENTS)
+		cents = RS_MAX_CENTS;
+	else if (cents < -RS_MAX_CENTS)
+		cents = -RS_MAX_CENTS;
+	pRs->cents = cents;
+
+	inc = (uint32_t)(((float)pRs->baseInc * exp2f((float)cents / 1200.0f)) + 0.5f);
+	if (inc > RS_MAX_INC)
+		inc = RS_MAX_INC;
+	
+	if ((cents != 0) && (pRs->quality > RS_QUALITY_CUBIC) && (!pRs->running)) {
+		pRs->quality = RS_QUALITY_CUBIC;
+		pRs->numTaps = rsNumTaps[RS_QUALITY_CUBIC];
+		pRs->histFrames = (pRs->numTaps >> 1) - 1;
+	}
+	if (inc != UNITY_PITCH_INC)
+		pRs->active = true;
+	pRs->inc = inc;
+}
+
+
+//*****************************************************************************
+// resampleGetInputFrames
+//*****************************************************************************
+// Returns the number of input frames that must be appended to the history
+//  before calling resampleProcess() for numFrames output frames.
+//*****************************************************************************
+uint16_t resampleGetInputFrames(RESAMPLE_STRUCTURE * pRs, uint16_t numFrames) {
+
+uint32_t need;
+
+	need = ((pRs->phase + (numFrames * pRs->inc)) >> 16) + pRs->numTaps;
+	if (need <= pRs->histFrames)
+		return 0;
+	return need - pRs->histFrames;
+}
+
+
+//*****************************************************************************
+// resampleLinear
+//*****************************************************************************
+static uint32_t resampleLinear(RESAMPLE_STRUCTURE * pRs, q15_t * pDst, uint16_t numFrames, uint8_t nCh) {
+
+uint32_t pos = pRs->phase;
+uint32_t inc = pRs->inc;
+uint32_t i;
+q31_t frac;
+q31_t outL, outR;
+
+	while (numFrames > 0) {
+		i = pos >> 16;
+		frac = (pos & 0xffff) >> 1;
+		outL = pRs->histL[i] + (((pRs->histL[i + 1] - pRs->histL[i]) * frac) >> 15);
+		if (nCh == 1)
+			outR = outL;
+		else
+			outR = pRs->histR[i] + (((pRs->histR[i + 1] - pRs->histR[i]) * frac) >> 15);
+		*__SIMD32(pDst)++ = __PKHBT(outL, outR, 16);
+		pos += inc;
+		numFrames--;
+	}
+	return pos;
+}
+
+
+//*****************************************************************************
+// resampleFir
+//*****************************************************************************
+// Polyphase FIR kernel. The taps are applied two at a time with the dual
+//  16-bit MAC, and both channels share each coefficient load.
+//*****************************************************************************
+static uint32_t resampleFir(RESAMPLE_STRUCTURE * pRs, q15_t * pTable, q15_t * pDst, uint16_t numFrames, uint8_t nCh) {
+
+uint32_t pos = pRs->phase;
+uint32_t inc = pRs->inc;
+uint8_t numTaps = pRs->numTaps;
+uint8_t phaseShift = 16 - rsPhaseBits[pRs->quality];
+uint32_t k;
+q31_t accL, accR, coef;
+q15_t *pL, *pR, *pC;
+
+	while (numFrames > 0) {
+		pL = &pRs->histL[pos >> 16];
+		pR = &pRs->histR[pos >> 16];
+		pC = &pTable[((pos & 0xffff) >> phaseShift) * numTaps];
+		accL = 0;
+		accR = 0;
+		
+		if (nCh == 1) {
+			for (k = numTaps >> 1; k > 0; k--)
+				accL = __SMLAD(read_q15x2_ia(&pL), read_q15x2_ia(&pC), accL);
+			accL = __SSAT(accL >> 15, 16);
+			accR = accL;
+		}
+		else {
+			for (k = numTaps >> 1; k > 0; k--) {
+				coef = read_q15x2_ia(&pC);
+				accL = __SMLAD(read_q15x2_ia(&pL), coef, accL);
+				accR = __SMLAD(read_q15x2_ia(&pR), coef, accR);
+			}
+			accL = __SSAT(accL >> 15, 16);
+			accR = __SSAT(accR >> 15, 16);
+		}
+		*__SIMD32(pDst)++ = __PKHBT(accL, accR, 16);
+		pos += inc;
+		numFrames--;
+	}
+	return pos;
+}
+
+
+//*****************************************************************************
+// resampleProcess
+//*****************************************************************************
+// Produces numFrames of interleaved stereo output from the history, which
+//  must already hold the frames reported by resampleGetInputFrames(). Mono
+//  sources only use the left history and are output on both channels.
+//*****************************************************************************
+void resampleProcess(RESAMPLE_STRUCTURE * pRs, q15_t * pDst, uint16_t numFrames, uint8_t nCh) {
+
+uint32_t pos;
+uint32_t consumed;
+uint16_t remaining;
+
+	switch (pRs->quality) {
+		case RS_QUALITY_LINEAR:
+			pos = resampleLinear(pRs, pDst, numFrames, nCh);
+		break;
+		case RS_QUALITY_CUBIC:
+			pos = resampleFir(pRs, rsCoefCubic, pDst, numFrames, nCh);
+		break;
+		case RS_QUALITY_HIGH:
+			pos = resampleFir(pRs, rsCoefHigh, pDst, numFrames, nCh);
+		break;
+		default:
+			pos = resampleFir(pRs, rsCoefMedium, pDst, numFrames, nCh);
+		break;
+	}
+	
+	pRs->running = true;
+
+	// Move the unused history down to the start of the buffer
+	consumed = pos >> 16;
+	pRs->phase = pos & 0xffff;
+	remaining = pRs->histFrames - consumed;
+	memmove(pRs->histL, &pRs->histL[consumed], remaining * sizeof(q15_t));
+	if (nCh != 1)
+		memmove(pRs->histR, &pRs->histR[consumed], remaining * sizeof(q15_t));
+	pRs->histFrames = remaining;
+}
+
+
+//*****************************************************************************
+// resampleBenchmark
+//*****************************************************************************
+// Measures the worst case cycles per mix buffer for each quality tier on a
+//  stereo 48kHz source pitched all the way up, which is the most input a
+//  block can consume, so the voice scheduler can budget for them. Must be
+//  called before any voices start since it borrows voice 0's resampler.
+//*****************************************************************************
+void resampleBenchmark(void) {
+
+RESAMPLE_STRUCTURE * pRs = &mp3Resample[0];
+uint32_t start;
+uint32_t cycles;
+uint16_t need;
+uint8_t q;
+uint8_t r;
+
+	for (q = 0; q < RS_NUM_QUALITIES; q++) {
+		resampleReset(pRs, 48000, q);
+		pRs->inc = (uint32_t)(((float)pRs->baseInc * exp2f((float)RS_MAX_CENTS / 1200.0f)) + 0.5f);
+		gResampleCycles[q] = 0;
+		for (r = 0; r < 4; r++) {
+			need = resampleGetInputFrames(pRs, MIX_BUFF_FRAMES);
+			arm_fill_q15(0x1234, &pRs->histL[pRs->histFrames], need);
+			arm_fill_q15(-0x1234, &pRs->histR[pRs->histFrames], need);
+			pRs->histFrames += need;
+			start = biosGetCycleCount();
+			resampleProcess(pRs, gMP3VoiceBuff, MIX_BUFF_FRAMES, 2);
+			cycles = biosGetCycleCount() - start;
+			if (cycles > gResampleCycles[q])
+				gResampleCycles[q] = cycles;
+		}
+	}
+	resampleReset(pRs, 0, RS_DEFAULT_QUALITY);
+}
+
+
+//*****************************************************************************
+// resampleGetCycles
+//*****************************************************************************
+uint32_t resampleGetCycles(uint8_t quality) {
+
+	if (quality >= RS_NUM_QUALITIES)
+		return 0;
+	return gResampleCycles[quality];
+}
+
+
+//*****************************************************************************
+// resampleSetQuality
+//*****************************************************************************
+// Sets the quality tier used for voices started from now on.
+//*****************************************************************************
+void resampleSetQuality(uint8_t quality) {
+
+	if (quality < RS_NUM_QUALITIES)
+		gResampleQuality = quality;
+}
+
+
+//*****************************************************************************
+// resampleGetQuality
+//*****************************************************************************
+uint8_t resampleGetQuality(void) {
+
+	return gResampleQuality;
+}
@@ -0,0 +1,269 @@
+// ****************************************************************************
+//     Filename: RTOS.C
+// Date Created: 10/19/2026
+//
+//     Comments: Optional RTOS port for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+#include "player.h"
+
+#ifdef PLAYER_RTOS
+
+#include "cmsis_os2.h"
+
+
+// ****************************************************************************
+// Global variables
+
+static uint64_t rtosSdioStack[RTOS_SDIO_STACK / 8];
+static uint64_t rtosDecodeStack[RTOS_DECODE_STACK / 8];
+static uint64_t rtosControlStack[RTOS_CONTROL_STACK / 8];
+
+static uint32_t rtosSdioCb[RTOS_THREAD_CB_SIZE / 4];
+static uint32_t rtosDecodeCb[RTOS_THREAD_CB_SIZE / 4];
+static uint32_t rtosControlCb[RTOS_THREAD_CB_SIZE / 4];
+static uint32_t rtosFlagsCb[RTOS_OBJECT_CB_SIZE / 4];
+static uint32_t rtosDiskCb[RTOS_OBJECT_CB_SIZE / 4];
+static uint32_t rtosTickCb[RTOS_OBJECT_CB_SIZE / 4];
+
+static const osThreadAttr_t rtosSdioAttr = {
+	.name = "sdio",
+	.cb_mem = rtosSdioCb,
+	.cb_size = sizeof(rtosSdioCb),
+	.stack_mem = rtosSdioStack,
+	.stack_size = sizeof(rtosSdioStack),
+	.priority = osPriorityRealtime
+};
+
+static const osThreadAttr_t rtosDecodeAttr = {
+	.name = "decode",
+	.cb_mem = rtosDecodeCb,
+	.cb_size = sizeof(rtosDecodeCb),
+	.stack_mem = rtosDecodeStack,
+	.stack_size = sizeof(rtosDecodeStack),
+	.priority = osPriorityHigh
+};
+
+static const osThreadAttr_t rtosControlAttr = {
+	.name = "control",
+	.cb_mem = rtosControlCb,
+	.cb_size = sizeof(rtosControlCb),
+	.stack_mem = rtosControlStack,
+	.stack_size = sizeof(rtosControlStack),
+	.priority = osPriorityNormal
+};
+
+static const osEventFlagsAttr_t rtosFlagsAttr = {
+	.name = "flags",
+	.cb_mem = rtosFlagsCb,
+	.cb_size = sizeof(rtosFlagsCb)
+};
+
+static const osMutexAttr_t rtosDiskAttr = {
+	.name = "disk",
+	.attr_bits = osMutexRecursive | osMutexPrioInherit,
+	.cb_mem = rtosDiskCb,
+	.cb_size = sizeof(rtosDiskCb)
+};
+
+static const osTimerAttr_t rtosTickAttr = {
+	.name = "tick",
+	.cb_mem = rtosTickCb,
+	.cb_size = sizeof(rtosTickCb)
+};
+
+osEventFlagsId_t gRtosFlags = NULL;
+osMutexId_t gRtosDisk = NULL;
+
+
+//*****************************************************************************
+// rtosSdioThread
+//*****************************************************************************
+static void rtosSdioThread(void * argument) {
+
+	UNUSED(argument);
+	while (1) {
+		osEventFlagsWait(gRtosFlags, RTOS_FLAG_SDIO, osFlagsWaitAny, osWaitForever);
+		voicesRefill();
+		osEventFlagsSet(gRtosFlags, RTOS_FLAG_DECODE);
+	}
+}
+
+
+//*****************************************************************************
+// rtosDecodeThread
+//*****************************************************************************
+static void rtosDecodeThread(void * argument) {
+
+	UNUSED(argument);
+	while (1) {
+		osEventFlagsWait(gRtosFlags, RTOS_FLAG_DECODE, osFlagsWaitAny, osWaitForever);
+		voicesDecode();
+	}
+}
+
+
+//*****************************************************************************
+// rtosControlThread
+//*****************************************************************************
+// Initializes the player once the kernel is running, so the delays and SD
+//  transfers in it have the kernel's tick, then runs the main loop.
+//*****************************************************************************
+static void rtosControlThread(void * argument) {
+
+	UNUSED(argument);
+	sdTestInit();
+	while (1) {
+		sdTestProcess();
+		osDelay(1);
+	}
+}
+
+
+//*****************************************************************************
+// rtosTick
+//*****************************************************************************
+// Stands in for the SysTick handler, which belongs to the kernel. Drives the
+//  HAL tick too, so HAL timeouts work without a separate timebase.
+//*****************************************************************************
+static void rtosTick(void * argument) {
+
+	UNUSED(argument);
+	HAL_IncTick();
+	mySysTick_Handler();
+}
+
+
+//*****************************************************************************
+// HAL_InitTick
+//*****************************************************************************
+// Replaces the HAL's weak version. SysTick runs at 1ms for HAL_GetTick to
+//  poll, but without its interrupt, which would go to the kernel before
+//  it's started. The kernel sets SysTick up for itself when it starts.
+//*****************************************************************************
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority) {
+
+	UNUSED(TickPriority);
+	if (SysTick_Config(SystemCoreClock / (1000U / uwTickFreq)) > 0U)
+		return HAL_ERROR;
+	SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
+	return HAL_OK;
+}
+
+
+//*****************************************************************************
+// HAL_GetTick
+//*****************************************************************************
+// Replaces the HAL's weak version. Until the kernel is running, counts the
+//  SysTick wraps seen since the last call, so HAL_Delay and the HAL's
+//  timeouts during startup run long if anything, never short. After that
+//  rtosTick keeps uwTick going.
+//*****************************************************************************
+uint32_t HAL_GetTick(void) {
+
+	if (!rtosRunning() && (SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk))
+		uwTick += uwTickFreq;
+	return uwTick;
+}
+
+
+//*****************************************************************************
+// rtosStart
+//*****************************************************************************
+// Called from main after the CubeMX peripheral init to create the threads
+//  and start the kernel. It doesn't return.
+//*****************************************************************************
+void rtosStart(void) {
+
+osTimerId_t tick;
+
+	osKernelInitialize();
+	gRtosFlags = osEventFlagsNew(&rtosFlagsAttr);
+	gRtosDisk = osMutexNew(&rtosDiskAttr);
+	osThreadNew(rtosSdioThread, NULL, &rtosSdioAttr);
+	osThreadNew(rtosDecodeThread, NULL, &rtosDecodeAttr);
+	osThreadNew(rtosControlThread, NULL, &rtosControlAttr);
+	tick = osTimerNew(rtosTick, osTimerPeriodic, NULL, &rtosTickAttr);
+	osTimerStart(tick, (osKernelGetTickFreq() + 999) / 1000);
+	osKernelStart();
+	while (1)
+		;
+}
+
+
+//*****************************************************************************
+// rtosRunning
+//*****************************************************************************
+bool rtosRunning(void) {
+
+	return (osKernelGetState() == osKernelRunning);
+}
+
+
+//*****************************************************************************
+// rtosSignal
+//*****************************************************************************
+// Sets event flags. Can be called from interrupts, and does nothing before
+//  the kernel is started.
+//*****************************************************************************
+void rtosSignal(uint32_t flags) {
+
+	if (gRtosFlags != NULL)
+		osEventFlagsSet(gRtosFlags, flags);
+}
+
+
+//*****************************************************************************
+// rtosWaitSd
+//*****************************************************************************
+// Blocks the calling thread until the SD card transfer in progress is done.
+//  Before the kernel is started the caller polls for it instead.
+//*****************************************************************************
+void rtosWaitSd(void) {
+
+	if (!rtosRunning())
+		return;
+	osEventFlagsWait(gRtosFlags, RTOS_FLAG_SD_DONE, osFlagsWaitAny, osWaitForever);
+}
+
+
+//*****************************************************************************
+// rtosDiskLock
+//*****************************************************************************
+void rtosDiskLock(void) {
+
+	if (rtosRunning())
+		osMutexAcquire(gRtosDisk, osWaitForever);
+}
+
+
+//*****************************************************************************
+// rtosDiskUnlock
+//*****************************************************************************
+void rtosDiskUnlock(void) {
+
+	if (rtosRunning())
+		osMutexRelease(gRtosDisk);
+}
+
+#endif
@@ -0,0 +1,221 @@
+// ****************************************************************************
+//     Filename: TELEM.C
+// Date Created: 10/19/2026
+//
+//     Comments: Telemetry frames for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+#include "player.h"
+
+
+// ****************************************************************************
+// External variables
+
+extern volatile uint32_t gMsTicks;			// Our 1ms global system tick
+
+extern MP3_VOICE_STRUCTURE mp3[];			// Our MP3 voice structure array
+extern uint8_t gNumMP3Voices;
+
+
+// ****************************************************************************
+// Global variables
+
+TELEM_SNAPSHOT_STRUCTURE telemSnap[2];
+volatile uint8_t gTelemFront = 0;			// Snapshot the main loop reads
+volatile bool gTelemRequest = false;		// Main loop wants a snapshot
+volatile bool gTelemReady = false;			// A new snapshot is in front
+
+uint16_t gTelemPeriod = 0;					// Period in ms, 0 = off
+uint32_t gTelemTicks = 0;					// Time of the last request
+uint8_t gTelemSeq = 0;						// Frame sequence number
+uint32_t gTelemDrops = 0;					// Frames skipped, no room to send
+
+
+//*****************************************************************************
+// telemInit
+//*****************************************************************************
+void telemInit(void) {
+
+	gTelemPeriod = 0;
+	gTelemRequest = false;
+	gTelemReady = false;
+	gTelemDrops = 0;
+}
+
+
+//*****************************************************************************
+// telemSnapshot
+//*****************************************************************************
+// Called by the audio interrupt after the voices are mixed. If the main loop
+//  has asked for one, fills the back snapshot and swaps it to the front.
+//*****************************************************************************
+void telemSnapshot(void) {
+
+TELEM_SNAPSHOT_STRUCTURE * pSnap;
+TELEM_VOICE_STRUCTURE * pVoice;
+uint8_t v;
+
+	if (!gTelemRequest)
+		return;
+
+	pSnap = &telemSnap[gTelemFront ^ 1];
+	pSnap->msTicks = gMsTicks;
+	pSnap->underruns = mp3GetUnderruns();
+	pSnap->sdLastCycles = profileGetLast(PROF_SD_READ);
+	pSnap->sdPeakCycles = profileGetPeak(PROF_SD_READ);
+	pSnap->cpuLoad = profileGetLoad();
+	for (v = 0; v < gNumMP3Voices; v++) {
+		pVoice = &pSnap->voice[v];
+		pVoice->state = mp3[v].state;
+		pVoice->gainIdx = mp3[v].currGainIdx;
+		pVoice->track = mp3[v].track;
+		pVoice->framesPlayed = mp3[v].framesPlayed;
+		if (mp3[v].mp3InPtr >= mp3[v].mp3OutPtr)
+			pVoice->mp3Bytes = mp3[v].mp3InPtr - mp3[v].mp3OutPtr;
+		else
+			pVoice->mp3Bytes = MP3_BUFFER_SIZE - (mp3[v].mp3OutPtr - mp3[v].mp3InPtr);
+		pVoice->wavSamples = mp3GetWavSamples(v);
+	}
+	gTelemFront ^= 1;
+	gTelemRequest = false;
+	gTelemReady = true;
+}
+
+
+//*****************************************************************************
+// telemPut16 / telemPut32
+//*****************************************************************************
+static uint8_t * telemPut16(uint8_t * p, uint16_t n) {
+
+	*p++ = n & 0xff;
+	*p++ = n >> 8;
+	return p;
+}
+
+static uint8_t * telemPut32(uint8_t * p, uint32_t n) {
+
+	p = telemPut16(p, n & 0xffff);
+	return telemPut16(p, n >> 16);
+}
+
+
+//*****************************************************************************
+// telemService
+//*****************************************************************************
+// Called from the main loop. Asks the audio interrupt for a snapshot once
+//  per period, and sends it out when it's ready. If the transmit buffer
+//  doesn't have room for the whole frame, the frame is skipped.
+//*****************************************************************************
+void telemService(void) {
+
+uint8_t payload[TELEM_HEADER_BYTES + (MAX_NUM_MP3_VOICES * TELEM_VOICE_BYTES)];
+TELEM_SNAPSHOT_STRUCTURE * pSnap;
+TELEM_VOICE_STRUCTURE * pVoice;
+uint8_t * p;
+uint32_t us;
+uint8_t v;
+
+	if (gTelemPeriod == 0)
+		return;
+
+	if (gTelemReady) {
+		gTelemReady = false;
+		pSnap = &telemSnap[gTelemFront];
+		p = payload;
+		*p++ = PROTO_RSP_TELEM;
+		*p++ = pSnap->cpuLoad;
+		*p++ = gNumMP3Voices;
+		*p++ = 0;
+		p = telemPut32(p, pSnap->msTicks);
+		p = telemPut32(p, pSnap->underruns);
+		us = pSnap->sdLastCycles / (SystemCoreClock / 1000000);
+		p = telemPut16(p, (us > 0xffff) ? 0xffff : us);
+		us = pSnap->sdPeakCycles / (SystemCoreClock / 1000000);
+		p = telemPut16(p, (us > 0xffff) ? 0xffff : us);
+		for (v = 0; v < gNumMP3Voices; v++) {
+			pVoice = &pSnap->voice[v];
+			*p++ = pVoice->state;
+			*p++ = pVoice->gainIdx;
+			p = telemPut16(p, pVoice->track);
+			p = telemPut32(p, pVoice->framesPlayed);
+			p = telemPut16(p, pVoice->mp3Bytes);
+			p = telemPut16(p, pVoice->wavSamples);
+		}
+		if (consoleTxFree() >= ((p - payload) + 5)) {
+			protoSendFrame(gTelemSeq, payload, p - payload);
+			gTelemSeq++;
+		}
+		else
+			gTelemDrops++;
+	}
+
+	if ((gMsTicks - gTelemTicks) >= gTelemPeriod) {
+		gTelemTicks = gMsTicks;
+		gTelemRequest = true;
+	}
+}
+
+
+//*****************************************************************************
+// telemSetPeriod
+//*****************************************************************************
+// Sets the frame period in ms, 0 to stop. Returns false if out of range.
+//*****************************************************************************
+bool telemSetPeriod(uint16_t periodMs) {
+
+	if ((periodMs != 0) && ((periodMs < TELEM_MIN_PERIOD_MS) || (periodMs > TELEM_MAX_PERIOD_MS)))
+		return false;
+	gTelemPeriod = periodMs;
+	gTelemTicks = gMsTicks - periodMs;
+	gTelemReady = false;
+	return true;
+}
+
+
+//*****************************************************************************
+// telemBusy
+//*****************************************************************************
+// Returns true if there's a snapshot waiting to be sent.
+//*****************************************************************************
+bool telemBusy(void) {
+
+	return gTelemReady;
+}
+
+
+//*****************************************************************************
+// telemGetPeriod
+//*****************************************************************************
+uint16_t telemGetPeriod(void) {
+
+	return gTelemPeriod;
+}
+
+
+//*****************************************************************************
+// telemGetDrops
+//*****************************************************************************
+uint32_t telemGetDrops(void) {
+
+	return gTelemDrops;
+}
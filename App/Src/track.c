@@ -31,11 +31,106 @@
 
 extern FATFS fatFs;
 extern TRACK_STRUCTURE track[];			// Our track structure array
+extern TRACK_INFO_STRUCTURE trackInfo[];	// Our track info structure array
+
+extern uint8_t gSdBuff[];				// Our SD read buffer
 
 
 // ****************************************************************************
 // Global variables
 
+uint16_t gProbeIndex = 0;				// Next track for the background probe
+
+FIL probeFile;							// File object used by the track probe
+
+DIR trackDir;							// The SOUNDS directory, left open for trackOpen()
+
+// Sample rates in Hz, indexed by the track info sample rate index. The first
+//  three are MPEG1, the next three MPEG2 and the last three MPEG2.5.
+
+const uint32_t trackSampleRates[TRACK_NUM_SAMPLE_RATES] = {
+		44100, 48000, 32000,
+		22050, 24000, 16000,
+		11025, 12000, 8000
+};
+
+// Layer III bitrates in kbps, indexed by the frame header bitrate index
+
+const uint16_t trackBitratesV1[16] = {
+		0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0
+};
+const uint16_t trackBitratesV2[16] = {
+		0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0
+};
+
+#define PROBE_READ_BYTES		(2 * BYTES_PER_BLOCK)
+
+// Local structure for a decoded frame header
+
+typedef struct {
+	uint8_t srIdx;				// Sample rate index
+	uint8_t mode;				// Channel mode
+	bool lsf;					// MPEG2/2.5 low sampling frequency flag
+	uint16_t bitrateKbps;		// Frame bitrate
+	uint16_t frameBytes;		// Frame length in bytes
+	uint16_t samplesPerFrame;	// Samples per frame
+} MP3_HEADER_STRUCTURE;
+
+
+//*****************************************************************************
+// trackGetBE32
+//*****************************************************************************
+static uint32_t trackGetBE32(uint8_t * p) {
+
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+			((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+
+//*****************************************************************************
+// trackParseHeader
+//*****************************************************************************
+// Decodes a 4-byte MPEG audio frame header. Returns false if the bytes are
+//  not a valid Layer III header.
+//*****************************************************************************
+static bool trackParseHeader(uint8_t * p, MP3_HEADER_STRUCTURE * pHdr) {
+
+uint8_t ver;
+uint8_t brIdx;
+uint8_t srIdx;
+	
+	// Check the frame sync and Layer III bits
+	if ((p[0] != 0xff) || ((p[1] & 0xe0) != 0xe0))
+		return false;
+	if (((p[1] >> 1) & 0x03) != 0x01)
+		return false;
+	
+	ver = (p[1] >> 3) & 0x03;
+	brIdx = p[2] >> 4;
+	srIdx = (p[2] >> 2) & 0x03;
+	if ((ver == 1) || (brIdx == 0) || (brIdx == 15) || (srIdx == 3))
+		return false;
+
+	// Map the version to our sample rate table row
+	if (ver == 3) {
+		pHdr->lsf = false;
+		pHdr->bitrateKbps = trackBitratesV1[brIdx];
+		pHdr->samplesPerFrame = 1152;
+	}
+	else {
+		pHdr->lsf = true;
+		pHdr->bitrateKbps = trackBitratesV2[brIdx];
+		pHdr->samplesPerFrame = 576;
+		srIdx += (ver == 2) ? 3 : 6;
+	}
+	pHdr->srIdx = srIdx;
+	pHdr->mode = p[3] >> 6;
+	pHdr->frameBytes = (((uint32_t)pHdr->samplesPerFrame / 8) * pHdr->bitrateKbps * 1000) /
+			trackSampleRates[srIdx];
+	pHdr->frameBytes += (p[2] >> 1) & 0x01;
+	return true;
+}
+
 
 //*****************************************************************************
 // initTracks
@@ -45,26 +140,292 @@ bool trackInit(uint16_t *tNum) {
 int i;
 FRESULT fRslt;
 uint16_t numMp3 = 0;
+uint16_t t;
+uint8_t n;
 
-DIR dir;
 FILINFO fInfo;
 
 	for (i = 0; i < MAX_NUM_TRACKS; i++) {
 		track[i].flags = 0;
+		track[i].voices = 0;
 		track[i].fileSize.lSize = 0;
+		track[i].dirIndex = 0;
+		trackInfo[i].flags = 0;
 	}
+	gProbeIndex = 0;
 
 	fRslt = f_mount(&fatFs, "", 1);
 	if (fRslt != FR_OK) return false;
 
-	fRslt = f_findfirst(&dir, &fInfo, "SOUNDS", "*.mp3");
+	fRslt = f_findfirst(&trackDir, &fInfo, "SOUNDS", "*.mp3");
 	if (fRslt != FR_OK) return false;
 
 	while ((fRslt == FR_OK) && (fInfo.fname[0] != 0)) {
-		numMp3++;
-		fRslt = f_findnext(&dir, &fInfo);
+
+		// The track number is the leading 3 or 4 digits of the filename,
+		//  ie. "001INTRO.MP3" or "1234BOOM.MP3"
+		t = 0;
+		n = 0;
+		while ((n < 4) && (fInfo.fname[n] >= '0') && (fInfo.fname[n] <= '9'))
+			t = (t * 10) + (fInfo.fname[n++] - '0');
+		if ((n >= 3) && (t < MAX_NUM_TRACKS) && ((n == 3) || (t >= 1000))) {
+			track[t].flags = TRACK_FLAG_EXISTS | TRACK_FLAG_MP3;
+			track[t].fileSize.lSize = fInfo.fsize;
+			track[t].dirIndex = (uint16_t)f_tellidx(&trackDir);
+			numMp3++;
+		}
+		fRslt = f_findnext(&trackDir, &fInfo);
 	}
 	*tNum = numMp3;
 	return true;
 	
 }
+
+
+//*****************************************************************************
+// trackOpen
+//*****************************************************************************
+// Opens the file for track t for reading. trackInit() recorded where the
+//  file's entry sits in the SOUNDS directory, so there's no search by name.
+//*****************************************************************************
+bool trackOpen(uint16_t t, FIL * fp) {
+
+	if ((t >= MAX_NUM_TRACKS) || ((track[t].flags & TRACK_FLAG_EXISTS) == 0))
+		return false;
+	if (f_openidx(fp, &trackDir, track[t].dirIndex) != FR_OK)
+		return false;
+	return true;
+}
+
+
+//*****************************************************************************
+// trackGetId3Bytes
+//*****************************************************************************
+// Returns the size of the ID3v2 tag at the start of a file, including its
+//  header and footer, or 0 if there isn't one. The tag size is syncsafe.
+//*****************************************************************************
+uint32_t trackGetId3Bytes(const uint8_t * p, uint32_t len) {
+
+uint32_t n;
+
+	if ((len < 10) || (p[0] != 'I') || (p[1] != 'D') || (p[2] != '3'))
+		return 0;
+	n = ((uint32_t)(p[6] & 0x7f) << 21) | ((uint32_t)(p[7] & 0x7f) << 14) |
+		((uint32_t)(p[8] & 0x7f) << 7) | (uint32_t)(p[9] & 0x7f);
+	n += 10;
+	if (p[5] & 0x10)
+		n += 10;
+	return n;
+}
+
+
+//*****************************************************************************
+// trackProbe
+//*****************************************************************************
+// Reads the first frame header of track t, along with any Xing/Info or VBRI
+//  header, and fills in the track's info entry. Called either from the
+//  background probe service or lazily from trackGetInfo().
+//*****************************************************************************
+bool trackProbe(uint16_t t) {
+
+UINT br;
+uint32_t audioStart = 0;
+uint32_t audioBytes;
+uint32_t numFrames = 0;
+uint32_t tmp32;
+uint32_t i;
+uint8_t sideBytes;
+uint8_t * p;
+MP3_HEADER_STRUCTURE hdr;
+
+	if (t >= MAX_NUM_TRACKS)
+		return false;
+	trackInfo[t].flags = (trackInfo[t].flags & TRACK_INFO_LOUD) | TRACK_INFO_PROBED;
+	if (!trackOpen(t, &probeFile))
+		return false;
+	if ((f_read(&probeFile, gSdBuff, PROBE_READ_BYTES, &br) != FR_OK) || (br < 10)) {
+		f_close(&probeFile);
+		return false;
+	}
+	
+	// Skip over an ID3v2 tag if there is one
+	if ((audioStart = trackGetId3Bytes(gSdBuff, br)) > 0) {
+		if ((f_lseek(&probeFile, audioStart) != FR_OK) ||
+			(f_read(&probeFile, gSdBuff, PROBE_READ_BYTES, &br) != FR_OK)) {
+			f_close(&probeFile);
+			return false;
+		}
+	}
+	f_close(&probeFile);
+
+	// Scan for the first valid frame header
+	for (i = 0; (i + 4) <= br; i++) {
+		if (trackParseHeader(&gSdBuff[i], &hdr))
+			break;
+	}
+	if ((i + 4) > br)
+		return false;
+	audioStart += i;
+	p = &gSdBuff[i];
+	
+	// Look for a Xing/Info header, which follows the side info
+	if (hdr.lsf)
+		sideBytes = (hdr.mode == TRACK_MODE_MONO) ? 9 : 17;
+	else
+		sideBytes = (hdr.mode == TRACK_MODE_MONO) ? 17 : 32;
+	if ((i + 4 + sideBytes + 16) <= br) {
+		if ((memcmp(&p[4 + sideBytes], "Xing", 4) == 0) ||
+			(memcmp(&p[4 + sideBytes], "Info", 4) == 0)) {
+			tmp32 = trackGetBE32(&p[8 + sideBytes]);
+			if (tmp32 & 0x01)
+				numFrames = trackGetBE32(&p[12 + sideBytes]);
+			if (p[4 + sideBytes] == 'X')
+				trackInfo[t].flags |= TRACK_INFO_VBR;
+		}
+	}
+	
+	// Look for a VBRI header, which is always 32 bytes after the header
+	if ((numFrames == 0) && ((i + 4 + 32 + 18) <= br)) {
+		if (memcmp(&p[36], "VBRI", 4) == 0) {
+			numFrames = trackGetBE32(&p[50]);
+			trackInfo[t].flags |= TRACK_INFO_VBR;
+		}
+	}
+
+	// Without a frame count, assume CBR and estimate from the file size.
+	//  Otherwise compute the average bitrate from the frame count.
+	audioBytes = 0;
+	if (track[t].fileSize.lSize > audioStart)
+		audioBytes = track[t].fileSize.lSize - audioStart;
+	if (numFrames == 0) {
+		numFrames = (uint32_t)(((uint64_t)audioBytes * 8 * trackSampleRates[hdr.srIdx]) /
+			((uint64_t)hdr.samplesPerFrame * hdr.bitrateKbps * 1000));
+		trackInfo[t].bitrateKbps = hdr.bitrateKbps;
+	}
+	else {
+		trackInfo[t].bitrateKbps = (uint16_t)(((uint64_t)audioBytes * 8 * trackSampleRates[hdr.srIdx]) /
+			((uint64_t)numFrames * hdr.samplesPerFrame * 1000));
+	}
+	trackInfo[t].numFrames = numFrames;
+	trackInfo[t].format = hdr.srIdx | (hdr.mode << TRACK_INFO_MODE_SHIFT);
+	trackInfo[t].flags |= TRACK_INFO_VALID;
+	return true;
+}
+
+
+//*****************************************************************************
+// trackProbeService
+//*****************************************************************************
+// Called from the main loop to probe one track per call, so that all of the
+//  track info entries get filled in without holding up the main loop. Only
+//  called while the voices are idle, since the probe holds the decode lock.
+//*****************************************************************************
+void trackProbeService(void) {
+
+	while (gProbeIndex < MAX_NUM_TRACKS) {
+		if ((track[gProbeIndex].flags & TRACK_FLAG_EXISTS) &&
+			((trackInfo[gProbeIndex].flags & TRACK_INFO_PROBED) == 0)) {
+			voicesDecodeLock();
+			trackProbe(gProbeIndex++);
+			voicesDecodeUnlock();
+			return;
+		}
+		gProbeIndex++;
+	}
+}
+
+
+//*****************************************************************************
+// trackProbeBusy
+//*****************************************************************************
+// Returns true until the background probe has been through every track.
+//*****************************************************************************
+bool trackProbeBusy(void) {
+
+	return (gProbeIndex < MAX_NUM_TRACKS);
+}
+
+
+//*****************************************************************************
+// trackGetInfo
+//*****************************************************************************
+// Returns the info entry for track t, probing it first if the background
+//  service hasn't gotten to it yet. Returns NULL if there's no valid info.
+//*****************************************************************************
+TRACK_INFO_STRUCTURE * trackGetInfo(uint16_t t) {
+
+	if ((t >= MAX_NUM_TRACKS) || ((track[t].flags & TRACK_FLAG_EXISTS) == 0))
+		return NULL;
+	if ((trackInfo[t].flags & TRACK_INFO_PROBED) == 0) {
+		voicesDecodeLock();
+		trackProbe(t);
+		voicesDecodeUnlock();
+	}
+	if ((trackInfo[t].flags & TRACK_INFO_VALID) == 0)
+		return NULL;
+	return &trackInfo[t];
+}
+
+
+//*****************************************************************************
+// trackGetSampleRate
+//*****************************************************************************
+uint32_t trackGetSampleRate(uint16_t t) {
+
+TRACK_INFO_STRUCTURE * pInfo;
+
+	if ((pInfo = trackGetInfo(t)) == NULL)
+		return 0;
+	return trackSampleRates[pInfo->format & TRACK_INFO_SR_MASK];
+}
+
+
+//*****************************************************************************
+// trackGetChannels
+//*****************************************************************************
+uint8_t trackGetChannels(uint16_t t) {
+
+TRACK_INFO_STRUCTURE * pInfo;
+
+	if ((pInfo = trackGetInfo(t)) == NULL)
+		return 0;
+	if (((pInfo->format >> TRACK_INFO_MODE_SHIFT) & TRACK_INFO_MODE_MASK) == TRACK_MODE_MONO)
+		return 1;
+	return 2;
+}
+
+
+//*****************************************************************************
+// trackGetDurationMs
+//*****************************************************************************
+uint32_t trackGetDurationMs(uint16_t t) {
+
+TRACK_INFO_STRUCTURE * pInfo;
+uint8_t srIdx;
+uint32_t spf;
+
+	if ((pInfo = trackGetInfo(t)) == NULL)
+		return 0;
+	srIdx = pInfo->format & TRACK_INFO_SR_MASK;
+	spf = (srIdx < 3) ? 1152 : 576;
+	return (uint32_t)(((uint64_t)pInfo->numFrames * spf * 1000) / trackSampleRates[srIdx]);
+}
+
+
+//*****************************************************************************
+// trackSetMode
+//*****************************************************************************
+// Sets the loop and lock flags for track t. These apply every time the
+//  track is started, in addition to the loop and lock for that start.
+//*****************************************************************************
+bool trackSetMode(uint16_t t, bool loop, bool lock) {
+
+	if ((t >= MAX_NUM_TRACKS) || ((track[t].flags & TRACK_FLAG_EXISTS) == 0))
+		return false;
+	track[t].flags &= ~(TRACK_FLAG_LOOP | TRACK_FLAG_LOCK);
+	if (loop)
+		track[t].flags |= TRACK_FLAG_LOOP;
+	if (lock)
+		track[t].flags |= TRACK_FLAG_LOCK;
+	return true;
+}
@@ -0,0 +1,175 @@
+// ****************************************************************************
+//     Filename: TRIGGER.C
+// Date Created: 10/19/2026
+//
+//     Comments: Trigger inputs for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+#include "player.h"
+
+
+// ****************************************************************************
+// External variables
+
+extern uint16_t gTrigBuff[];			// Our GPIO sample DMA buffer
+
+
+// ****************************************************************************
+// Global variables
+
+uint16_t gTrigOutPtr = 0;				// Next DMA sample to debounce
+uint16_t gTrigState = 0;				// Debounced trigger state, 1 = pressed
+uint16_t gTrigCount0 = 0;				// Vertical debounce counter bit 0
+uint16_t gTrigCount1 = 0;				// Vertical debounce counter bit 1
+volatile uint32_t gTrigTime = 0;		// Trigger sample clock
+
+TRIGGER_EVENT_STRUCTURE trigEvent[TRIG_EVENT_QUEUE_SIZE];
+volatile uint8_t gTrigEventIn = 0;
+volatile uint8_t gTrigEventOut = 0;
+volatile uint32_t gTrigDropped = 0;
+
+
+//*****************************************************************************
+// triggerInit
+//*****************************************************************************
+// Starts the timer driven DMA sampling of the trigger port.
+//*****************************************************************************
+void triggerInit(void) {
+
+	memset((uint8_t *)gTrigBuff, 0xff, TRIG_BUFF_SAMPLES * sizeof(uint16_t));
+	gTrigOutPtr = 0;
+	gTrigState = 0;
+	gTrigCount0 = 0;
+	gTrigCount1 = 0;
+	gTrigEventIn = 0;
+	gTrigEventOut = 0;
+	biosTriggerStart(gTrigBuff, TRIG_BUFF_SAMPLES, TRIG_SAMPLE_RATE);
+}
+
+
+//*****************************************************************************
+// triggerScan
+//*****************************************************************************
+// Called from the audio interrupt to debounce the port samples the DMA has
+//  taken since the last call, about a dozen of them. All 16 inputs are
+//  debounced at once with 2-bit vertical counters: each input's counter
+//  advances while its sample differs from the debounced state and resets
+//  when it matches, and the state toggles when the counter wraps. Changes
+//  are queued for triggerService with the sample clock time they happened.
+//*****************************************************************************
+void triggerScan(void) {
+
+uint16_t inPtr;
+uint16_t delta;
+uint16_t toggle;
+uint8_t n;
+uint8_t next;
+
+	inPtr = biosTriggerGetIndex(TRIG_BUFF_SAMPLES);
+	while (gTrigOutPtr != inPtr) {
+	
+		delta = (~gTrigBuff[gTrigOutPtr] & TRIG_PIN_MASK) ^ gTrigState;
+		gTrigCount1 = (gTrigCount1 ^ gTrigCount0) & delta;
+		gTrigCount0 = ~gTrigCount0 & delta;
+		toggle = delta & ~(gTrigCount0 | gTrigCount1);
+		gTrigState ^= toggle;
+		
+		while (toggle != 0) {
+			n = __CLZ(__RBIT(toggle));
+			toggle &= (toggle - 1);
+			next = gTrigEventIn + 1;
+			if (next >= TRIG_EVENT_QUEUE_SIZE)
+				next = 0;
+			if (next == gTrigEventOut) {
+				gTrigDropped++;
+				continue;
+			}
+			trigEvent[gTrigEventIn].time = gTrigTime;
+			trigEvent[gTrigEventIn].trig = n;
+			trigEvent[gTrigEventIn].edge = (gTrigState & (1 << n)) ? TRIG_EDGE_PRESS : TRIG_EDGE_RELEASE;
+			gTrigEventIn = next;
+		}
+		
+		gTrigTime++;
+		if (++gTrigOutPtr >= TRIG_BUFF_SAMPLES)
+			gTrigOutPtr = 0;
+	}
+}
+
+
+//*****************************************************************************
+// triggerService
+//*****************************************************************************
+// Called from the main loop to hand queued trigger events to the action map.
+//*****************************************************************************
+void triggerService(void) {
+
+TRIGGER_EVENT_STRUCTURE * pEvent;
+uint8_t out;
+
+	out = gTrigEventOut;
+	while (out != gTrigEventIn) {
+		pEvent = &trigEvent[out];
+		actionDispatch(pEvent->trig, pEvent->edge);
+		if (++out >= TRIG_EVENT_QUEUE_SIZE)
+			out = 0;
+		gTrigEventOut = out;
+	}
+}
+
+
+//*****************************************************************************
+// triggerBusy
+//*****************************************************************************
+// Returns true if there are trigger events waiting to be dispatched.
+//*****************************************************************************
+bool triggerBusy(void) {
+
+	return (gTrigEventOut != gTrigEventIn);
+}
+
+
+//*****************************************************************************
+// triggerGetState
+//*****************************************************************************
+uint16_t triggerGetState(void) {
+
+	return gTrigState;
+}
+
+
+//*****************************************************************************
+// triggerGetTime
+//*****************************************************************************
+uint32_t triggerGetTime(void) {
+
+	return gTrigTime;
+}
+
+
+//*****************************************************************************
+// triggerGetDropped
+//*****************************************************************************
+uint32_t triggerGetDropped(void) {
+
+	return gTrigDropped;
+}
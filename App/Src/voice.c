@@ -21,20 +21,33 @@
 // External variables
 
 extern MP3_VOICE_STRUCTURE mp3[];	// Our mp3 structure array
-extern WAV_VOICE_STRUCTURE wav[];	// Our mp3 structure array
 
-extern Q1_15 gain_tble[];			// Our gain table
+extern q15_t gain_tble[];			// Our gain table
 
 extern TRACK_STRUCTURE track[];		// Our track structure array
 
+extern volatile uint8_t gNumMP3Voices;
+
 
 // ****************************************************************************
 // Global variables
 
-uint8_t gNumMP3Voices;
-uint8_t gNumWavVoices;
-uint8_t gVoiceIndex = 0;					// Our global voice index
+uint8_t gStealPolicy = VOICE_STEAL_OLDEST;
+
+VOICE_START_STRUCTURE voiceStart[MAX_NUM_MP3_VOICES];
+volatile bool voiceStartPending[MAX_NUM_MP3_VOICES];
+bool voiceStartBatch[MAX_NUM_MP3_VOICES];
 
+volatile bool gDecodeKicked = false;			// Decode tier is pended
+volatile uint32_t gDecodeKickTime = 0;			// Cycle count when it was pended
+volatile uint8_t gDecodeLock = 0;				// Main loop is using the SD card
+volatile bool gDecodeDeferred = false;			// Decode tier ran while locked
+
+VOICE_CMD_STRUCTURE voiceBatch[VOICE_BATCH_SIZE];
+uint8_t gBatchCount = 0;
+bool gBatchOpen = false;						// Collecting a batch
+bool gBatchCommitted = false;					// Waiting on the batch's starts
+bool gBatchFailed = false;						// Batch ran out of room
 
 
 //*****************************************************************************
@@ -49,35 +62,134 @@ uint8_t v;
 		memset((uint8_t *)&mp3[v], 0, sizeof(MP3_VOICE_STRUCTURE));
 		mp3[v].state = VOICE_STATE_AVAIL;
 		mp3[v].fader.active = false;
+		voiceStartPending[v] = false;
+		voiceStartBatch[v] = false;
 	}
+	voiceQueueInit();
+	gBatchOpen = false;
+	gBatchCommitted = false;
+	gBatchFailed = false;
 	gNumMP3Voices = MAX_NUM_MP3_VOICES;
 	mp3DecodeInit();
-	
-	for (v = 0; v < MAX_NUM_WAV_VOICES; v++) {
-		memset((uint8_t *)&wav[v], 0, sizeof(WAV_VOICE_STRUCTURE));
-		mp3[v].state = VOICE_STATE_AVAIL;
-		mp3[v].fader.active = false;
+}
+
+
+//*****************************************************************************
+// voicesQueueSend
+//*****************************************************************************
+static void voicesQueueSend(uint8_t cmd, uint8_t v, uint16_t ms) {
+
+	voiceQueuePut(cmd, v, ms);
+	voiceQueuePublish();
+}
+
+
+//*****************************************************************************
+// voicesBatchAdd
+//*****************************************************************************
+// Adds a command to the open batch. If there's no room the batch is marked
+//  failed, and voicesBatchCommit throws all of it away.
+//*****************************************************************************
+static void voicesBatchAdd(uint8_t cmd, uint8_t v, uint16_t ms) {
+
+	if (gBatchCount >= VOICE_BATCH_SIZE) {
+		gBatchFailed = true;
+		return;
+	}
+	voiceBatch[gBatchCount].cmd = cmd;
+	voiceBatch[gBatchCount].voice = v;
+	voiceBatch[gBatchCount].ms = ms;
+	gBatchCount++;
+}
+
+
+//*****************************************************************************
+// voicesBatchDrop
+//*****************************************************************************
+// Throws away the open or committed batch. Its starts that haven't been
+//  opened yet are cancelled, and those already READY are stopped so their
+//  voices are freed.
+//*****************************************************************************
+static void voicesBatchDrop(void) {
+
+uint8_t v;
+
+	for (v = 0; v < gNumMP3Voices; v++) {
+		if (!voiceStartBatch[v])
+			continue;
+		voiceStartBatch[v] = false;
+		if (voiceStartPending[v])
+			voiceStartPending[v] = false;
+		else if (mp3[v].state == VOICE_STATE_READY)
+			voiceQueuePut(VOICE_CMD_STOP, v, 0);
 	}
-	gNumWavVoices = MAX_NUM_MP3_VOICES;
+	voiceQueuePublish();
+	gBatchCount = 0;
+	gBatchOpen = false;
+	gBatchCommitted = false;
+	gBatchFailed = false;
+}
+
+
+//*****************************************************************************
+// voicesStopVoice
+//*****************************************************************************
+// Queues a stop or fade for voice v, or adds it to the open batch.
+//*****************************************************************************
+static void voicesStopVoice(uint8_t v, uint16_t releaseMs) {
+
+uint8_t cmd;
 
+	cmd = (releaseMs == 0) ? VOICE_CMD_STOP : VOICE_CMD_FADE;
+	if (gBatchOpen)
+		voicesBatchAdd(cmd, v, releaseMs);
+	else
+		voicesQueueSend(cmd, v, releaseMs);
 }
 
 
 //*****************************************************************************
 // voicesStopAll
 //*****************************************************************************
+// Stops every voice. Inside an open batch the stops join the batch.
+//  Otherwise a committed batch still waiting on its starts is dropped along
+//  with them.
+//*****************************************************************************
 void voicesStopAll(void) {
 	
 uint8_t v;
 	
+	if (gBatchOpen) {
+		for (v = 0; v < gNumMP3Voices; v++) {
+			if (mp3[v].state == VOICE_STATE_PLAYING)
+				voicesBatchAdd(VOICE_CMD_STOP, v, 0);
+		}
+		return;
+	}
 	for (v = 0; v < gNumMP3Voices; v++) {
-		mp3Stop(v);
+		voiceStartPending[v] = false;
+		voiceStartBatch[v] = false;
+		voiceQueuePut(VOICE_CMD_STOP, v, 0);
 	}
+	voiceQueuePublish();
+	gBatchCount = 0;
+	gBatchCommitted = false;
+}
+
+
+//*****************************************************************************
+// voicesFadeAll
+//*****************************************************************************
+// Fades out and stops every playing voice over releaseMs.
+//*****************************************************************************
+void voicesFadeAll(uint16_t releaseMs) {
 	
-	for (v = 0; v < gNumWavVoices; v++) {
-		wavStop(v);
+uint8_t v;
+	
+	for (v = 0; v < gNumMP3Voices; v++) {
+		if ((mp3[v].state == VOICE_STATE_PLAYING) && !voiceStartPending[v])
+			voicesStopVoice(v, releaseMs);
 	}
-
 }
 
 
@@ -87,33 +199,512 @@ uint8_t v;
 uint8_t voicesCheck(void) {
 
 uint8_t v;
-uint8_t cnt;;
+uint8_t cnt;
 
 	cnt = 0;
 	for (v = 0; v < gNumMP3Voices; v++) {
 		if (mp3[v].state == VOICE_STATE_PLAYING)
 			cnt++;
 	}
-	for (v = 0; v < gNumWavVoices; v++) {
-		if (wav[v].state == VOICE_STATE_PLAYING)
-			cnt++;
-	}
 	return cnt;
 }
 
 
+//*****************************************************************************
+// voicesBusy
+//*****************************************************************************
+// Returns true if a queued start has a free voice to open its file on.
+//  Starts still waiting on a voice to stop are picked up after the audio
+//  interrupt that frees it.
+//*****************************************************************************
+bool voicesBusy(void) {
+
+uint8_t v;
+
+	for (v = 0; v < gNumMP3Voices; v++) {
+		if (voiceStartPending[v] && (mp3[v].state == VOICE_STATE_AVAIL))
+			return true;
+	}
+	return false;
+}
+
+
+//*****************************************************************************
+// voicesIdle
+//*****************************************************************************
+// Returns true if no voice is playing or primed and no start is queued, so
+//  background SD work can hold the card and the decode lock without holding
+//  up a refill or a start.
+//*****************************************************************************
+bool voicesIdle(void) {
+
+uint8_t v;
+
+	for (v = 0; v < gNumMP3Voices; v++) {
+		if ((mp3[v].state == VOICE_STATE_PLAYING) || (mp3[v].state == VOICE_STATE_READY) ||
+				voiceStartPending[v])
+			return false;
+	}
+	return true;
+}
+
+
+//*****************************************************************************
+// voicesAllocate
+//*****************************************************************************
+// Picks a voice for track t in one pass over the voices, without touching
+//  the SD card. A free voice is used if there is one, otherwise a playing
+//  voice is chosen by the steal policy. Voices that are locked, or that are
+//  already waiting on a queued start, can't be taken. Returns VOICE_NO_VOICE
+//  if there's nothing we can use.
+//*****************************************************************************
+uint8_t voicesAllocate(uint16_t t) {
+
+uint8_t v;
+uint8_t best;
+uint8_t map;
+
+	best = VOICE_NO_VOICE;
+	for (v = 0; v < gNumMP3Voices; v++) {
+		if (voiceStartPending[v])
+			continue;
+		if (mp3[v].state == VOICE_STATE_AVAIL)
+			return v;
+		if ((mp3[v].state != VOICE_STATE_PLAYING) || mp3[v].lockFlag)
+			continue;
+		if (best == VOICE_NO_VOICE) {
+			best = v;
+			continue;
+		}
+		switch (gStealPolicy) {
+		
+			case VOICE_STEAL_QUIETEST:
+				if (mp3[v].currGainIdx < mp3[best].currGainIdx)
+					best = v;
+			break;
+			
+			case VOICE_STEAL_PRIORITY:
+				if ((mp3[v].priority < mp3[best].priority) ||
+					((mp3[v].priority == mp3[best].priority) &&
+					((int32_t)(mp3[v].time - mp3[best].time) < 0)))
+					best = v;
+			break;
+			
+			default:
+				if ((int32_t)(mp3[v].time - mp3[best].time) < 0)
+					best = v;
+			break;
+		}
+	}
+	// For retrigger, take the first voice from the track's voice map that
+	//  we're allowed to steal
+	if (gStealPolicy == VOICE_STEAL_RETRIGGER) {
+		map = track[t].voices;
+		for (v = 0; map != 0; v++, map >>= 1) {
+			if ((map & 0x01) && !voiceStartPending[v] && !mp3[v].lockFlag)
+				return v;
+		}
+	}
+	return best;
+}
+
+
+//*****************************************************************************
+// voicesPlayTrack
+//*****************************************************************************
+// Queues track t to start on a voice from voicesAllocate, at pan position
+//  pan (0 - 128, 64 = center). If the voice is playing it's stolen with a
+//  short fade out, and the track starts once the fade is done. If attackMs
+//  is non-zero the voice fades up from silence to gainDb. Returns the voice
+//  number, or VOICE_NO_VOICE if no voice could be had. The SD card work is
+//  left to voicesService, so this is safe to call from the trigger path.
+//*****************************************************************************
+uint8_t voicesPlayTrack(uint16_t t, int16_t gainDb, uint8_t pan, uint16_t attackMs,
+						int16_t cents, bool loop, bool lock, uint8_t priority) {
+
+uint8_t v;
+
+	// A start that doesn't fit in the open batch fails the batch, rather
+	//  than going out on its own
+	if (gBatchOpen && (gBatchCount >= VOICE_BATCH_SIZE)) {
+		gBatchFailed = true;
+		return VOICE_NO_VOICE;
+	}
+	if ((v = voicesAllocate(t)) == VOICE_NO_VOICE)
+		return VOICE_NO_VOICE;
+
+	voiceStart[v].track = t;
+	voiceStart[v].gainDb = gainDb;
+	voiceStart[v].pan = pan;
+	voiceStart[v].priority = priority;
+	voiceStart[v].attackMs = attackMs;
+	voiceStart[v].cents = cents;
+	voiceStart[v].loop = loop;
+	voiceStart[v].lock = lock;
+	voiceStartPending[v] = true;
+	voiceStartBatch[v] = gBatchOpen;
+	if (voiceStartBatch[v])
+		voicesBatchAdd(VOICE_CMD_START, v, 0);
+	
+	if (mp3[v].state == VOICE_STATE_PLAYING)
+		voicesQueueSend(VOICE_CMD_FADE, v, VOICE_STEAL_FADE_MS);
+	return v;
+}
+
+
+//*****************************************************************************
+// voicesStartPending
+//*****************************************************************************
+// Opens the queued tracks whose voices are free and leaves them READY, with
+//  a start command queued for the audio interrupt. Starts that are part of a
+//  batch wait for the batch, which is queued once none are left to open.
+//*****************************************************************************
+static void voicesStartPending(void) {
+
+uint8_t v;
+VOICE_START_STRUCTURE * pStart;
+
+	for (v = 0; v < gNumMP3Voices; v++) {
+		if (!voiceStartPending[v] || (mp3[v].state != VOICE_STATE_AVAIL))
+			continue;
+		pStart = &voiceStart[v];
+		voicesDecodeLock();
+		if (mp3OpenFile(v, pStart->track, (pStart->attackMs > 0) ? MIN_GAIN_DB : pStart->gainDb,
+				pStart->loop || (track[pStart->track].flags & TRACK_FLAG_LOOP)) != VOICE_ERR_NOERROR) {
+			voicesDecodeUnlock();
+			voiceStartPending[v] = false;
+			voiceStartBatch[v] = false;
+			continue;
+		}
+		voicesDecodeUnlock();
+		if (pStart->attackMs > 0)
+			mp3StartFader(v, pStart->gainDb, pStart->attackMs, false);
+		mp3SetPitch(v, pStart->cents);
+		mp3SetPan(v, pStart->pan);
+		mp3[v].lockFlag = pStart->lock || (track[pStart->track].flags & TRACK_FLAG_LOCK);
+		mp3[v].priority = pStart->priority;
+		mp3[v].noteNum = 0xff;
+		mp3MarkTime(v);
+		voiceStartPending[v] = false;
+		mp3SetState(v, VOICE_STATE_READY);
+		voicesDecodeKick();
+		if (!voiceStartBatch[v])
+			voicesQueueSend(VOICE_CMD_START, v, 0);
+	}
+	
+	if (gBatchCommitted) {
+		for (v = 0; v < gNumMP3Voices; v++) {
+			if (voiceStartPending[v] && voiceStartBatch[v])
+				return;
+		}
+		if (voiceQueueFree() < gBatchCount)
+			return;
+		for (v = 0; v < gBatchCount; v++)
+			voiceQueuePut(voiceBatch[v].cmd, voiceBatch[v].voice, voiceBatch[v].ms);
+		voiceQueuePublish();
+		for (v = 0; v < gNumMP3Voices; v++)
+			voiceStartBatch[v] = false;
+		gBatchCount = 0;
+		gBatchCommitted = false;
+	}
+}
+
+
+//*****************************************************************************
+// voicesSetStealPolicy
+//*****************************************************************************
+void voicesSetStealPolicy(uint8_t policy) {
+
+	if (policy < VOICE_NUM_POLICIES)
+		gStealPolicy = policy;
+}
+
+
+//*****************************************************************************
+// voicesGetStealPolicy
+//*****************************************************************************
+uint8_t voicesGetStealPolicy(void) {
+
+	return gStealPolicy;
+}
+
+
+//*****************************************************************************
+// voicesStopTrack
+//*****************************************************************************
+// Stops all voices playing track t, with an optional release fade. Only the
+//  voices in the track's voice map are visited.
+//*****************************************************************************
+void voicesStopTrack(uint16_t t, uint16_t releaseMs) {
+
+uint8_t v;
+uint8_t map;
+
+	if (t >= MAX_NUM_TRACKS)
+		return;
+	map = track[t].voices;
+	for (v = 0; map != 0; v++, map >>= 1) {
+		if ((map & 0x01) && !voiceStartPending[v])
+			voicesStopVoice(v, releaseMs);
+	}
+}
+
+
+//*****************************************************************************
+// voicesIsTrackPlaying
+//*****************************************************************************
+bool voicesIsTrackPlaying(uint16_t t) {
+
+	if (t >= MAX_NUM_TRACKS)
+		return false;
+	return (track[t].voices != 0);
+}
+
+
 //*****************************************************************************
 // voicesService
 //*****************************************************************************
+// Called from the main loop to start queued tracks. Decoding is done by the
+//  decode tier.
+//*****************************************************************************
 void voicesService(void) {
 	
-	if (mp3[gVoiceIndex].state == VOICE_STATE_PLAYING) {
-		while (mp3CheckWavSpace(gVoiceIndex)) {
-			mp3DecodeWavData(gVoiceIndex);
+	voicesStartPending();
+}
+
+
+//*****************************************************************************
+// voicesDecodeKick
+//*****************************************************************************
+// Pends the decode tier, from the audio interrupt or the main loop.
+//*****************************************************************************
+void voicesDecodeKick(void) {
+
+	if (gDecodeKicked)
+		return;
+	gDecodeKickTime = biosGetCycleCount();
+	gDecodeKicked = true;
+#ifdef PLAYER_RTOS
+	rtosSignal(RTOS_FLAG_SDIO);
+#else
+	biosPendDecode();
+#endif
+}
+
+
+//*****************************************************************************
+// voicesDecodeLock
+//*****************************************************************************
+// FatFs and the decoder output buffer can't be shared with the decode tier,
+//  so the main loop holds it off while it uses them. A decode that comes due
+//  in the meantime runs when the lock is released.
+//*****************************************************************************
+void voicesDecodeLock(void) {
+
+#ifdef PLAYER_RTOS
+	rtosDiskLock();
+#else
+	gDecodeLock++;
+#endif
+}
+
+
+//*****************************************************************************
+// voicesDecodeUnlock
+//*****************************************************************************
+void voicesDecodeUnlock(void) {
+
+#ifdef PLAYER_RTOS
+	rtosDiskUnlock();
+	return;
+#endif
+	if (--gDecodeLock > 0)
+		return;
+	if (gDecodeDeferred) {
+		gDecodeDeferred = false;
+		biosPendDecode();
+	}
+}
+
+
+//*****************************************************************************
+// voicesDecode
+//*****************************************************************************
+// The decode tier, run from PendSV. It's pended by the audio interrupt when
+//  a voice's wav buffer has room for another frame, and by the main loop
+//  when a voice is opened. It keeps decoding until every voice's wav buffer
+//  is full, one MP3 frame at a time for whichever voice has the least audio
+//  left in terms of output time. That accounts for voices that are pitched
+//  or resampled up and consume their buffers faster than real time. In the
+//  RTOS port it's the decode thread, and takes the disk lock a frame at a
+//  time instead.
+//*****************************************************************************
+void voicesDecode(void) {
+	
+uint8_t v;
+uint8_t minV;
+uint32_t runway;
+uint32_t minRunway;
+
+#ifndef PLAYER_RTOS
+	// A deferred run stays kicked, so it keeps its kick time and the wait
+	//  for the lock counts towards its latency when it finally runs
+	if (gDecodeLock > 0) {
+		gDecodeDeferred = true;
+		return;
+	}
+#endif
+	if (gDecodeKicked) {
+		gDecodeKicked = false;
+		profileLatency(LAT_DECODE, biosGetCycleCount() - gDecodeKickTime);
+	}
+
+	while (1) {
+		minV = 0xff;
+		minRunway = 0xffffffff;
+		for (v = 0; v < gNumMP3Voices; v++) {
+			if (((mp3[v].state == VOICE_STATE_PLAYING) || (mp3[v].state == VOICE_STATE_READY)) &&
+				(!mp3[v].decodeDoneFlag) && mp3CheckWavSpace(v)) {
+				runway = mp3GetRunwayFrames(v);
+				if (runway < minRunway) {
+					minRunway = runway;
+					minV = v;
+				}
+			}
+		}
+		if (minV == 0xff)
+			return;
+#ifdef PLAYER_RTOS
+		voicesDecodeLock();
+#endif
+		profileStart(PROF_DECODE);
+		if (mp3DecodeWavData(minV) == 0)
+			mp3[minV].decodeDoneFlag = true;
+		profileEnd(PROF_DECODE);
+#ifdef PLAYER_RTOS
+		voicesDecodeUnlock();
+#endif
+	}
+}
+
+
+//*****************************************************************************
+// voicesRefill
+//*****************************************************************************
+// Tops up the MP3 buffers of the voices being decoded, so the decoder finds
+//  its data already there. Used by the SD I/O thread in the RTOS port.
+//*****************************************************************************
+void voicesRefill(void) {
+
+uint8_t v;
+
+	for (v = 0; v < gNumMP3Voices; v++) {
+		if (((mp3[v].state == VOICE_STATE_PLAYING) || (mp3[v].state == VOICE_STATE_READY)) &&
+			!mp3[v].decodeDoneFlag) {
+			voicesDecodeLock();
+			while (mp3CheckSdMp3Space(v)) {
+				if (mp3ReadSdMp3Data(v) == 0)
+					break;
+			}
+			voicesDecodeUnlock();
+		}
+	}
+}
+
+
+//*****************************************************************************
+// voicesMix
+//*****************************************************************************
+// Called by the audio interrupt to mix one buffer of every playing voice
+//  into the master bus. Voices that finish are freed. The command queue is
+//  emptied first, so everything the main loop has published lands in this
+//  buffer.
+//*****************************************************************************
+void voicesMix(q31_t * pBus) {
+
+uint8_t v;
+VOICE_CMD_STRUCTURE cmd;
+
+	while (voiceQueueGet(&cmd)) {
+		v = cmd.voice;
+		switch (cmd.cmd) {
+		
+			case VOICE_CMD_START:
+				if (mp3[v].state == VOICE_STATE_READY) {
+					track[mp3[v].track].voices |= (1 << v);
+					mp3[v].state = VOICE_STATE_PLAYING;
+				}
+			break;
+			
+			case VOICE_CMD_FADE:
+				if (mp3[v].state == VOICE_STATE_PLAYING)
+					mp3StartFader(v, MUTE_GAIN_DB, cmd.ms, true);
+			break;
+			
+			default:
+				if (mp3[v].state == VOICE_STATE_READY)
+					mp3[v].state = VOICE_STATE_AVAIL;
+				else
+					mp3Stop(v);
+			break;
+		}
+	}
+
+	for (v = 0; v < gNumMP3Voices; v++) {
+		if (mp3[v].state == VOICE_STATE_PLAYING) {
+			if (mp3GetAudio(v, pBus, MIX_BUFF_FRAMES)) {
+				track[mp3[v].track].voices &= ~(1 << v);
+				mp3[v].state = VOICE_STATE_AVAIL;
+			}
+			else if (!mp3[v].decodeDoneFlag && mp3CheckWavSpace(v))
+				voicesDecodeKick();
 		}
 	}
-	if (++gVoiceIndex >= MAX_NUM_MP3_VOICES)
-		gVoiceIndex = 0;	
 }
 
 
+//*****************************************************************************
+// voicesBatchBegin
+//*****************************************************************************
+// Opens a batch. Returns false if one is already open or still on its way
+//  to the audio interrupt.
+//*****************************************************************************
+bool voicesBatchBegin(void) {
+
+	if (gBatchOpen || gBatchCommitted)
+		return false;
+	gBatchCount = 0;
+	gBatchFailed = false;
+	gBatchOpen = true;
+	return true;
+}
+
+
+//*****************************************************************************
+// voicesBatchCommit
+//*****************************************************************************
+// Closes the open batch. voicesService hands it to the audio interrupt once
+//  its starts are ready. Returns false if the batch overflowed, in which case
+//  none of it is applied.
+//*****************************************************************************
+bool voicesBatchCommit(void) {
+
+	if (!gBatchOpen)
+		return false;
+	if (gBatchFailed) {
+		voicesBatchDrop();
+		return false;
+	}
+	gBatchOpen = false;
+	gBatchCommitted = true;
+	return true;
+}
+
+
+//*****************************************************************************
+// voicesBatchIsOpen
+//*****************************************************************************
+bool voicesBatchIsOpen(void) {
+
+	return gBatchOpen;
+}
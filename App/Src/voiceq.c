@@ -0,0 +1,117 @@
+// ****************************************************************************
+//     Filename: VOICEQ.C
+// Date Created: 10/19/2026
+//
+//     Comments: Voice command queue for the Robertsonics OpenMP3 Player
+//
+// Build Environment: Visual Studio Code
+//                    STM32CubeMx
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+#include "player.h"
+
+
+// ****************************************************************************
+// Global variables
+
+VOICE_CMD_STRUCTURE voiceQueue[VOICE_QUEUE_SIZE];
+volatile uint8_t gVoiceQueueIn = 0;			// Published by the main loop
+volatile uint8_t gVoiceQueueOut = 0;			// Advanced by the audio interrupt
+uint8_t gVoiceQueueWrite = 0;					// Main loop's unpublished input
+
+
+//*****************************************************************************
+// voiceQueueInit
+//*****************************************************************************
+void voiceQueueInit(void) {
+
+	gVoiceQueueIn = 0;
+	gVoiceQueueOut = 0;
+	gVoiceQueueWrite = 0;
+}
+
+
+//*****************************************************************************
+// voiceQueueFree
+//*****************************************************************************
+// Returns how many more commands the main loop can put on the queue.
+//*****************************************************************************
+uint8_t voiceQueueFree(void) {
+
+	return (gVoiceQueueOut - gVoiceQueueWrite - 1) & (VOICE_QUEUE_SIZE - 1);
+}
+
+
+//*****************************************************************************
+// voiceQueuePut
+//*****************************************************************************
+// Adds a command to the queue. The audio interrupt doesn't see it until
+//  voiceQueuePublish, so a group of commands can be handed over together.
+//  The audio interrupt empties the queue every buffer, so if it's full we
+//  only wait for the next one.
+//*****************************************************************************
+void voiceQueuePut(uint8_t cmd, uint8_t v, uint16_t ms) {
+
+VOICE_CMD_STRUCTURE * pCmd;
+
+	while (voiceQueueFree() == 0)
+		;
+	pCmd = &voiceQueue[gVoiceQueueWrite];
+	pCmd->cmd = cmd;
+	pCmd->voice = v;
+	pCmd->ms = ms;
+	gVoiceQueueWrite = (gVoiceQueueWrite + 1) & (VOICE_QUEUE_SIZE - 1);
+}
+
+
+//*****************************************************************************
+// voiceQueuePublish
+//*****************************************************************************
+void voiceQueuePublish(void) {
+
+	// The commands have to be in memory before the audio interrupt can
+	//  see the new input index
+	__DMB();
+	gVoiceQueueIn = gVoiceQueueWrite;
+}
+
+
+//*****************************************************************************
+// voiceQueueGet
+//*****************************************************************************
+// Called by the audio interrupt to take the next published command. Returns
+//  false if there isn't one.
+//*****************************************************************************
+bool voiceQueueGet(VOICE_CMD_STRUCTURE * pCmd) {
+
+uint8_t out;
+
+	out = gVoiceQueueOut;
+	if (out == gVoiceQueueIn)
+		return false;
+
+	// Read the command only once the input index covering it has been seen,
+	//  and finish with it before its slot is handed back
+	__DMB();
+	*pCmd = voiceQueue[out];
+	__DMB();
+	gVoiceQueueOut = (out + 1) & (VOICE_QUEUE_SIZE - 1);
+	return true;
+}
@@ -108,7 +108,11 @@ int main(void)
   MX_I2S2_Init();
   /* USER CODE BEGIN 2 */
 
+#ifdef PLAYER_RTOS
+  rtosStart();
+#else
   sdTestInit();
+#endif
 
   /* USER CODE END 2 */
 
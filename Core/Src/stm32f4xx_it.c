@@ -145,6 +145,9 @@ void UsageFault_Handler(void)
   }
 }
 
+#ifndef PLAYER_RTOS
+/* The RTOS port's kernel supplies the SVC, PendSV and SysTick handlers */
+
 /**
   * @brief This function handles System service call via SWI instruction.
   */
@@ -157,6 +160,7 @@ void SVC_Handler(void)
 
   /* USER CODE END SVCall_IRQn 1 */
 }
+#endif
 
 /**
   * @brief This function handles Debug monitor.
@@ -171,6 +175,7 @@ void DebugMon_Handler(void)
   /* USER CODE END DebugMonitor_IRQn 1 */
 }
 
+#ifndef PLAYER_RTOS
 /**
   * @brief This function handles Pendable request for system service.
   */
@@ -178,6 +183,8 @@ void PendSV_Handler(void)
 {
   /* USER CODE BEGIN PendSV_IRQn 0 */
 
+  voicesDecode();
+
   /* USER CODE END PendSV_IRQn 0 */
   /* USER CODE BEGIN PendSV_IRQn 1 */
 
@@ -199,6 +206,7 @@ void SysTick_Handler(void)
 
   /* USER CODE END SysTick_IRQn 1 */
 }
+#endif
 
 /******************************************************************************/
 /* STM32F4xx Peripheral Interrupt Handlers                                    */
@@ -0,0 +1,55 @@
+// ****************************************************************************
+//     Filename: PLAYER.H
+// Date Created: 10/19/2026
+//
+//     Comments: Host stand-in for the player header, used by the host tests and tools
+//
+// Build Environment: CMake, host gcc or clang
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+#ifndef PLAYER_20261019
+#define PLAYER_20261019
+
+// The host build takes this in place of App/Inc/player.h, so the player
+//  modules that don't touch the hardware compile unchanged against the
+//  standard headers. Anything a host build needs from the firmware headers
+//  is brought in here.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+// The firmware's data memory barrier, as a full fence between threads
+
+#define __DMB()		__atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+// Host buffers are sized for the most voices a build can have
+
+#define MAX_NUM_MP3_VOICES		8
+
+typedef int32_t q31_t;
+
+#include "voiceq.h"
+#include "voice.h"
+#include "proto.h"
+#include "telem.h"
+#include "rtos.h"
+
+#endif
@@ -0,0 +1,57 @@
+// ****************************************************************************
+//     Filename: TELEMDEC.H
+// Date Created: 10/19/2026
+//
+//     Comments: Host telemetry and protocol frame decoder header
+//
+// Build Environment: CMake, host gcc or clang
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+// Picks the binary protocol frames the player sends out of a serial byte
+//  stream, which may have console text mixed in, checks their CRC and
+//  unpacks telemetry frames. See proto.h and telem.h for the layouts.
+
+typedef struct {
+	uint8_t seq;
+	uint8_t len;
+	uint8_t payload[256];
+} TELEMDEC_FRAME_STRUCTURE;
+
+typedef struct {
+	uint8_t seq;
+	uint8_t cpuLoad;
+	uint8_t numVoices;
+	uint32_t msTicks;
+	uint32_t underruns;
+	uint16_t sdLastUs;
+	uint16_t sdPeakUs;
+	TELEM_VOICE_STRUCTURE voice[MAX_NUM_MP3_VOICES];
+} TELEMDEC_STATUS_STRUCTURE;
+
+// Function prototypes for this module
+
+void telemDecInit(void);
+uint16_t telemDecCrc16(uint16_t crc, const uint8_t * pData, uint16_t len);
+bool telemDecByte(uint8_t c, TELEMDEC_FRAME_STRUCTURE * pFrame);
+bool telemDecStatus(const TELEMDEC_FRAME_STRUCTURE * pFrame, TELEMDEC_STATUS_STRUCTURE * pStatus);
+void telemDecPrint(FILE * fp, const TELEMDEC_FRAME_STRUCTURE * pFrame);
+uint32_t telemDecGetFrames(void);
+uint32_t telemDecGetCrcErrors(void);
+uint32_t telemDecGetLost(void);
@@ -0,0 +1,528 @@
+// ****************************************************************************
+//     Filename: OS2POSIX.C
+// Date Created: 10/19/2026
+//
+//     Comments: Host POSIX backend for the CMSIS-RTOS2 calls used by the RTOS port
+//
+// Build Environment: CMake, host gcc or clang
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+#include "player.h"
+#include "cmsis_os2.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdalign.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+
+
+// ****************************************************************************
+// Just the CMSIS-RTOS2 calls that rtos.c makes, on pthreads, so the RTOS
+//  port's threads can be run and tested on a host. One tick is 1ms of the
+//  monotonic clock. Threads created before osKernelStart() hold off until
+//  it's called, the same as on the target. Thread priorities and stack
+//  memory are accepted but not used, so nothing here checks that a higher
+//  priority thread preempts a lower one. Control blocks go in cb_mem when
+//  it's big enough and aligned for them, or are allocated otherwise.
+
+typedef struct {
+	pthread_t thread;
+	osThreadFunc_t func;
+	void * argument;
+} OS_THREAD_STRUCTURE;
+
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	uint32_t flags;
+} OS_FLAGS_STRUCTURE;
+
+typedef struct {
+	pthread_mutex_t mutex;
+} OS_MUTEX_STRUCTURE;
+
+typedef struct {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	osTimerFunc_t func;
+	void * argument;
+	osTimerType_t type;
+	bool running;
+	uint32_t period;						// In ticks
+	uint64_t due;							// In ns of the monotonic clock
+} OS_TIMER_STRUCTURE;
+
+pthread_mutex_t gOsLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t gOsStarted = PTHREAD_COND_INITIALIZER;
+osKernelState_t gOsState = osKernelInactive;
+uint64_t gOsEpoch = 0;
+
+
+//*****************************************************************************
+// osNow
+//*****************************************************************************
+// The monotonic clock in ns.
+//*****************************************************************************
+static uint64_t osNow(void) {
+
+struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+
+//*****************************************************************************
+// osTimespec
+//*****************************************************************************
+static struct timespec osTimespec(uint64_t ns) {
+
+struct timespec ts;
+
+	ts.tv_sec = (time_t)(ns / 1000000000ULL);
+	ts.tv_nsec = (long)(ns % 1000000000ULL);
+	return ts;
+}
+
+
+//*****************************************************************************
+// osCondInit
+//*****************************************************************************
+// Condition variables time out on the monotonic clock, so their waits are
+//  measured in the same ticks as everything else.
+//*****************************************************************************
+static void osCondInit(pthread_cond_t * pCond) {
+
+pthread_condattr_t attr;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(pCond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+
+//*****************************************************************************
+// osCbAlloc
+//*****************************************************************************
+// Uses the caller's control block memory if it'll hold the object, or else
+//  allocates it.
+//*****************************************************************************
+static void * osCbAlloc(void * cb_mem, uint32_t cb_size, size_t size, size_t align) {
+
+	if ((cb_mem != NULL) && (cb_size >= size) && (((uintptr_t)cb_mem % align) == 0))
+		return memset(cb_mem, 0, size);
+	return calloc(1, size);
+}
+
+
+//*****************************************************************************
+// osWaitStart
+//*****************************************************************************
+// Holds a new thread back until the kernel is started.
+//*****************************************************************************
+static void osWaitStart(void) {
+
+	pthread_mutex_lock(&gOsLock);
+	while (gOsState != osKernelRunning)
+		pthread_cond_wait(&gOsStarted, &gOsLock);
+	pthread_mutex_unlock(&gOsLock);
+}
+
+
+//*****************************************************************************
+// osKernelInitialize
+//*****************************************************************************
+osStatus_t osKernelInitialize(void) {
+
+osStatus_t status = osError;
+
+	pthread_mutex_lock(&gOsLock);
+	if (gOsState == osKernelInactive) {
+		gOsEpoch = osNow();
+		gOsState = osKernelReady;
+		status = osOK;
+	}
+	pthread_mutex_unlock(&gOsLock);
+	return status;
+}
+
+
+//*****************************************************************************
+// osKernelGetState
+//*****************************************************************************
+osKernelState_t osKernelGetState(void) {
+
+osKernelState_t state;
+
+	pthread_mutex_lock(&gOsLock);
+	state = gOsState;
+	pthread_mutex_unlock(&gOsLock);
+	return state;
+}
+
+
+//*****************************************************************************
+// osKernelStart
+//*****************************************************************************
+// Lets the threads and timers go. Like the target it doesn't return once the
+//  kernel is running: the calling thread ends and the process carries on
+//  until one of the threads exits it.
+//*****************************************************************************
+osStatus_t osKernelStart(void) {
+
+	pthread_mutex_lock(&gOsLock);
+	if (gOsState != osKernelReady) {
+		pthread_mutex_unlock(&gOsLock);
+		return osError;
+	}
+	gOsState = osKernelRunning;
+	pthread_cond_broadcast(&gOsStarted);
+	pthread_mutex_unlock(&gOsLock);
+	pthread_exit(NULL);
+}
+
+
+//*****************************************************************************
+// osKernelGetTickCount
+//*****************************************************************************
+uint32_t osKernelGetTickCount(void) {
+
+	return (uint32_t)((osNow() - gOsEpoch) / 1000000ULL);
+}
+
+
+//*****************************************************************************
+// osKernelGetTickFreq
+//*****************************************************************************
+uint32_t osKernelGetTickFreq(void) {
+
+	return 1000;
+}
+
+
+//*****************************************************************************
+// osThreadEntry
+//*****************************************************************************
+static void * osThreadEntry(void * arg) {
+
+OS_THREAD_STRUCTURE * pThread = (OS_THREAD_STRUCTURE *)arg;
+
+	osWaitStart();
+	pThread->func(pThread->argument);
+	return NULL;
+}
+
+
+//*****************************************************************************
+// osThreadNew
+//*****************************************************************************
+osThreadId_t osThreadNew(osThreadFunc_t func, void * argument, const osThreadAttr_t * attr) {
+
+OS_THREAD_STRUCTURE * pThread;
+
+	if (func == NULL)
+		return NULL;
+	if (attr != NULL)
+		pThread = osCbAlloc(attr->cb_mem, attr->cb_size, sizeof(OS_THREAD_STRUCTURE),
+				alignof(OS_THREAD_STRUCTURE));
+	else
+		pThread = osCbAlloc(NULL, 0, sizeof(OS_THREAD_STRUCTURE), alignof(OS_THREAD_STRUCTURE));
+	if (pThread == NULL)
+		return NULL;
+	pThread->func = func;
+	pThread->argument = argument;
+	if (pthread_create(&pThread->thread, NULL, osThreadEntry, pThread) != 0)
+		return NULL;
+	pthread_detach(pThread->thread);
+	return (osThreadId_t)pThread;
+}
+
+
+//*****************************************************************************
+// osDelay
+//*****************************************************************************
+osStatus_t osDelay(uint32_t ticks) {
+
+struct timespec ts;
+
+	if (ticks == 0) {
+		sched_yield();
+		return osOK;
+	}
+	ts = osTimespec(osNow() + ((uint64_t)ticks * 1000000ULL));
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+	return osOK;
+}
+
+
+//*****************************************************************************
+// osEventFlagsNew
+//*****************************************************************************
+osEventFlagsId_t osEventFlagsNew(const osEventFlagsAttr_t * attr) {
+
+OS_FLAGS_STRUCTURE * pFlags;
+
+	if (attr != NULL)
+		pFlags = osCbAlloc(attr->cb_mem, attr->cb_size, sizeof(OS_FLAGS_STRUCTURE),
+				alignof(OS_FLAGS_STRUCTURE));
+	else
+		pFlags = osCbAlloc(NULL, 0, sizeof(OS_FLAGS_STRUCTURE), alignof(OS_FLAGS_STRUCTURE));
+	if (pFlags == NULL)
+		return NULL;
+	pthread_mutex_init(&pFlags->lock, NULL);
+	osCondInit(&pFlags->cond);
+	pFlags->flags = 0;
+	return (osEventFlagsId_t)pFlags;
+}
+
+
+//*****************************************************************************
+// osEventFlagsSet
+//*****************************************************************************
+// Returns the flags after setting them. The top bit is reserved for the
+//  error codes, as on the target.
+//*****************************************************************************
+uint32_t osEventFlagsSet(osEventFlagsId_t ef_id, uint32_t flags) {
+
+OS_FLAGS_STRUCTURE * pFlags = (OS_FLAGS_STRUCTURE *)ef_id;
+uint32_t result;
+
+	if ((pFlags == NULL) || (flags & 0x80000000U))
+		return osFlagsErrorParameter;
+	pthread_mutex_lock(&pFlags->lock);
+	pFlags->flags |= flags;
+	result = pFlags->flags;
+	pthread_cond_broadcast(&pFlags->cond);
+	pthread_mutex_unlock(&pFlags->lock);
+	return result;
+}
+
+
+//*****************************************************************************
+// osEventFlagsWait
+//*****************************************************************************
+// Returns the flags as they were before the ones waited for were cleared,
+//  osFlagsErrorResource if they weren't set and the timeout is 0, or
+//  osFlagsErrorTimeout if they didn't get set in time.
+//*****************************************************************************
+uint32_t osEventFlagsWait(osEventFlagsId_t ef_id, uint32_t flags, uint32_t options, uint32_t timeout) {
+
+OS_FLAGS_STRUCTURE * pFlags = (OS_FLAGS_STRUCTURE *)ef_id;
+struct timespec ts;
+uint32_t result;
+bool ready;
+
+	if ((pFlags == NULL) || (flags & 0x80000000U))
+		return osFlagsErrorParameter;
+	if ((timeout != 0) && (timeout != osWaitForever))
+		ts = osTimespec(osNow() + ((uint64_t)timeout * 1000000ULL));
+	pthread_mutex_lock(&pFlags->lock);
+	while (1) {
+		if (options & osFlagsWaitAll)
+			ready = ((pFlags->flags & flags) == flags);
+		else
+			ready = ((pFlags->flags & flags) != 0);
+		if (ready) {
+			result = pFlags->flags;
+			if (!(options & osFlagsNoClear))
+				pFlags->flags &= ~flags;
+			break;
+		}
+		if (timeout == 0) {
+			result = osFlagsErrorResource;
+			break;
+		}
+		if (timeout == osWaitForever)
+			pthread_cond_wait(&pFlags->cond, &pFlags->lock);
+		else if (pthread_cond_timedwait(&pFlags->cond, &pFlags->lock, &ts) == ETIMEDOUT) {
+			result = osFlagsErrorTimeout;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&pFlags->lock);
+	return result;
+}
+
+
+//*****************************************************************************
+// osMutexNew
+//*****************************************************************************
+osMutexId_t osMutexNew(const osMutexAttr_t * attr) {
+
+OS_MUTEX_STRUCTURE * pMutex;
+pthread_mutexattr_t mattr;
+
+	if (attr != NULL)
+		pMutex = osCbAlloc(attr->cb_mem, attr->cb_size, sizeof(OS_MUTEX_STRUCTURE),
+				alignof(OS_MUTEX_STRUCTURE));
+	else
+		pMutex = osCbAlloc(NULL, 0, sizeof(OS_MUTEX_STRUCTURE), alignof(OS_MUTEX_STRUCTURE));
+	if (pMutex == NULL)
+		return NULL;
+	pthread_mutexattr_init(&mattr);
+	if ((attr != NULL) && (attr->attr_bits & osMutexRecursive))
+		pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE);
+	else
+		pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_ERRORCHECK);
+	if ((attr != NULL) && (attr->attr_bits & osMutexPrioInherit))
+		pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
+	pthread_mutex_init(&pMutex->mutex, &mattr);
+	pthread_mutexattr_destroy(&mattr);
+	return (osMutexId_t)pMutex;
+}
+
+
+//*****************************************************************************
+// osMutexAcquire
+//*****************************************************************************
+// pthread_mutex_timedlock() only takes the realtime clock, so the timeout
+//  here is measured on that.
+//*****************************************************************************
+osStatus_t osMutexAcquire(osMutexId_t mutex_id, uint32_t timeout) {
+
+OS_MUTEX_STRUCTURE * pMutex = (OS_MUTEX_STRUCTURE *)mutex_id;
+struct timespec ts;
+uint64_t ns;
+
+	if (pMutex == NULL)
+		return osErrorParameter;
+	if (timeout == osWaitForever)
+		return (pthread_mutex_lock(&pMutex->mutex) == 0) ? osOK : osErrorResource;
+	if (timeout == 0)
+		return (pthread_mutex_trylock(&pMutex->mutex) == 0) ? osOK : osErrorResource;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ns = ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+	ts = osTimespec(ns + ((uint64_t)timeout * 1000000ULL));
+	switch (pthread_mutex_timedlock(&pMutex->mutex, &ts)) {
+		case 0:
+			return osOK;
+		case ETIMEDOUT:
+			return osErrorTimeout;
+		default:
+			return osErrorResource;
+	}
+}
+
+
+//*****************************************************************************
+// osMutexRelease
+//*****************************************************************************
+// Fails with osErrorResource if the calling thread doesn't own the mutex.
+//*****************************************************************************
+osStatus_t osMutexRelease(osMutexId_t mutex_id) {
+
+OS_MUTEX_STRUCTURE * pMutex = (OS_MUTEX_STRUCTURE *)mutex_id;
+
+	if (pMutex == NULL)
+		return osErrorParameter;
+	return (pthread_mutex_unlock(&pMutex->mutex) == 0) ? osOK : osErrorResource;
+}
+
+
+//*****************************************************************************
+// osTimerThread
+//*****************************************************************************
+// Each timer gets a thread to run its callback in. Periodic timers stay on
+//  their original schedule, so a late callback doesn't push the rest back.
+//*****************************************************************************
+static void * osTimerThread(void * arg) {
+
+OS_TIMER_STRUCTURE * pTimer = (OS_TIMER_STRUCTURE *)arg;
+struct timespec ts;
+
+	osWaitStart();
+	pthread_mutex_lock(&pTimer->lock);
+	if (pTimer->running)
+		pTimer->due = osNow() + ((uint64_t)pTimer->period * 1000000ULL);
+	while (1) {
+		if (!pTimer->running) {
+			pthread_cond_wait(&pTimer->cond, &pTimer->lock);
+			continue;
+		}
+		if (osNow() < pTimer->due) {
+			ts = osTimespec(pTimer->due);
+			pthread_cond_timedwait(&pTimer->cond, &pTimer->lock, &ts);
+			continue;
+		}
+		if (pTimer->type == osTimerPeriodic)
+			pTimer->due += (uint64_t)pTimer->period * 1000000ULL;
+		else
+			pTimer->running = false;
+		pthread_mutex_unlock(&pTimer->lock);
+		pTimer->func(pTimer->argument);
+		pthread_mutex_lock(&pTimer->lock);
+	}
+	return NULL;
+}
+
+
+//*****************************************************************************
+// osTimerNew
+//*****************************************************************************
+osTimerId_t osTimerNew(osTimerFunc_t func, osTimerType_t type, void * argument, const osTimerAttr_t * attr) {
+
+OS_TIMER_STRUCTURE * pTimer;
+
+	if (func == NULL)
+		return NULL;
+	if (attr != NULL)
+		pTimer = osCbAlloc(attr->cb_mem, attr->cb_size, sizeof(OS_TIMER_STRUCTURE),
+				alignof(OS_TIMER_STRUCTURE));
+	else
+		pTimer = osCbAlloc(NULL, 0, sizeof(OS_TIMER_STRUCTURE), alignof(OS_TIMER_STRUCTURE));
+	if (pTimer == NULL)
+		return NULL;
+	pthread_mutex_init(&pTimer->lock, NULL);
+	osCondInit(&pTimer->cond);
+	pTimer->func = func;
+	pTimer->argument = argument;
+	pTimer->type = type;
+	pTimer->running = false;
+	if (pthread_create(&pTimer->thread, NULL, osTimerThread, pTimer) != 0)
+		return NULL;
+	pthread_detach(pTimer->thread);
+	return (osTimerId_t)pTimer;
+}
+
+
+//*****************************************************************************
+// osTimerStart
+//*****************************************************************************
+// Starts the timer, or restarts it if it's running. Timers started before
+//  the kernel first fire a period after osKernelStart().
+//*****************************************************************************
+osStatus_t osTimerStart(osTimerId_t timer_id, uint32_t ticks) {
+
+OS_TIMER_STRUCTURE * pTimer = (OS_TIMER_STRUCTURE *)timer_id;
+
+	if ((pTimer == NULL) || (ticks == 0))
+		return osErrorParameter;
+	pthread_mutex_lock(&pTimer->lock);
+	pTimer->period = ticks;
+	pTimer->due = osNow() + ((uint64_t)ticks * 1000000ULL);
+	pTimer->running = true;
+	pthread_cond_broadcast(&pTimer->cond);
+	pthread_mutex_unlock(&pTimer->lock);
+	return osOK;
+}
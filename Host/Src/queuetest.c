@@ -0,0 +1,199 @@
+// ****************************************************************************
+//     Filename: QUEUETEST.C
+// Date Created: 10/19/2026
+//
+//     Comments: Host stress test for the voice command queue
+//
+// Build Environment: CMake, host gcc or clang
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+#include "player.h"
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+
+// ****************************************************************************
+// The producer thread plays the main loop and the consumer thread plays the
+//  audio interrupt. Each command carries a 26-bit sequence number spread
+//  over its fields, so the consumer can check that every one arrives once
+//  and in order, through many trips around the ring. Both sides yield while
+//  they wait, so the test still moves along on a single core.
+
+#define QT_NUM_CMDS				2000000
+#define QT_MAX_GROUP			8			// Most commands per publish
+#define QT_HOLD_EVERY			65536		// Consumer stalls this often
+#define QT_HOLD_US				2000		//  for this long, so the queue fills
+
+uint32_t qtProduced = 0;
+uint32_t qtConsumed = 0;
+uint32_t qtFullWaits = 0;					// Times the producer found it full
+uint32_t qtErrors = 0;
+
+
+//*****************************************************************************
+// qtPut
+//*****************************************************************************
+static void qtPut(uint32_t n) {
+
+	voiceQueuePut(n & 0x03, (n >> 2) & 0xff, (n >> 10) & 0xffff);
+}
+
+
+//*****************************************************************************
+// qtSeq
+//*****************************************************************************
+static uint32_t qtSeq(VOICE_CMD_STRUCTURE * pCmd) {
+
+	return pCmd->cmd | ((uint32_t)pCmd->voice << 2) | ((uint32_t)pCmd->ms << 10);
+}
+
+
+//*****************************************************************************
+// qtSingle
+//*****************************************************************************
+// Single threaded checks of the edge cases. Every group size from one up to
+//  a full queue goes around the ring a few times, so each size is put and
+//  taken across the wrap.
+//*****************************************************************************
+static void qtSingle(void) {
+
+VOICE_CMD_STRUCTURE cmd;
+uint32_t n = 0;
+uint32_t next = 0;
+uint32_t size;
+uint32_t round;
+uint32_t i;
+
+	voiceQueueInit();
+	for (size = 1; size < VOICE_QUEUE_SIZE; size++) {
+		for (round = 0; round < 3; round++) {
+			for (i = 0; i < size; i++)
+				qtPut(n++);
+			if (voiceQueueFree() != (VOICE_QUEUE_SIZE - 1 - size)) {
+				printf("queuetest: free is %u with %u queued\n", voiceQueueFree(), size);
+				qtErrors++;
+			}
+
+			// Nothing is visible to the consumer until it's published
+			if (voiceQueueGet(&cmd)) {
+				printf("queuetest: got a command before it was published\n");
+				qtErrors++;
+			}
+			voiceQueuePublish();
+			while (voiceQueueGet(&cmd)) {
+				if (qtSeq(&cmd) != next) {
+					printf("queuetest: got %u, expected %u\n", qtSeq(&cmd), next);
+					qtErrors++;
+				}
+				next++;
+			}
+			if (next != n) {
+				printf("queuetest: took %u of %u\n", next, n);
+				qtErrors++;
+				next = n;
+			}
+		}
+	}
+}
+
+
+//*****************************************************************************
+// qtProducer
+//*****************************************************************************
+static void * qtProducer(void * arg) {
+
+uint32_t group;
+uint32_t seed = 1;
+
+	(void)arg;
+	while (qtProduced < QT_NUM_CMDS) {
+		seed = (seed * 1103515245) + 12345;
+		group = 1 + ((seed >> 16) % QT_MAX_GROUP);
+		if (group > (QT_NUM_CMDS - qtProduced))
+			group = QT_NUM_CMDS - qtProduced;
+		while (group--) {
+			if (voiceQueueFree() == 0) {
+				qtFullWaits++;
+				while (voiceQueueFree() == 0)
+					sched_yield();
+			}
+			qtPut(qtProduced++);
+		}
+		voiceQueuePublish();
+	}
+	return NULL;
+}
+
+
+//*****************************************************************************
+// qtConsumer
+//*****************************************************************************
+static void * qtConsumer(void * arg) {
+
+VOICE_CMD_STRUCTURE cmd;
+
+	(void)arg;
+	while (qtConsumed < QT_NUM_CMDS) {
+		if (!voiceQueueGet(&cmd)) {
+			sched_yield();
+			continue;
+		}
+		if (qtSeq(&cmd) != (qtConsumed & 0x3ffffff)) {
+			if (qtErrors++ < 10)
+				printf("queuetest: got %u, expected %u\n", qtSeq(&cmd), qtConsumed);
+			qtConsumed = qtSeq(&cmd);
+		}
+		if ((++qtConsumed % QT_HOLD_EVERY) == 0)
+			usleep(QT_HOLD_US);
+	}
+	return NULL;
+}
+
+
+//*****************************************************************************
+// main
+//*****************************************************************************
+int main(void) {
+
+pthread_t producer;
+pthread_t consumer;
+VOICE_CMD_STRUCTURE cmd;
+
+	qtSingle();
+
+	voiceQueueInit();
+	pthread_create(&consumer, NULL, qtConsumer, NULL);
+	pthread_create(&producer, NULL, qtProducer, NULL);
+	pthread_join(producer, NULL);
+	pthread_join(consumer, NULL);
+	if (voiceQueueGet(&cmd)) {
+		printf("queuetest: commands left over after the last one\n");
+		qtErrors++;
+	}
+	if (qtFullWaits == 0) {
+		printf("queuetest: the queue never filled\n");
+		qtErrors++;
+	}
+
+	printf("queuetest: %u commands, queue full %u times, %u errors\n",
+			qtConsumed, qtFullWaits, qtErrors);
+	return (qtErrors == 0) ? 0 : 1;
+}
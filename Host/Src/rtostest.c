@@ -0,0 +1,352 @@
+// ****************************************************************************
+//     Filename: RTOSTEST.C
+// Date Created: 10/19/2026
+//
+//     Comments: Host test of the RTOS port's threads and kernel objects
+//
+// Build Environment: CMake, host gcc or clang
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+#include "player.h"
+#include "cmsis_os2.h"
+#include <stdlib.h>
+#include <sched.h>
+
+
+// ****************************************************************************
+// Sets up the same threads, flags, recursive disk lock and tick timer as
+//  rtos.c, on the POSIX backend. The SD I/O and decode threads stand in for
+//  voicesRefill() and voicesDecode(), taking the disk lock the way FatFs
+//  and the decoder do, and the control thread drives them and checks the
+//  kernel calls the port counts on. It exits the process with the result.
+
+#define RT_FLAG_DONE			0x0100		// Decode thread finished a pass
+#define RT_FLAG_HELD			0x0200		// SD I/O thread has the disk lock
+#define RT_FLAG_LET_GO			0x0400		//  and can let go of it
+#define RT_FLAG_A				0x1000		// Spare flags for the wait checks
+#define RT_FLAG_B				0x2000
+
+#define RT_ROUNDS				1000
+
+static uint64_t rtSdioStack[RTOS_SDIO_STACK / 8];
+static uint64_t rtDecodeStack[RTOS_DECODE_STACK / 8];
+static uint64_t rtControlStack[RTOS_CONTROL_STACK / 8];
+
+static uint32_t rtSdioCb[RTOS_THREAD_CB_SIZE / 4];
+static uint32_t rtDecodeCb[RTOS_THREAD_CB_SIZE / 4];
+static uint32_t rtControlCb[RTOS_THREAD_CB_SIZE / 4];
+static uint32_t rtFlagsCb[RTOS_OBJECT_CB_SIZE / 4];
+static uint32_t rtDiskCb[RTOS_OBJECT_CB_SIZE / 4];
+static uint32_t rtTickCb[RTOS_OBJECT_CB_SIZE / 4];
+
+static const osThreadAttr_t rtSdioAttr = {
+	.name = "sdio",
+	.cb_mem = rtSdioCb,
+	.cb_size = sizeof(rtSdioCb),
+	.stack_mem = rtSdioStack,
+	.stack_size = sizeof(rtSdioStack),
+	.priority = osPriorityRealtime
+};
+
+static const osThreadAttr_t rtDecodeAttr = {
+	.name = "decode",
+	.cb_mem = rtDecodeCb,
+	.cb_size = sizeof(rtDecodeCb),
+	.stack_mem = rtDecodeStack,
+	.stack_size = sizeof(rtDecodeStack),
+	.priority = osPriorityHigh
+};
+
+static const osThreadAttr_t rtControlAttr = {
+	.name = "control",
+	.cb_mem = rtControlCb,
+	.cb_size = sizeof(rtControlCb),
+	.stack_mem = rtControlStack,
+	.stack_size = sizeof(rtControlStack),
+	.priority = osPriorityNormal
+};
+
+static const osEventFlagsAttr_t rtFlagsAttr = {
+	.name = "flags",
+	.cb_mem = rtFlagsCb,
+	.cb_size = sizeof(rtFlagsCb)
+};
+
+static const osMutexAttr_t rtDiskAttr = {
+	.name = "disk",
+	.attr_bits = osMutexRecursive | osMutexPrioInherit,
+	.cb_mem = rtDiskCb,
+	.cb_size = sizeof(rtDiskCb)
+};
+
+static const osTimerAttr_t rtTickAttr = {
+	.name = "tick",
+	.cb_mem = rtTickCb,
+	.cb_size = sizeof(rtTickCb)
+};
+
+osEventFlagsId_t rtFlags = NULL;
+osMutexId_t rtDisk = NULL;
+
+volatile bool rtHold = false;				// SD I/O thread holds the lock till told
+uint32_t rtEarly = 0;						// Threads or ticks seen before the start
+uint32_t rtInDisk = 0;						// Threads inside the disk lock
+uint32_t rtRefills = 0;
+uint32_t rtDecodes = 0;
+uint32_t rtTicks = 0;
+uint32_t rtErrors = 0;
+
+
+//*****************************************************************************
+// rtCheck
+//*****************************************************************************
+static void rtCheck(bool ok, const char * pMsg) {
+
+	if (!ok) {
+		printf("FAIL: %s\n", pMsg);
+		__atomic_add_fetch(&rtErrors, 1, __ATOMIC_SEQ_CST);
+	}
+}
+
+
+//*****************************************************************************
+// rtStarted
+//*****************************************************************************
+// Counts anything that runs before osKernelStart().
+//*****************************************************************************
+static void rtStarted(void) {
+
+	if (osKernelGetState() != osKernelRunning)
+		__atomic_add_fetch(&rtEarly, 1, __ATOMIC_SEQ_CST);
+}
+
+
+//*****************************************************************************
+// rtDiskEnter
+//*****************************************************************************
+static void rtDiskEnter(void) {
+
+	rtCheck(__atomic_fetch_add(&rtInDisk, 1, __ATOMIC_SEQ_CST) == 0, "two threads in the disk lock");
+}
+
+
+//*****************************************************************************
+// rtDiskLeave
+//*****************************************************************************
+static void rtDiskLeave(void) {
+
+	__atomic_sub_fetch(&rtInDisk, 1, __ATOMIC_SEQ_CST);
+}
+
+
+//*****************************************************************************
+// rtSdioThread
+//*****************************************************************************
+// Takes the disk lock twice over, the way f_read() under voicesRefill() does
+//  when the card driver locks it again.
+//*****************************************************************************
+static void rtSdioThread(void * argument) {
+
+	rtStarted();
+	while (1) {
+		osEventFlagsWait(rtFlags, RTOS_FLAG_SDIO, osFlagsWaitAny, osWaitForever);
+		rtCheck(osMutexAcquire(rtDisk, osWaitForever) == osOK, "sdio lock");
+		rtDiskEnter();
+		rtCheck(osMutexAcquire(rtDisk, osWaitForever) == osOK, "sdio lock again");
+		sched_yield();
+		rtCheck(osMutexRelease(rtDisk) == osOK, "sdio unlock inner");
+		if (rtHold) {
+			osEventFlagsSet(rtFlags, RT_FLAG_HELD);
+			osEventFlagsWait(rtFlags, RT_FLAG_LET_GO, osFlagsWaitAny, osWaitForever);
+		}
+		rtDiskLeave();
+		rtCheck(osMutexRelease(rtDisk) == osOK, "sdio unlock");
+		rtRefills++;
+		osEventFlagsSet(rtFlags, RTOS_FLAG_DECODE);
+	}
+}
+
+
+//*****************************************************************************
+// rtDecodeThread
+//*****************************************************************************
+static void rtDecodeThread(void * argument) {
+
+	rtStarted();
+	while (1) {
+		osEventFlagsWait(rtFlags, RTOS_FLAG_DECODE, osFlagsWaitAny, osWaitForever);
+		rtCheck(osMutexAcquire(rtDisk, osWaitForever) == osOK, "decode lock");
+		rtDiskEnter();
+		sched_yield();
+		rtDiskLeave();
+		rtCheck(osMutexRelease(rtDisk) == osOK, "decode unlock");
+		rtDecodes++;
+		osEventFlagsSet(rtFlags, RT_FLAG_DONE);
+	}
+}
+
+
+//*****************************************************************************
+// rtTick
+//*****************************************************************************
+static void rtTick(void * argument) {
+
+	rtStarted();
+	__atomic_add_fetch(&rtTicks, 1, __ATOMIC_SEQ_CST);
+}
+
+
+//*****************************************************************************
+// rtFlagChecks
+//*****************************************************************************
+// The wait options and timeouts, on flags no thread is waiting for.
+//*****************************************************************************
+static void rtFlagChecks(void) {
+
+uint32_t start;
+uint32_t result;
+
+	start = osKernelGetTickCount();
+	result = osEventFlagsWait(rtFlags, RT_FLAG_A, osFlagsWaitAny, 20);
+	rtCheck(result == osFlagsErrorTimeout, "wait timeout");
+	rtCheck((osKernelGetTickCount() - start) >= 20, "wait timeout too short");
+	result = osEventFlagsWait(rtFlags, RT_FLAG_A, osFlagsWaitAny, 0);
+	rtCheck(result == osFlagsErrorResource, "wait with no timeout");
+
+	osEventFlagsSet(rtFlags, RT_FLAG_A);
+	result = osEventFlagsWait(rtFlags, RT_FLAG_A | RT_FLAG_B, osFlagsWaitAll, 0);
+	rtCheck(result == osFlagsErrorResource, "wait all with one set");
+	result = osEventFlagsWait(rtFlags, RT_FLAG_A | RT_FLAG_B, osFlagsWaitAny, 0);
+	rtCheck((result & (RT_FLAG_A | RT_FLAG_B)) == RT_FLAG_A, "wait any with one set");
+	osEventFlagsSet(rtFlags, RT_FLAG_A | RT_FLAG_B);
+	result = osEventFlagsWait(rtFlags, RT_FLAG_A | RT_FLAG_B, osFlagsWaitAll, 0);
+	rtCheck((result & (RT_FLAG_A | RT_FLAG_B)) == (RT_FLAG_A | RT_FLAG_B), "wait all with both set");
+	result = osEventFlagsWait(rtFlags, RT_FLAG_A | RT_FLAG_B, osFlagsWaitAny, 0);
+	rtCheck(result == osFlagsErrorResource, "flags cleared by the wait");
+
+	osEventFlagsSet(rtFlags, RT_FLAG_B);
+	result = osEventFlagsWait(rtFlags, RT_FLAG_B, osFlagsWaitAny | osFlagsNoClear, 0);
+	rtCheck(result & RT_FLAG_B, "wait without clearing");
+	result = osEventFlagsWait(rtFlags, RT_FLAG_B, osFlagsWaitAny, 0);
+	rtCheck(result & RT_FLAG_B, "flag left set");
+	rtCheck(osEventFlagsSet(rtFlags, 0x80000000U) == osFlagsErrorParameter, "reserved flag");
+}
+
+
+//*****************************************************************************
+// rtLockChecks
+//*****************************************************************************
+// Has the SD I/O thread sit on the disk lock while this one tries for it.
+//*****************************************************************************
+static void rtLockChecks(void) {
+
+uint32_t result;
+
+	rtHold = true;
+	osEventFlagsSet(rtFlags, RTOS_FLAG_SDIO);
+	result = osEventFlagsWait(rtFlags, RT_FLAG_HELD, osFlagsWaitAny, 1000);
+	rtCheck(!(result & 0x80000000U), "sdio thread didn't take the lock");
+	rtCheck(osMutexAcquire(rtDisk, 0) == osErrorResource, "try lock while held");
+	rtCheck(osMutexAcquire(rtDisk, 10) == osErrorTimeout, "lock timeout while held");
+	rtCheck(osMutexRelease(rtDisk) == osErrorResource, "unlock by another thread");
+	rtHold = false;
+	osEventFlagsSet(rtFlags, RT_FLAG_LET_GO);
+	rtCheck(osMutexAcquire(rtDisk, osWaitForever) == osOK, "lock once let go");
+	rtCheck(osMutexRelease(rtDisk) == osOK, "unlock");
+	result = osEventFlagsWait(rtFlags, RT_FLAG_DONE, osFlagsWaitAny, 1000);
+	rtCheck(!(result & 0x80000000U), "decode after the held lock");
+}
+
+
+//*****************************************************************************
+// rtControlThread
+//*****************************************************************************
+static void rtControlThread(void * argument) {
+
+uint32_t start;
+uint32_t ticks;
+uint32_t result;
+uint32_t n;
+
+	rtStarted();
+	rtCheck(osKernelGetTickFreq() == 1000, "tick frequency");
+	rtFlagChecks();
+	rtLockChecks();
+
+	// Every signal to the SD I/O thread ends in a decode pass
+
+	for (n = 0; n < RT_ROUNDS; n++) {
+		osEventFlagsSet(rtFlags, RTOS_FLAG_SDIO);
+		result = osEventFlagsWait(rtFlags, RT_FLAG_DONE, osFlagsWaitAny, 1000);
+		if (result & 0x80000000U) {
+			rtCheck(false, "round timed out");
+			break;
+		}
+	}
+	rtCheck(rtRefills == RT_ROUNDS + 1, "refill count");
+	rtCheck(rtDecodes == RT_ROUNDS + 1, "decode count");
+
+	// The tick timer keeps up with the tick count, give or take the
+	//  scheduling on a busy host
+
+	start = osKernelGetTickCount();
+	ticks = __atomic_load_n(&rtTicks, __ATOMIC_SEQ_CST);
+	osDelay(100);
+	rtCheck((osKernelGetTickCount() - start) >= 100, "delay too short");
+	ticks = __atomic_load_n(&rtTicks, __ATOMIC_SEQ_CST) - ticks;
+	rtCheck((ticks >= 50) && (ticks <= 110), "tick timer rate");
+	rtCheck(rtEarly == 0, "ran before the kernel started");
+
+	printf("rtostest: %u rounds, %u ticks in 100ms, %u errors\n",
+		(unsigned)rtDecodes, (unsigned)ticks, (unsigned)rtErrors);
+	exit((rtErrors == 0) ? 0 : 1);
+}
+
+
+//*****************************************************************************
+// main
+//*****************************************************************************
+int main(void) {
+
+osTimerId_t tick;
+
+	setvbuf(stdout, NULL, _IONBF, 0);
+	rtCheck(osKernelGetState() == osKernelInactive, "state before init");
+	rtCheck(osKernelInitialize() == osOK, "init");
+	rtCheck(osKernelGetState() == osKernelReady, "state after init");
+	rtFlags = osEventFlagsNew(&rtFlagsAttr);
+	rtDisk = osMutexNew(&rtDiskAttr);
+	rtCheck((rtFlags != NULL) && (rtDisk != NULL), "kernel objects");
+	rtCheck(osThreadNew(rtSdioThread, NULL, &rtSdioAttr) != NULL, "sdio thread");
+	rtCheck(osThreadNew(rtDecodeThread, NULL, &rtDecodeAttr) != NULL, "decode thread");
+	rtCheck(osThreadNew(rtControlThread, NULL, &rtControlAttr) != NULL, "control thread");
+	tick = osTimerNew(rtTick, osTimerPeriodic, NULL, &rtTickAttr);
+	rtCheck(tick != NULL, "tick timer");
+	rtCheck(osTimerStart(tick, (osKernelGetTickFreq() + 999) / 1000) == osOK, "tick start");
+
+	// Nothing runs until the kernel is started
+
+	osDelay(50);
+	rtCheck(rtEarly == 0, "ran before the kernel started");
+	rtCheck(rtTicks == 0, "ticked before the kernel started");
+	osKernelStart();
+	printf("FAIL: osKernelStart returned\n");
+	return 1;
+}
@@ -0,0 +1,260 @@
+// ****************************************************************************
+//     Filename: TELEMDEC.C
+// Date Created: 10/19/2026
+//
+//     Comments: Host telemetry and protocol frame decoder
+//
+// Build Environment: CMake, host gcc or clang
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+#include "player.h"
+#include "telemdec.h"
+
+
+// ****************************************************************************
+// Global variables
+
+#define DEC_STATE_IDLE			0
+#define DEC_STATE_LEN			1
+#define DEC_STATE_SEQ			2
+#define DEC_STATE_DATA			3
+#define DEC_STATE_CRC_HI		4
+#define DEC_STATE_CRC_LO		5
+
+uint8_t gDecState = DEC_STATE_IDLE;
+uint16_t gDecCount = 0;
+uint16_t gDecCrc = 0;
+uint8_t gDecCrcHi = 0;
+
+uint32_t gDecFrames = 0;					// Good frames
+uint32_t gDecCrcErrors = 0;					// Frames thrown away for their CRC
+uint32_t gDecLost = 0;						// Telemetry frames missing from the sequence
+uint8_t gDecLastSeq = 0;
+bool gDecSeqValid = false;
+
+const char * decStateNames[] = {
+	[VOICE_STATE_AVAIL] = "avail",
+	[VOICE_STATE_PLAYING] = "playing",
+	[VOICE_STATE_PAUSED] = "paused",
+	[VOICE_STATE_STOPPED] = "stopped",
+	[VOICE_STATE_READY] = "ready"
+};
+
+#define DEC_NUM_STATES			(sizeof(decStateNames) / sizeof(decStateNames[0]))
+
+
+//*****************************************************************************
+// telemDecInit
+//*****************************************************************************
+void telemDecInit(void) {
+
+	gDecState = DEC_STATE_IDLE;
+	gDecFrames = 0;
+	gDecCrcErrors = 0;
+	gDecLost = 0;
+	gDecSeqValid = false;
+}
+
+
+//*****************************************************************************
+// telemDecCrc16
+//*****************************************************************************
+// CRC-16/CCITT, the same as protoCrc16() in the firmware, worked a bit at a
+//  time.
+//*****************************************************************************
+uint16_t telemDecCrc16(uint16_t crc, const uint8_t * pData, uint16_t len) {
+
+uint8_t i;
+
+	while (len--) {
+		crc ^= (uint16_t)(*pData++) << 8;
+		for (i = 0; i < 8; i++)
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+	}
+	return crc;
+}
+
+
+//*****************************************************************************
+// telemDecByte
+//*****************************************************************************
+// Feeds the decoder the next received byte. Returns true when it completes
+//  a frame with a good CRC, which is then in pFrame. Bytes outside frames,
+//  ie. console replies, are passed over. Telemetry frames count up by one,
+//  so any missing from the sequence are counted as lost.
+//*****************************************************************************
+bool telemDecByte(uint8_t c, TELEMDEC_FRAME_STRUCTURE * pFrame) {
+
+	switch (gDecState) {
+
+		case DEC_STATE_IDLE:
+			if (c == PROTO_SOF)
+				gDecState = DEC_STATE_LEN;
+		break;
+
+		case DEC_STATE_LEN:
+			pFrame->len = c;
+			gDecCrc = telemDecCrc16(0xffff, &c, 1);
+			gDecState = DEC_STATE_SEQ;
+		break;
+
+		case DEC_STATE_SEQ:
+			pFrame->seq = c;
+			gDecCrc = telemDecCrc16(gDecCrc, &c, 1);
+			gDecCount = 0;
+			gDecState = (pFrame->len > 0) ? DEC_STATE_DATA : DEC_STATE_CRC_HI;
+		break;
+
+		case DEC_STATE_DATA:
+			pFrame->payload[gDecCount++] = c;
+			gDecCrc = telemDecCrc16(gDecCrc, &c, 1);
+			if (gDecCount >= pFrame->len)
+				gDecState = DEC_STATE_CRC_HI;
+		break;
+
+		case DEC_STATE_CRC_HI:
+			gDecCrcHi = c;
+			gDecState = DEC_STATE_CRC_LO;
+		break;
+
+		default:
+			gDecState = DEC_STATE_IDLE;
+			if ((((uint16_t)gDecCrcHi << 8) | c) != gDecCrc) {
+				gDecCrcErrors++;
+				return false;
+			}
+			gDecFrames++;
+			if ((pFrame->len > 0) && (pFrame->payload[0] == PROTO_RSP_TELEM)) {
+				if (gDecSeqValid)
+					gDecLost += (uint8_t)(pFrame->seq - gDecLastSeq - 1);
+				gDecLastSeq = pFrame->seq;
+				gDecSeqValid = true;
+			}
+			return true;
+	}
+	return false;
+}
+
+
+//*****************************************************************************
+// telemDecGet16 / telemDecGet32
+//*****************************************************************************
+static uint16_t telemDecGet16(const uint8_t * p) {
+
+	return p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t telemDecGet32(const uint8_t * p) {
+
+	return telemDecGet16(p) | ((uint32_t)telemDecGet16(&p[2]) << 16);
+}
+
+
+//*****************************************************************************
+// telemDecStatus
+//*****************************************************************************
+// Unpacks a telemetry frame. Returns false if the frame isn't one, or its
+//  length doesn't match its voice count.
+//*****************************************************************************
+bool telemDecStatus(const TELEMDEC_FRAME_STRUCTURE * pFrame, TELEMDEC_STATUS_STRUCTURE * pStatus) {
+
+const uint8_t * p = pFrame->payload;
+TELEM_VOICE_STRUCTURE * pVoice;
+uint8_t v;
+
+	if ((pFrame->len < TELEM_HEADER_BYTES) || (p[0] != PROTO_RSP_TELEM))
+		return false;
+	if ((p[2] > MAX_NUM_MP3_VOICES) ||
+			(pFrame->len != (TELEM_HEADER_BYTES + (p[2] * TELEM_VOICE_BYTES))))
+		return false;
+
+	pStatus->seq = pFrame->seq;
+	pStatus->cpuLoad = p[1];
+	pStatus->numVoices = p[2];
+	pStatus->msTicks = telemDecGet32(&p[4]);
+	pStatus->underruns = telemDecGet32(&p[8]);
+	pStatus->sdLastUs = telemDecGet16(&p[12]);
+	pStatus->sdPeakUs = telemDecGet16(&p[14]);
+	p += TELEM_HEADER_BYTES;
+	for (v = 0; v < pStatus->numVoices; v++) {
+		pVoice = &pStatus->voice[v];
+		pVoice->state = p[0];
+		pVoice->gainIdx = p[1];
+		pVoice->track = telemDecGet16(&p[2]);
+		pVoice->framesPlayed = telemDecGet32(&p[4]);
+		pVoice->mp3Bytes = telemDecGet16(&p[8]);
+		pVoice->wavSamples = telemDecGet16(&p[10]);
+		p += TELEM_VOICE_BYTES;
+	}
+
+	return true;
+}
+
+
+//*****************************************************************************
+// telemDecPrint
+//*****************************************************************************
+// Prints a frame as a line of text, plus a line per voice for telemetry.
+//*****************************************************************************
+void telemDecPrint(FILE * fp, const TELEMDEC_FRAME_STRUCTURE * pFrame) {
+
+TELEMDEC_STATUS_STRUCTURE status;
+TELEM_VOICE_STRUCTURE * pVoice;
+uint8_t v;
+
+	if ((pFrame->len == 2) && (pFrame->payload[0] == PROTO_RSP_ACK)) {
+		fprintf(fp, "ack %u status %u\n", pFrame->seq, pFrame->payload[1]);
+		return;
+	}
+	if (!telemDecStatus(pFrame, &status)) {
+		fprintf(fp, "frame %u, %u bytes, type 0x%02x\n", pFrame->seq, pFrame->len,
+				(pFrame->len > 0) ? pFrame->payload[0] : 0);
+		return;
+	}
+	fprintf(fp, "telem %u at %u ms: cpu %u%%, underruns %u, sd read %u us (peak %u us)\n",
+			status.seq, status.msTicks, status.cpuLoad, status.underruns,
+			status.sdLastUs, status.sdPeakUs);
+	for (v = 0; v < status.numVoices; v++) {
+		pVoice = &status.voice[v];
+		fprintf(fp, "  voice %u: %-7s track %4u, gain %3u, frames %u, mp3 %u bytes, wav %u samples\n",
+				v, (pVoice->state < DEC_NUM_STATES) ? decStateNames[pVoice->state] : "?",
+				pVoice->track, pVoice->gainIdx, pVoice->framesPlayed,
+				pVoice->mp3Bytes, pVoice->wavSamples);
+	}
+}
+
+
+//*****************************************************************************
+// telemDecGetFrames / telemDecGetCrcErrors / telemDecGetLost
+//*****************************************************************************
+uint32_t telemDecGetFrames(void) {
+
+	return gDecFrames;
+}
+
+uint32_t telemDecGetCrcErrors(void) {
+
+	return gDecCrcErrors;
+}
+
+uint32_t telemDecGetLost(void) {
+
+	return gDecLost;
+}
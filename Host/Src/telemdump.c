@@ -0,0 +1,72 @@
+// ****************************************************************************
+//     Filename: TELEMDUMP.C
+// Date Created: 10/19/2026
+//
+//     Comments: Host tool that prints the player's telemetry frames
+//
+// Build Environment: CMake, host gcc or clang
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+#include "player.h"
+#include "telemdec.h"
+
+
+// ****************************************************************************
+// Reads the player's serial output from a file, a serial port already set
+//  up with stty, or stdin, and prints each frame in it as text:
+//
+//    stty -F /dev/ttyUSB0 57600 raw
+//    telemdump /dev/ttyUSB0
+//
+//  Subscribe with "tel <ms>" on the console, or PROTO_CMD_TELEM. A summary
+//  goes to stderr at the end of the input.
+
+
+//*****************************************************************************
+// main
+//*****************************************************************************
+int main(int argc, char * argv[]) {
+
+FILE * fp = stdin;
+TELEMDEC_FRAME_STRUCTURE frame;
+int c;
+
+	if (argc > 2) {
+		fprintf(stderr, "usage: telemdump [file]\n");
+		return 2;
+	}
+	if ((argc == 2) && ((fp = fopen(argv[1], "rb")) == NULL)) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	telemDecInit();
+	while ((c = fgetc(fp)) != EOF) {
+		if (telemDecByte((uint8_t)c, &frame)) {
+			telemDecPrint(stdout, &frame);
+			fflush(stdout);
+		}
+	}
+	fprintf(stderr, "%u frames, %u bad CRC, %u telemetry frames lost\n",
+			telemDecGetFrames(), telemDecGetCrcErrors(), telemDecGetLost());
+	if (fp != stdin)
+		fclose(fp);
+	return 0;
+}
@@ -0,0 +1,183 @@
+// ****************************************************************************
+//     Filename: TELEMTEST.C
+// Date Created: 10/19/2026
+//
+//     Comments: Host test for the telemetry frame decoder
+//
+// Build Environment: CMake, host gcc or clang
+//
+// COPYRIGHT (c) 2026, Robertsonics
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+
+#include "player.h"
+#include "telemdec.h"
+
+
+// ****************************************************************************
+// Packs frames the way telem.c and proto.c do, mixes them in with console
+//  text, a frame with a bad CRC and a gap in the sequence, and checks what
+//  the decoder makes of it.
+
+uint8_t ttStream[1024];
+uint16_t ttLen = 0;
+uint32_t ttErrors = 0;
+
+#define TT_CHECK(cond)	do { if (!(cond)) { printf("telemtest: line %d: %s\n", __LINE__, #cond); ttErrors++; } } while (0)
+
+
+//*****************************************************************************
+// ttBytes
+//*****************************************************************************
+static void ttBytes(const void * p, uint16_t len) {
+
+	memcpy(&ttStream[ttLen], p, len);
+	ttLen += len;
+}
+
+
+//*****************************************************************************
+// ttFrame
+//*****************************************************************************
+// Adds a frame to the stream, as protoSendFrame() sends it.
+//*****************************************************************************
+static void ttFrame(uint8_t seq, const uint8_t * pPayload, uint8_t len, bool badCrc) {
+
+uint8_t header[3];
+uint8_t trailer[2];
+uint16_t crc;
+
+	header[0] = PROTO_SOF;
+	header[1] = len;
+	header[2] = seq;
+	crc = telemDecCrc16(0xffff, &header[1], 2);
+	crc = telemDecCrc16(crc, pPayload, len);
+	if (badCrc)
+		crc ^= 0x0100;
+	trailer[0] = crc >> 8;
+	trailer[1] = crc & 0xff;
+	ttBytes(header, 3);
+	ttBytes(pPayload, len);
+	ttBytes(trailer, 2);
+}
+
+
+//*****************************************************************************
+// ttPut16 / ttPut32
+//*****************************************************************************
+static uint8_t * ttPut16(uint8_t * p, uint16_t n) {
+
+	*p++ = n & 0xff;
+	*p++ = n >> 8;
+	return p;
+}
+
+static uint8_t * ttPut32(uint8_t * p, uint32_t n) {
+
+	p = ttPut16(p, n & 0xffff);
+	return ttPut16(p, n >> 16);
+}
+
+
+//*****************************************************************************
+// ttTelem
+//*****************************************************************************
+// Adds a two voice telemetry frame, laid out as in telem.h.
+//*****************************************************************************
+static void ttTelem(uint8_t seq, uint32_t ms, bool badCrc) {
+
+uint8_t payload[TELEM_HEADER_BYTES + (2 * TELEM_VOICE_BYTES)];
+uint8_t * p = payload;
+uint8_t v;
+
+	*p++ = PROTO_RSP_TELEM;
+	*p++ = 37;
+	*p++ = 2;
+	*p++ = 0;
+	p = ttPut32(p, ms);
+	p = ttPut32(p, 3);
+	p = ttPut16(p, 812);
+	p = ttPut16(p, 1500);
+	for (v = 0; v < 2; v++) {
+		*p++ = (v == 0) ? VOICE_STATE_PLAYING : VOICE_STATE_AVAIL;
+		*p++ = 40 + v;
+		p = ttPut16(p, 1234 + v);
+		p = ttPut32(p, 0x12345678 + v);
+		p = ttPut16(p, 3000 + v);
+		p = ttPut16(p, 2048 + v);
+	}
+	ttFrame(seq, payload, p - payload, badCrc);
+}
+
+
+//*****************************************************************************
+// main
+//*****************************************************************************
+int main(void) {
+
+TELEMDEC_FRAME_STRUCTURE frame;
+TELEMDEC_STATUS_STRUCTURE status;
+uint8_t ack[2] = { PROTO_RSP_ACK, PROTO_ERR_BUSY };
+uint32_t telems = 0;
+uint32_t acks = 0;
+uint16_t i;
+
+	// The CRC has to match the CCITT check value, as protoCrc16() does
+	TT_CHECK(telemDecCrc16(0xffff, (const uint8_t *)"123456789", 9) == 0x29b1);
+
+	ttBytes("stat\n\r", 6);
+	ttTelem(7, 1000, false);
+	ttFrame(42, ack, 2, false);
+	ttBytes("Output busy\n\r", 13);
+	ttTelem(8, 1100, true);
+	ttTelem(10, 1300, false);
+
+	telemDecInit();
+	for (i = 0; i < ttLen; i++) {
+		if (!telemDecByte(ttStream[i], &frame))
+			continue;
+		telemDecPrint(stdout, &frame);
+		if (telemDecStatus(&frame, &status)) {
+			telems++;
+			TT_CHECK(status.cpuLoad == 37);
+			TT_CHECK(status.numVoices == 2);
+			TT_CHECK(status.underruns == 3);
+			TT_CHECK((status.sdLastUs == 812) && (status.sdPeakUs == 1500));
+			TT_CHECK(status.voice[0].state == VOICE_STATE_PLAYING);
+			TT_CHECK(status.voice[1].state == VOICE_STATE_AVAIL);
+			TT_CHECK((status.voice[1].gainIdx == 41) && (status.voice[1].track == 1235));
+			TT_CHECK(status.voice[1].framesPlayed == 0x12345679);
+			TT_CHECK((status.voice[1].mp3Bytes == 3001) && (status.voice[1].wavSamples == 2049));
+			TT_CHECK(status.msTicks == ((status.seq == 7) ? 1000 : 1300));
+		}
+		else {
+			acks++;
+			TT_CHECK((frame.seq == 42) && (frame.len == 2));
+			TT_CHECK(frame.payload[1] == PROTO_ERR_BUSY);
+		}
+	}
+	TT_CHECK(telems == 2);
+	TT_CHECK(acks == 1);
+	TT_CHECK(telemDecGetFrames() == 3);
+	TT_CHECK(telemDecGetCrcErrors() == 1);
+
+	// 8 was dropped for its CRC and 9 never came
+	TT_CHECK(telemDecGetLost() == 2);
+
+	printf("telemtest: %u errors\n", ttErrors);
+	return (ttErrors == 0) ? 0 : 1;
+}